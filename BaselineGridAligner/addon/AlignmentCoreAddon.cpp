@@ -0,0 +1,538 @@
+// Native Node addon exposing the alignment engine to the desktop app.
+//
+// Uses Node-API only, so one binary loads in Node and in any Electron version
+// without rebuilding. Parcel and line data are passed as Float64Array in
+// points: the addon reads its input and writes its output directly in the
+// arrays' memory, with no copies through JS values. Batch calls run on the
+// libuv thread pool and return a Promise; their arrays must not be modified
+// or transferred until it settles. Grid logic is the plugin's own
+// (AlignmentEngine.h), including fixed-point rounding.
+//
+// Build: ./build-addon.sh
+// JS side: electron/alignmentCore.ts
+
+#define NAPI_VERSION 6
+#include <node_api.h>
+
+#include "AlignmentEngine.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <string>
+#include <vector>
+
+namespace {
+
+const size_t kMaxArguments = 6;
+
+// Arguments of a callback; missing ones are undefined
+struct CallbackArguments {
+    napi_value fValues[kMaxArguments];
+    size_t fCount = kMaxArguments;
+
+    bool Get(napi_env env, napi_callback_info info) {
+        return napi_get_cb_info(env, info, &fCount, fValues, nullptr, nullptr) == napi_ok;
+    }
+
+    bool IsPresent(napi_env env, size_t index) const {
+        if (index >= fCount) return false;
+        napi_valuetype type;
+        return napi_typeof(env, fValues[index], &type) == napi_ok &&
+               type != napi_undefined && type != napi_null;
+    }
+};
+
+bool ThrowTypeError(napi_env env, const std::string& message)
+{
+    napi_throw_type_error(env, nullptr, message.c_str());
+    return false;
+}
+
+bool ThrowRangeError(napi_env env, const std::string& message)
+{
+    napi_throw_range_error(env, nullptr, message.c_str());
+    return false;
+}
+
+bool GetNumber(napi_env env, const CallbackArguments& args, size_t index, const char* name, double& value)
+{
+    if (index >= args.fCount || napi_get_value_double(env, args.fValues[index], &value) != napi_ok) {
+        return ThrowTypeError(env, std::string(name) + " must be a number");
+    }
+    return true;
+}
+
+// Grid increments must be positive after rounding to 1/1000 pt
+bool GetIncrement(napi_env env, const CallbackArguments& args, size_t index, const char* name, GridFixed& increment)
+{
+    double points;
+    if (!GetNumber(env, args, index, name, points)) return false;
+
+    increment = ToGridFixed(points);
+    if (increment <= 0) {
+        return ThrowRangeError(env, std::string(name) + " must be at least 0.001 pt");
+    }
+    return true;
+}
+
+/**
+ * A typed array argument: a pointer into its buffer, no copy.
+ */
+template <class T>
+struct TypedArrayView {
+    T* fData = nullptr;
+    size_t fLength = 0;
+    napi_value fValue = nullptr;
+
+    const T& operator[](size_t i) const { return fData[i]; }
+    T& operator[](size_t i) { return fData[i]; }
+};
+
+template <class T>
+bool GetTypedArray(napi_env env, const CallbackArguments& args, size_t index, const char* name,
+                   napi_typedarray_type expectedType, const char* typeName, TypedArrayView<T>& view)
+{
+    bool isTypedArray = false;
+    if (index < args.fCount) {
+        napi_is_typedarray(env, args.fValues[index], &isTypedArray);
+    }
+
+    napi_typedarray_type type;
+    void* data = nullptr;
+    if (!isTypedArray ||
+        napi_get_typedarray_info(env, args.fValues[index], &type, &view.fLength, &data, nullptr, nullptr) != napi_ok ||
+        type != expectedType) {
+        return ThrowTypeError(env, std::string(name) + " must be a " + typeName);
+    }
+
+    view.fData = static_cast<T*>(data);
+    view.fValue = args.fValues[index];
+    return true;
+}
+
+bool GetFloat64Array(napi_env env, const CallbackArguments& args, size_t index, const char* name,
+                     TypedArrayView<double>& view)
+{
+    return GetTypedArray(env, args, index, name, napi_float64_array, "Float64Array", view);
+}
+
+bool CheckLength(napi_env env, const char* name, size_t length, size_t expected)
+{
+    if (length != expected) {
+        return ThrowRangeError(env, std::string(name) + " must have one element per item");
+    }
+    return true;
+}
+
+napi_value CreateNumber(napi_env env, double value)
+{
+    napi_value result;
+    napi_create_double(env, value, &result);
+    return result;
+}
+
+void SetNumber(napi_env env, napi_value object, const char* name, double value)
+{
+    napi_set_named_property(env, object, name, CreateNumber(env, value));
+}
+
+napi_value CreateHistogram(napi_env env, const MisalignmentHistogram& histogram)
+{
+    napi_value result;
+    napi_create_array_with_length(env, MisalignmentHistogram::kBucketCount, &result);
+    for (int i = 0; i < MisalignmentHistogram::kBucketCount; i++) {
+        napi_set_element(env, result, i, CreateNumber(env, static_cast<double>(histogram.fCounts[i])));
+    }
+    return result;
+}
+
+/**
+ * @class AddonTask
+ *
+ * One batch call running on the libuv thread pool. References to its typed
+ * arrays keep them alive until the Promise settles. Execute() runs on a pool
+ * thread and may only touch the arrays' memory and plain fields; Result()
+ * builds the resolution value back on the JS thread.
+ */
+class AddonTask {
+public:
+    virtual ~AddonTask() {}
+
+    void Retain(napi_env env, napi_value value) {
+        napi_ref reference;
+        if (napi_create_reference(env, value, 1, &reference) == napi_ok) {
+            fReferences.push_back(reference);
+        }
+    }
+
+    // Queue the task and return its Promise; the task deletes itself when done
+    napi_value Queue(napi_env env, const char* name) {
+        napi_value promise;
+        napi_value resourceName;
+        if (napi_create_promise(env, &fDeferred, &promise) != napi_ok ||
+            napi_create_string_utf8(env, name, NAPI_AUTO_LENGTH, &resourceName) != napi_ok ||
+            napi_create_async_work(env, nullptr, resourceName, ExecuteWork, CompleteWork, this, &fWork) != napi_ok ||
+            napi_queue_async_work(env, fWork) != napi_ok) {
+            Release(env);
+            delete this;
+            napi_throw_error(env, nullptr, "Cannot queue native alignment work");
+            return nullptr;
+        }
+        return promise;
+    }
+
+protected:
+    virtual void Execute() = 0;
+    virtual napi_value Result(napi_env env) = 0;
+
+private:
+    static void ExecuteWork(napi_env, void* data) {
+        AddonTask* task = static_cast<AddonTask*>(data);
+        try {
+            task->Execute();
+        }
+        catch (std::exception& e) {
+            task->fError = e.what();
+        }
+        catch (...) {
+            task->fError = "Native alignment work failed";
+        }
+    }
+
+    static void CompleteWork(napi_env env, napi_status status, void* data) {
+        AddonTask* task = static_cast<AddonTask*>(data);
+
+        if (status == napi_ok && task->fError.empty()) {
+            napi_resolve_deferred(env, task->fDeferred, task->Result(env));
+        }
+        else {
+            napi_value message;
+            napi_value error;
+            napi_create_string_utf8(env, task->fError.empty() ? "Native alignment work was cancelled"
+                                                              : task->fError.c_str(),
+                                    NAPI_AUTO_LENGTH, &message);
+            napi_create_error(env, nullptr, message, &error);
+            napi_reject_deferred(env, task->fDeferred, error);
+        }
+
+        task->Release(env);
+        napi_delete_async_work(env, task->fWork);
+        delete task;
+    }
+
+    void Release(napi_env env) {
+        for (napi_ref reference : fReferences) {
+            napi_delete_reference(env, reference);
+        }
+        fReferences.clear();
+    }
+
+    napi_async_work fWork = nullptr;
+    napi_deferred fDeferred = nullptr;
+    std::vector<napi_ref> fReferences;
+    std::string fError;
+};
+
+/**
+ * Snap parcel baseline offsets to their grid, like the baseline mode.
+ * newOffsets receives the snapped offsets, deviations (optional) the change.
+ * A parcel with a zero increment is left as it is.
+ */
+class SnapParcelsTask : public AddonTask {
+public:
+    TypedArrayView<double> fOffsets;
+    TypedArrayView<double> fIncrements;         // empty: fIncrement for every parcel
+    TypedArrayView<double> fNewOffsets;
+    TypedArrayView<double> fDeviations;         // optional
+    GridFixed fIncrement = 0;
+
+protected:
+    void Execute() override {
+        for (size_t i = 0; i < fOffsets.fLength; i++) {
+            const GridFixed offset = ToGridFixed(fOffsets[i]);
+            const GridFixed increment = fIncrements.fData ? ToGridFixed(fIncrements[i]) : fIncrement;
+            const GridFixed newOffset = increment > 0 ? SnapToGrid(offset, increment) : offset;
+
+            fNewOffsets[i] = FromGridFixed(newOffset);
+            if (fDeviations.fData) {
+                fDeviations[i] = FromGridFixed(newOffset - offset);
+            }
+            if (newOffset != offset) {
+                fCorrected++;
+                fHistogram.Add(newOffset - offset);
+            }
+        }
+    }
+
+    napi_value Result(napi_env env) override {
+        napi_value result;
+        napi_create_object(env, &result);
+        SetNumber(env, result, "corrected", static_cast<double>(fCorrected));
+        napi_set_named_property(env, result, "histogram", CreateHistogram(env, fHistogram));
+        return result;
+    }
+
+private:
+    size_t fCorrected = 0;
+    MisalignmentHistogram fHistogram;
+};
+
+/**
+ * Find composed lines off the grid, like the lines mode. deviations receives
+ * the distance of each line to the grid, 0 for lines within tolerance and
+ * empty lines.
+ */
+class FindOffGridLinesTask : public AddonTask {
+public:
+    TypedArrayView<double> fBaselines;
+    TypedArrayView<double> fLineHeights;
+    TypedArrayView<double> fDeviations;
+    BaselineGrid fGrid = BaselineGrid();
+
+protected:
+    void Execute() override {
+        const size_t count = fBaselines.fLength;
+        BaselineLineMetrics lines;
+        lines.Reserve(count);
+        for (size_t i = 0; i < count; i++) {
+            lines.Append(static_cast<int32_t>(i), 1, ToGridFixed(fBaselines[i]), ToGridFixed(fLineHeights[i]), 0);
+        }
+        ArenaVector<BaselineGrid> lineGrids(count, fGrid);
+
+        ArenaVector<BaselineCorrection> corrections;
+        FindOffGridLines(lines, lineGrids, nullptr, corrections, &fHistogram);
+
+        for (size_t i = 0; i < count; i++) {
+            fDeviations[i] = 0.0;
+        }
+        // Lines come without baseline shift, so each correction is the shift that
+        // moves the line onto the grid, the opposite of its deviation
+        for (const BaselineCorrection& correction : corrections) {
+            fDeviations[correction.fStart] = -FromGridFixed(correction.fOffset);
+        }
+        fOffGrid = corrections.size();
+    }
+
+    napi_value Result(napi_env env) override {
+        napi_value result;
+        napi_create_object(env, &result);
+        SetNumber(env, result, "offGrid", static_cast<double>(fOffGrid));
+        napi_set_named_property(env, result, "histogram", CreateHistogram(env, fHistogram));
+        return result;
+    }
+
+private:
+    size_t fOffGrid = 0;
+    MisalignmentHistogram fHistogram;
+};
+
+/**
+ * Check parcels against the report rules. rules receives one bit per failed
+ * AlignmentRule for each parcel (ruleBaselineOffGrid, ruleLeadingOffGrid).
+ */
+class ValidateParcelsTask : public AddonTask {
+public:
+    TypedArrayView<double> fBaselines;
+    TypedArrayView<double> fLeadings;
+    TypedArrayView<double> fIncrements;         // empty: fIncrement for every parcel
+    TypedArrayView<uint8_t> fRules;
+    GridFixed fIncrement = 0;
+    GridFixed fTolerance = 0;
+
+protected:
+    void Execute() override {
+        for (size_t i = 0; i < fBaselines.fLength; i++) {
+            const GridFixed increment = fIncrements.fData ? ToGridFixed(fIncrements[i]) : fIncrement;
+            const uint32_t failed = increment > 0
+                ? CheckParcelRules(ToGridFixed(fBaselines[i]), ToGridFixed(fLeadings[i]), increment, fTolerance)
+                : 0;
+
+            fRules[i] = static_cast<uint8_t>(failed);
+            fFailedParcels += failed != 0 ? 1 : 0;
+            for (int rule = 0; rule < kRuleCount; rule++) {
+                fRuleCounts[rule] += (failed >> rule) & 1;
+            }
+        }
+    }
+
+    napi_value Result(napi_env env) override {
+        napi_value result;
+        napi_create_object(env, &result);
+        SetNumber(env, result, "failedParcels", static_cast<double>(fFailedParcels));
+        SetNumber(env, result, "baselineOffGrid", static_cast<double>(fRuleCounts[kRuleBaselineOffGrid]));
+        SetNumber(env, result, "leadingOffGrid", static_cast<double>(fRuleCounts[kRuleLeadingOffGrid]));
+        return result;
+    }
+
+private:
+    size_t fFailedParcels = 0;
+    size_t fRuleCounts[kRuleCount] = {};
+};
+
+// Per-item increments may come as a Float64Array or one number for all items
+bool GetIncrements(napi_env env, const CallbackArguments& args, size_t index, size_t count,
+                   TypedArrayView<double>& increments, GridFixed& increment)
+{
+    bool isTypedArray = false;
+    if (index < args.fCount) {
+        napi_is_typedarray(env, args.fValues[index], &isTypedArray);
+    }
+    if (!isTypedArray) {
+        return GetIncrement(env, args, index, "increment", increment);
+    }
+    return GetFloat64Array(env, args, index, "increments", increments) &&
+           CheckLength(env, "increments", increments.fLength, count);
+}
+
+// snapToGrid(value, increment): value snapped to the nearest grid multiple, in points
+napi_value SnapToGridCallback(napi_env env, napi_callback_info info)
+{
+    CallbackArguments args;
+    double value;
+    GridFixed increment;
+    if (!args.Get(env, info) || !GetNumber(env, args, 0, "value", value) ||
+        !GetIncrement(env, args, 1, "increment", increment)) {
+        return nullptr;
+    }
+    return CreateNumber(env, FromGridFixed(SnapToGrid(ToGridFixed(value), increment)));
+}
+
+// gridScaleFactor(fontSize, increment): scale that brings the size onto the grid
+napi_value GridScaleFactorCallback(napi_env env, napi_callback_info info)
+{
+    CallbackArguments args;
+    double fontSize;
+    GridFixed increment;
+    if (!args.Get(env, info) || !GetNumber(env, args, 0, "fontSize", fontSize) ||
+        !GetIncrement(env, args, 1, "increment", increment)) {
+        return nullptr;
+    }
+    return CreateNumber(env, GridScaleFactor(ToGridFixed(fontSize), increment));
+}
+
+// snapLeadingToGrid(leading, increment, multiple = 0): leading that fits the grid
+napi_value SnapLeadingToGridCallback(napi_env env, napi_callback_info info)
+{
+    CallbackArguments args;
+    double leading;
+    GridFixed increment;
+    double multiple = 0.0;
+    if (!args.Get(env, info) || !GetNumber(env, args, 0, "leading", leading) ||
+        !GetIncrement(env, args, 1, "increment", increment)) {
+        return nullptr;
+    }
+    if (args.IsPresent(env, 2) && !GetNumber(env, args, 2, "multiple", multiple)) return nullptr;
+
+    return CreateNumber(env, FromGridFixed(SnapLeadingToGrid(ToGridFixed(leading), increment,
+                                                             static_cast<int32_t>(multiple))));
+}
+
+// snapParcels(offsets, increments | increment, newOffsets, deviations?) -> Promise<{ corrected, histogram }>
+napi_value SnapParcelsCallback(napi_env env, napi_callback_info info)
+{
+    CallbackArguments args;
+    if (!args.Get(env, info)) return nullptr;
+
+    SnapParcelsTask* task = new SnapParcelsTask();
+    const bool valid =
+        GetFloat64Array(env, args, 0, "offsets", task->fOffsets) &&
+        GetIncrements(env, args, 1, task->fOffsets.fLength, task->fIncrements, task->fIncrement) &&
+        GetFloat64Array(env, args, 2, "newOffsets", task->fNewOffsets) &&
+        CheckLength(env, "newOffsets", task->fNewOffsets.fLength, task->fOffsets.fLength) &&
+        (!args.IsPresent(env, 3) ||
+         (GetFloat64Array(env, args, 3, "deviations", task->fDeviations) &&
+          CheckLength(env, "deviations", task->fDeviations.fLength, task->fOffsets.fLength)));
+    if (!valid) {
+        delete task;
+        return nullptr;
+    }
+
+    task->Retain(env, task->fOffsets.fValue);
+    if (task->fIncrements.fData) task->Retain(env, task->fIncrements.fValue);
+    task->Retain(env, task->fNewOffsets.fValue);
+    if (task->fDeviations.fData) task->Retain(env, task->fDeviations.fValue);
+    return task->Queue(env, "AlignmentCore:SnapParcels");
+}
+
+// findOffGridLines(baselines, lineHeights, gridStart, gridIncrement, deviations) -> Promise<{ offGrid, histogram }>
+napi_value FindOffGridLinesCallback(napi_env env, napi_callback_info info)
+{
+    CallbackArguments args;
+    if (!args.Get(env, info)) return nullptr;
+
+    FindOffGridLinesTask* task = new FindOffGridLinesTask();
+    double gridStart = 0.0;
+    const bool valid =
+        GetFloat64Array(env, args, 0, "baselines", task->fBaselines) &&
+        GetFloat64Array(env, args, 1, "lineHeights", task->fLineHeights) &&
+        CheckLength(env, "lineHeights", task->fLineHeights.fLength, task->fBaselines.fLength) &&
+        GetNumber(env, args, 2, "gridStart", gridStart) &&
+        GetIncrement(env, args, 3, "gridIncrement", task->fGrid.fIncrement) &&
+        GetFloat64Array(env, args, 4, "deviations", task->fDeviations) &&
+        CheckLength(env, "deviations", task->fDeviations.fLength, task->fBaselines.fLength);
+    if (!valid || task->fBaselines.fLength > static_cast<size_t>(INT32_MAX)) {
+        if (valid) ThrowRangeError(env, "too many lines");
+        delete task;
+        return nullptr;
+    }
+    task->fGrid.fStart = ToGridFixed(gridStart);
+
+    task->Retain(env, task->fBaselines.fValue);
+    task->Retain(env, task->fLineHeights.fValue);
+    task->Retain(env, task->fDeviations.fValue);
+    return task->Queue(env, "AlignmentCore:FindOffGridLines");
+}
+
+// validateParcels(baselines, leadings, increments | increment, tolerance, rules) -> Promise<{ failedParcels, ... }>
+napi_value ValidateParcelsCallback(napi_env env, napi_callback_info info)
+{
+    CallbackArguments args;
+    if (!args.Get(env, info)) return nullptr;
+
+    ValidateParcelsTask* task = new ValidateParcelsTask();
+    double tolerance = 0.0;
+    const bool valid =
+        GetFloat64Array(env, args, 0, "baselines", task->fBaselines) &&
+        GetFloat64Array(env, args, 1, "leadings", task->fLeadings) &&
+        CheckLength(env, "leadings", task->fLeadings.fLength, task->fBaselines.fLength) &&
+        GetIncrements(env, args, 2, task->fBaselines.fLength, task->fIncrements, task->fIncrement) &&
+        GetNumber(env, args, 3, "tolerance", tolerance) &&
+        GetTypedArray(env, args, 4, "rules", napi_uint8_array, "Uint8Array", task->fRules) &&
+        CheckLength(env, "rules", task->fRules.fLength, task->fBaselines.fLength);
+    if (!valid) {
+        delete task;
+        return nullptr;
+    }
+    task->fTolerance = ToGridFixed(tolerance);
+
+    task->Retain(env, task->fBaselines.fValue);
+    task->Retain(env, task->fLeadings.fValue);
+    if (task->fIncrements.fData) task->Retain(env, task->fIncrements.fValue);
+    task->Retain(env, task->fRules.fValue);
+    return task->Queue(env, "AlignmentCore:ValidateParcels");
+}
+
+napi_value Init(napi_env env, napi_value exports)
+{
+    const napi_property_descriptor methods[] = {
+        { "snapToGrid", nullptr, SnapToGridCallback, nullptr, nullptr, nullptr, napi_enumerable, nullptr },
+        { "gridScaleFactor", nullptr, GridScaleFactorCallback, nullptr, nullptr, nullptr, napi_enumerable, nullptr },
+        { "snapLeadingToGrid", nullptr, SnapLeadingToGridCallback, nullptr, nullptr, nullptr, napi_enumerable, nullptr },
+        { "snapParcels", nullptr, SnapParcelsCallback, nullptr, nullptr, nullptr, napi_enumerable, nullptr },
+        { "findOffGridLines", nullptr, FindOffGridLinesCallback, nullptr, nullptr, nullptr, napi_enumerable, nullptr },
+        { "validateParcels", nullptr, ValidateParcelsCallback, nullptr, nullptr, nullptr, napi_enumerable, nullptr }
+    };
+    napi_define_properties(env, exports, sizeof(methods) / sizeof(methods[0]), methods);
+
+    // Rule bits of validateParcels and the histogram layout
+    SetNumber(env, exports, "ruleBaselineOffGrid", 1u << kRuleBaselineOffGrid);
+    SetNumber(env, exports, "ruleLeadingOffGrid", 1u << kRuleLeadingOffGrid);
+    SetNumber(env, exports, "histogramBucketCount", MisalignmentHistogram::kBucketCount);
+    SetNumber(env, exports, "lineGridTolerance", FromGridFixed(kLineGridTolerance));
+    return exports;
+}
+
+} // namespace
+
+NAPI_MODULE(alignment_core, Init)
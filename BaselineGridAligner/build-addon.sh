@@ -0,0 +1,33 @@
+#!/bin/bash
+# Build script for the desktop app's native addon (addon/AlignmentCoreAddon.cpp)
+# The addon uses Node-API only, so the same binary loads in Node and in Electron;
+# headers come from the Node installation found on the PATH
+
+echo "Building native addon..."
+
+# Create build directory
+mkdir -p build
+
+NODE_INCLUDE=$(node -p "require('path').resolve(process.execPath, '../../include/node')")
+if [ ! -f "$NODE_INCLUDE/node_api.h" ]; then
+    echo "Node headers not found in $NODE_INCLUDE."
+    exit 1
+fi
+
+# Set compiler flags
+CXXFLAGS="-std=c++17 -O2 -pthread -fPIC -shared -fvisibility=hidden"
+INCLUDES="-Isource -Isource/includes -I$NODE_INCLUDE"
+
+# Node-API symbols are resolved from the host process when it loads the addon
+if [ "$(uname)" = "Darwin" ]; then
+    LDFLAGS="-undefined dynamic_lookup"
+else
+    LDFLAGS=""
+fi
+
+# Compile and link
+g++ $CXXFLAGS $INCLUDES -o build/alignment_core.node \
+    addon/AlignmentCoreAddon.cpp $LDFLAGS || exit 1
+
+echo "Build completed successfully."
+echo "Output: build/alignment_core.node"
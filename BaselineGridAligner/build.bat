@@ -24,9 +24,17 @@ REM Compile source files
 cl.exe %CXXFLAGS% %INCLUDES% /c source\BaselineGridAligner.cpp /Fobuild\BaselineGridAligner.obj
 cl.exe %CXXFLAGS% %INCLUDES% /c source\BaselineGridAlignerSettings.cpp /Fobuild\BaselineGridAlignerSettings.obj
 cl.exe %CXXFLAGS% %INCLUDES% /c source\BaselineGridAlignerPanel.cpp /Fobuild\BaselineGridAlignerPanel.obj
+cl.exe %CXXFLAGS% %INCLUDES% /c source\AlignmentTrace.cpp /Fobuild\AlignmentTrace.obj
+cl.exe %CXXFLAGS% %INCLUDES% /c source\AlignmentCounters.cpp /Fobuild\AlignmentCounters.obj
+cl.exe %CXXFLAGS% %INCLUDES% /c source\AlignmentFindings.cpp /Fobuild\AlignmentFindings.obj
+cl.exe %CXXFLAGS% %INCLUDES% /c source\AlignmentFindingGroups.cpp /Fobuild\AlignmentFindingGroups.obj
+cl.exe %CXXFLAGS% %INCLUDES% /c source\AlignmentFingerprintCache.cpp /Fobuild\AlignmentFingerprintCache.obj
+cl.exe %CXXFLAGS% %INCLUDES% /c source\AlignmentRecorder.cpp /Fobuild\AlignmentRecorder.obj
+cl.exe %CXXFLAGS% %INCLUDES% /c source\AlignmentStatsStream.cpp /Fobuild\AlignmentStatsStream.obj
+cl.exe %CXXFLAGS% %INCLUDES% /c source\AlignmentTelemetry.cpp /Fobuild\AlignmentTelemetry.obj
 
 REM Link object files
-link.exe /DLL /OUT:build\BaselineGridAligner.dll build\BaselineGridAligner.obj build\BaselineGridAlignerSettings.obj build\BaselineGridAlignerPanel.obj %LIBPATH% %LIBS%
+link.exe /DLL /OUT:build\BaselineGridAligner.dll build\BaselineGridAligner.obj build\BaselineGridAlignerSettings.obj build\BaselineGridAlignerPanel.obj build\AlignmentTrace.obj build\AlignmentCounters.obj build\AlignmentFindings.obj build\AlignmentFindingGroups.obj build\AlignmentFingerprintCache.obj build\AlignmentRecorder.obj build\AlignmentStatsStream.obj build\AlignmentTelemetry.obj %LIBPATH% %LIBS%
 
 REM Create plugin directory structure
 if not exist build\BaselineGridAligner mkdir build\BaselineGridAligner
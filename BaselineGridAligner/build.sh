@@ -15,18 +15,37 @@ echo "Building BaselineGridAligner plugin for InDesign 2024..."
 mkdir -p build
 
 # Set compiler flags
-CXXFLAGS="-std=c++17 -O2 -fvisibility=hidden -fvisibility-inlines-hidden -DMAC_ENV -arch arm64 -arch x86_64 -fopenmp"
+CXXFLAGS="-std=c++17 -O2 -fvisibility=hidden -fvisibility-inlines-hidden -DMAC_ENV -arch arm64 -arch x86_64"
 INCLUDES="-I$INDESIGN_SDK_DIR/source/public -I$INDESIGN_SDK_DIR/source/public/includes -Isource -Isource/includes"
 LIBPATH="-L$INDESIGN_SDK_DIR/build/mac/release"
 LIBS="-framework Cocoa -framework Carbon -framework CoreFoundation -lPublic"
 
+# Apple clang has no -fopenmp; use Homebrew libomp if it covers both architectures,
+# otherwise the plugin runs its parallel loops on its own thread pool
+LIBOMP_PREFIX=$(brew --prefix libomp 2>/dev/null)
+if [ -n "$LIBOMP_PREFIX" ] && lipo "$LIBOMP_PREFIX/lib/libomp.dylib" -verify_arch arm64 x86_64 2>/dev/null; then
+    echo "Using OpenMP from $LIBOMP_PREFIX"
+    CXXFLAGS="$CXXFLAGS -Xpreprocessor -fopenmp -I$LIBOMP_PREFIX/include"
+    LIBS="$LIBS -L$LIBOMP_PREFIX/lib -lomp"
+else
+    echo "Universal libomp not found, building without OpenMP (built-in thread pool)."
+fi
+
 # Compile source files
 clang++ $CXXFLAGS $INCLUDES -c source/BaselineGridAligner.cpp -o build/BaselineGridAligner.o
 clang++ $CXXFLAGS $INCLUDES -c source/BaselineGridAlignerSettings.cpp -o build/BaselineGridAlignerSettings.o
 clang++ $CXXFLAGS $INCLUDES -c source/BaselineGridAlignerPanel.cpp -o build/BaselineGridAlignerPanel.o
+clang++ $CXXFLAGS $INCLUDES -c source/AlignmentTrace.cpp -o build/AlignmentTrace.o
+clang++ $CXXFLAGS $INCLUDES -c source/AlignmentCounters.cpp -o build/AlignmentCounters.o
+clang++ $CXXFLAGS $INCLUDES -c source/AlignmentFindings.cpp -o build/AlignmentFindings.o
+clang++ $CXXFLAGS $INCLUDES -c source/AlignmentFindingGroups.cpp -o build/AlignmentFindingGroups.o
+clang++ $CXXFLAGS $INCLUDES -c source/AlignmentFingerprintCache.cpp -o build/AlignmentFingerprintCache.o
+clang++ $CXXFLAGS $INCLUDES -c source/AlignmentRecorder.cpp -o build/AlignmentRecorder.o
+clang++ $CXXFLAGS $INCLUDES -c source/AlignmentStatsStream.cpp -o build/AlignmentStatsStream.o
+clang++ $CXXFLAGS $INCLUDES -c source/AlignmentTelemetry.cpp -o build/AlignmentTelemetry.o
 
 # Link object files
-clang++ -dynamiclib -o build/BaselineGridAligner.dylib build/BaselineGridAligner.o build/BaselineGridAlignerSettings.o build/BaselineGridAlignerPanel.o $LIBPATH $LIBS
+clang++ -dynamiclib -o build/BaselineGridAligner.dylib build/BaselineGridAligner.o build/BaselineGridAlignerSettings.o build/BaselineGridAlignerPanel.o build/AlignmentTrace.o build/AlignmentCounters.o build/AlignmentFindings.o build/AlignmentFindingGroups.o build/AlignmentFingerprintCache.o build/AlignmentRecorder.o build/AlignmentStatsStream.o build/AlignmentTelemetry.o $LIBPATH $LIBS
 
 # Create plugin directory structure
 mkdir -p build/BaselineGridAligner.InDesignPlugin/Contents/MacOS
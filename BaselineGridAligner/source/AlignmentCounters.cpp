@@ -0,0 +1,106 @@
+#include "includes/AlignmentCounters.h"
+
+#include <cstdio>
+
+AlignmentCounters& AlignmentCounters::Instance()
+{
+    static AlignmentCounters sInstance;
+    return sInstance;
+}
+
+AlignmentCounters::AlignmentCounters()
+    : fRunStart(0),
+      fCancelStart(0)
+{
+    for (int i = 0; i < kCounterCount; i++) {
+        fValues[i].fValue.store(0, std::memory_order_relaxed);
+    }
+    for (int i = 0; i < kStartupPhaseCount; i++) {
+        fStartupMicros[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+void AlignmentCounters::BeginRun()
+{
+    for (int i = 0; i < kCounterCount; i++) {
+        fValues[i].fValue.store(0, std::memory_order_relaxed);
+    }
+    fCancelStart.store(0, std::memory_order_relaxed);
+    fRunStart.store(NowMicros(), std::memory_order_relaxed);
+}
+
+void AlignmentCounters::EndRun()
+{
+    const uint64_t start = fRunStart.exchange(0, std::memory_order_relaxed);
+    if (start != 0) {
+        fValues[kCounterRunMicros].fValue.store(NowMicros() - start, std::memory_order_relaxed);
+    }
+}
+
+void AlignmentCounters::CancelRequested()
+{
+    // Only the first thread to see the cancel sets the start time
+    uint64_t expected = 0;
+    fCancelStart.compare_exchange_strong(expected, NowMicros(), std::memory_order_relaxed);
+}
+
+void AlignmentCounters::CancelObserved()
+{
+    const uint64_t start = fCancelStart.exchange(0, std::memory_order_relaxed);
+    if (start != 0) {
+        fValues[kCounterCancelLatencyMicros].fValue.store(NowMicros() - start, std::memory_order_relaxed);
+    }
+}
+
+const char* AlignmentCounters::GetName(AlignmentCounter counter)
+{
+    switch (counter) {
+        case kCounterParcelsScanned:        return "parcelsScanned";
+        case kCounterParcelsSkippedByRange: return "parcelsSkippedByRange";
+        case kCounterParcelsSkippedByCache: return "parcelsSkippedByCache";
+        case kCounterParcelsModified:       return "parcelsModified";
+        case kCounterCommandsIssued:        return "commandsIssued";
+        case kCounterMisalignmentsFound:    return "misalignmentsFound";
+        case kCounterCriticalSectionNanos:  return "criticalSectionNanos";
+        case kCounterCancelLatencyMicros:   return "cancelLatencyMicros";
+        case kCounterRunMicros:             return "runMicros";
+        case kCounterArenaHeapAllocations:  return "arenaHeapAllocations";
+        case kCounterArenaBytes:            return "arenaBytes";
+        case kCounterRecompositions:        return "recompositions";
+        default:                            return "unknown";
+    }
+}
+
+const char* AlignmentCounters::GetStartupName(AlignmentStartupPhase phase)
+{
+    switch (phase) {
+        case kStartupAlignerConstruct:      return "Startup:AlignerConstruct";
+        case kStartupPanelRegister:         return "Startup:PanelRegister";
+        case kStartupPanelBuildControls:    return "Startup:PanelBuildControls";
+        default:                            return "Startup:Unknown";
+    }
+}
+
+bool AlignmentCounters::DumpToFile(const std::string& path) const
+{
+    FILE* file = fopen(path.c_str(), "w");
+    if (!file) return false;
+
+    fputs("{\n", file);
+    for (int i = 0; i < kCounterCount; i++) {
+        const AlignmentCounter counter = static_cast<AlignmentCounter>(i);
+        fprintf(file, "  \"%s\": %llu,\n", GetName(counter),
+                static_cast<unsigned long long>(Get(counter)));
+    }
+    fputs("  \"startupMicros\": {\n", file);
+    for (int i = 0; i < kStartupPhaseCount; i++) {
+        const AlignmentStartupPhase phase = static_cast<AlignmentStartupPhase>(i);
+        fprintf(file, "    \"%s\": %llu%s\n", GetStartupName(phase),
+                static_cast<unsigned long long>(GetStartupMicros(phase)),
+                i + 1 < kStartupPhaseCount ? "," : "");
+    }
+    fputs("  }\n}\n", file);
+
+    const bool ok = ferror(file) == 0;
+    return fclose(file) == 0 && ok;
+}
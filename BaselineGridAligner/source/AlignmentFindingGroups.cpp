@@ -0,0 +1,153 @@
+#include "includes/AlignmentFindingGroups.h"
+
+#include <algorithm>
+#include <cstdio>
+
+AlignmentFindingGroups::AlignmentFindingGroups()
+{
+    fGroups.reserve(kMaxGroups + kRuleCount);
+    Clear();
+}
+
+void AlignmentFindingGroups::Clear()
+{
+    fGroups.clear();
+    for (size_t slot = 0; slot < kIndexSlots; slot++) {
+        fIndexGroups[slot] = kEmptySlot;
+    }
+    fFindingCount = 0;
+}
+
+void AlignmentFindingGroups::Add(const AlignmentFinding& finding, uint32_t style)
+{
+    const GridFixed deviation = finding.fMeasured - finding.fExpected;
+    const uint8_t bucket = static_cast<uint8_t>(MisalignmentHistogram::Bucket(deviation));
+
+    AlignmentFindingGroup& group = FindGroup(finding.fRule, style, bucket);
+    group.fMinDeviation = std::min(group.fMinDeviation, deviation);
+    group.fMaxDeviation = std::max(group.fMaxDeviation, deviation);
+    group.fCount++;
+    AddFirstOccurrence(group, finding);
+    fFindingCount++;
+}
+
+void AlignmentFindingGroups::Merge(const AlignmentFindingGroups& other)
+{
+    for (const AlignmentFindingGroup& source : other.fGroups) {
+        AlignmentFindingGroup& group = FindGroup(source.fRule, source.fStyle, source.fBucket);
+        group.fMinDeviation = std::min(group.fMinDeviation, source.fMinDeviation);
+        group.fMaxDeviation = std::max(group.fMaxDeviation, source.fMaxDeviation);
+        group.fCount += source.fCount;
+        for (int32_t i = 0; i < source.fFirstCount; i++) {
+            AddFirstOccurrence(group, source.fFirst[i]);
+        }
+    }
+    fFindingCount += other.fFindingCount;
+}
+
+std::vector<AlignmentFindingGroup> AlignmentFindingGroups::Sorted() const
+{
+    std::vector<AlignmentFindingGroup> groups(fGroups);
+    std::sort(groups.begin(), groups.end(), [](const AlignmentFindingGroup& a, const AlignmentFindingGroup& b) {
+        if (a.fRule != b.fRule) return a.fRule < b.fRule;
+        if (a.IsOverflow() != b.IsOverflow()) return b.IsOverflow();
+        if (a.fCount != b.fCount) return a.fCount > b.fCount;
+        return FindingPrecedes(a.fFirst[0], b.fFirst[0]);
+    });
+    return groups;
+}
+
+size_t AlignmentFindingGroups::FindSlot(uint64_t key) const
+{
+    size_t slot = static_cast<size_t>((key * 0x9E3779B97F4A7C15ull) >> (64 - kIndexBits));
+    while (fIndexGroups[slot] != kEmptySlot && fIndexKeys[slot] != key) {
+        slot = (slot + 1) & (kIndexSlots - 1);
+    }
+    return slot;
+}
+
+AlignmentFindingGroup& AlignmentFindingGroups::FindGroup(AlignmentRule rule, uint32_t style, uint8_t bucket)
+{
+    uint64_t key = Key(rule, style, bucket);
+    size_t slot = FindSlot(key);
+    if (fIndexGroups[slot] != kEmptySlot) return fGroups[fIndexGroups[slot]];
+
+    // Past the limit new groups fold into the rule's overflow group
+    const bool overflow = bucket == AlignmentFindingGroup::kOverflowBucket || fGroups.size() >= kMaxGroups;
+    if (overflow) {
+        style = AlignmentFindingGroup::kOverflowStyle;
+        bucket = AlignmentFindingGroup::kOverflowBucket;
+        key = Key(rule, style, bucket);
+        slot = FindSlot(key);
+        if (fIndexGroups[slot] != kEmptySlot) return fGroups[fIndexGroups[slot]];
+    }
+
+    AlignmentFindingGroup group;
+    group.fRule = rule;
+    group.fBucket = bucket;
+    group.fStyle = style;
+    group.fCount = 0;
+    group.fMinDeviation = INT64_MAX;
+    group.fMaxDeviation = INT64_MIN;
+    group.fFirstCount = 0;
+
+    fIndexKeys[slot] = key;
+    fIndexGroups[slot] = static_cast<uint32_t>(fGroups.size());
+    fGroups.push_back(group);
+    return fGroups.back();
+}
+
+void AlignmentFindingGroups::AddFirstOccurrence(AlignmentFindingGroup& group, const AlignmentFinding& finding)
+{
+    // Keep the earliest findings in text order, whichever thread found them
+    int32_t position = group.fFirstCount;
+    if (position == AlignmentFindingGroup::kFirstOccurrences) {
+        if (!FindingPrecedes(finding, group.fFirst[position - 1])) return;
+        position--;
+    }
+    else {
+        group.fFirstCount++;
+    }
+    while (position > 0 && FindingPrecedes(finding, group.fFirst[position - 1])) {
+        group.fFirst[position] = group.fFirst[position - 1];
+        position--;
+    }
+    group.fFirst[position] = finding;
+}
+
+AlignmentReportDetail& AlignmentReportDetail::Instance()
+{
+    static AlignmentReportDetail sInstance;
+    return sInstance;
+}
+
+void AlignmentReportDetail::Store(const AlignmentFinding* findings, size_t count, uint64_t totalCount,
+                                  FindingLanguage language)
+{
+    std::lock_guard<std::mutex> lock(fMutex);
+    fFindings.assign(findings, findings + count);
+    fTotalCount = totalCount;
+    fLanguage = language;
+}
+
+bool AlignmentReportDetail::Export(const std::string& path) const
+{
+    std::lock_guard<std::mutex> lock(fMutex);
+    if (fFindings.empty()) return false;
+
+    FILE* file = fopen(path.c_str(), "w");
+    if (!file) return false;
+
+    for (const AlignmentFinding& finding : fFindings) {
+        fprintf(file, "%s\t%s\n", AlignmentFindingFormatter::GetRuleCode(finding.fRule),
+                AlignmentFindingFormatter::Format(finding, fLanguage).c_str());
+    }
+    if (fTotalCount > fFindings.size()) {
+        const bool english = fLanguage == kFindingLanguageEnglish;
+        fprintf(file, english ? "... %llu more findings not kept\n" : "... dalších %llu nálezů neuloženo\n",
+                static_cast<unsigned long long>(fTotalCount - fFindings.size()));
+    }
+
+    const bool ok = ferror(file) == 0;
+    return fclose(file) == 0 && ok;
+}
@@ -0,0 +1,108 @@
+#include "includes/AlignmentFindings.h"
+#include "includes/AlignmentFindingGroups.h"
+
+#include <cstdio>
+
+const char* AlignmentFindingFormatter::GetRuleCode(AlignmentRule rule)
+{
+    switch (rule) {
+        case kRuleBaselineOffGrid: return "BGA001";
+        case kRuleLeadingOffGrid:  return "BGA002";
+        default:                   return "BGA000";
+    }
+}
+
+const char* AlignmentFindingFormatter::GetRuleMessage(AlignmentRule rule, FindingLanguage language)
+{
+    const bool english = language == kFindingLanguageEnglish;
+    switch (rule) {
+        case kRuleBaselineOffGrid: return english ? "Baseline off grid" : "Nesprávná baseline";
+        case kRuleLeadingOffGrid:  return english ? "Leading off grid" : "Nesprávný leading";
+        default:                   return english ? "Unknown problem" : "Neznámý problém";
+    }
+}
+
+std::string AlignmentFindingFormatter::Format(const AlignmentFinding& finding, FindingLanguage language)
+{
+    const bool english = language == kFindingLanguageEnglish;
+
+    std::string message = GetRuleMessage(finding.fRule, language);
+    message += english ? " at position " : " na pozici ";
+    message += std::to_string(finding.fTextIndex);
+    message += english ? " (measured " : " (naměřeno ";
+    message += FormatPoints(finding.fMeasured, language);
+    message += english ? ", expected " : ", očekáváno ";
+    message += FormatPoints(finding.fExpected, language);
+    message += ")";
+    return message;
+}
+
+std::string AlignmentFindingFormatter::FormatGroup(const AlignmentFindingGroup& group, const std::string& styleName,
+                                                   FindingLanguage language)
+{
+    const bool english = language == kFindingLanguageEnglish;
+
+    std::string message = GetRuleCode(group.fRule);
+    message += " ";
+    message += GetRuleMessage(group.fRule, language);
+    message += ": ";
+    message += std::to_string(group.fCount);
+    message += english ? " times" : "×";
+
+    if (group.IsOverflow()) {
+        message += english ? " in other styles and ranges" : " v dalších stylech a rozsazích";
+    }
+    else {
+        if (!styleName.empty()) {
+            message += english ? ", style \"" : ", styl „";
+            message += styleName;
+            message += english ? "\"" : "“";
+        }
+
+        // Deviation bucket, as in MisalignmentHistogram
+        const GridFixed lower = group.fBucket == 0 ? 0 : (kGridFixedScale / 4) << (group.fBucket - 1);
+        message += english ? ", range " : ", pásmo ";
+        if (group.fBucket == 0) {
+            message += "< " + FormatPoints(kGridFixedScale / 4, language);
+        }
+        else if (group.fBucket == MisalignmentHistogram::kBucketCount - 1) {
+            message += "≥ " + FormatPoints(lower, language);
+        }
+        else {
+            message += FormatPoints(lower, language) + " – " + FormatPoints(lower * 2, language);
+        }
+    }
+
+    message += english ? " (deviation " : " (odchylka ";
+    message += FormatPoints(group.fMinDeviation, language);
+    if (group.fMaxDeviation != group.fMinDeviation) {
+        message += english ? " to " : " až ";
+        message += FormatPoints(group.fMaxDeviation, language);
+    }
+    message += english ? "; first at position " : "; poprvé na pozici ";
+    for (int32_t i = 0; i < group.fFirstCount; i++) {
+        if (i > 0) message += ", ";
+        message += std::to_string(group.fFirst[i].fTextIndex);
+    }
+    message += ")";
+    return message;
+}
+
+std::string AlignmentFindingFormatter::FormatPoints(GridFixed value, FindingLanguage language)
+{
+    char buffer[32];
+    snprintf(buffer, sizeof(buffer), "%.3f", FromGridFixed(value));
+
+    // Drop trailing zeros, Czech uses a decimal comma
+    std::string text(buffer);
+    const size_t point = text.find('.');
+    if (point != std::string::npos) {
+        size_t last = text.find_last_not_of('0');
+        if (last == point) last--;
+        text.erase(last + 1);
+        if (language == kFindingLanguageCzech && last > point) {
+            text[point] = ',';
+        }
+    }
+    return text + " pt";
+}
@@ -0,0 +1,235 @@
+#include "includes/AlignmentFingerprintCache.h"
+
+#include <cstring>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+AlignmentFingerprintCache::AlignmentFingerprintCache()
+    : fHeader(nullptr),
+      fEntries(nullptr),
+      fMappedSize(0),
+#ifdef _WIN32
+      fFile(INVALID_HANDLE_VALUE),
+      fMapping(nullptr)
+#else
+      fFile(-1)
+#endif
+{
+}
+
+AlignmentFingerprintCache::~AlignmentFingerprintCache()
+{
+    Close();
+}
+
+bool AlignmentFingerprintCache::Open(const std::string& path)
+{
+    Close();
+
+#ifdef _WIN32
+    fFile = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr,
+                        OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (fFile == INVALID_HANDLE_VALUE) return false;
+
+    LARGE_INTEGER fileSize;
+    const uint64_t size = GetFileSizeEx(fFile, &fileSize) ? static_cast<uint64_t>(fileSize.QuadPart) : 0;
+#else
+    fFile = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fFile < 0) return false;
+
+    struct stat fileStat;
+    const uint64_t size = fstat(fFile, &fileStat) == 0 ? static_cast<uint64_t>(fileStat.st_size) : 0;
+#endif
+
+    fPath = path;
+
+    // Reuse an existing table only if it was written by this version
+    if (size >= FileSize(kInitialCapacity)) {
+        const uint64_t capacity = (size - sizeof(Header)) / sizeof(Entry);
+        if (Map(capacity, false)) {
+            const bool valid = fHeader->fMagic == kMagic &&
+                               fHeader->fVersion == kVersion &&
+                               fHeader->fCapacity == capacity &&
+                               (capacity & (capacity - 1)) == 0 &&
+                               capacity <= kMaxCapacity &&
+                               fHeader->fCount < capacity;
+            if (valid) return true;
+            Unmap();
+        }
+    }
+
+    if (!Map(kInitialCapacity, true)) {
+        Close();
+        return false;
+    }
+    return true;
+}
+
+void AlignmentFingerprintCache::Close()
+{
+    Unmap();
+
+#ifdef _WIN32
+    if (fFile != INVALID_HANDLE_VALUE) {
+        CloseHandle(fFile);
+        fFile = INVALID_HANDLE_VALUE;
+    }
+#else
+    if (fFile >= 0) {
+        close(fFile);
+        fFile = -1;
+    }
+#endif
+
+    fPath.clear();
+}
+
+bool AlignmentFingerprintCache::Map(uint64_t capacity, bool reset)
+{
+    const size_t size = FileSize(capacity);
+
+#ifdef _WIN32
+    fMapping = CreateFileMappingA(fFile, nullptr, PAGE_READWRITE,
+                                  static_cast<DWORD>(static_cast<uint64_t>(size) >> 32),
+                                  static_cast<DWORD>(size & 0xFFFFFFFF), nullptr);
+    if (!fMapping) return false;
+
+    void* view = MapViewOfFile(fMapping, FILE_MAP_ALL_ACCESS, 0, 0, size);
+    if (!view) {
+        CloseHandle(fMapping);
+        fMapping = nullptr;
+        return false;
+    }
+#else
+    if (reset && ftruncate(fFile, static_cast<off_t>(size)) != 0) return false;
+
+    void* view = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fFile, 0);
+    if (view == MAP_FAILED) return false;
+#endif
+
+    fHeader = static_cast<Header*>(view);
+    fEntries = reinterpret_cast<Entry*>(static_cast<char*>(view) + sizeof(Header));
+    fMappedSize = size;
+
+    if (reset) {
+        memset(view, 0, size);
+        fHeader->fMagic = kMagic;
+        fHeader->fVersion = kVersion;
+        fHeader->fCapacity = capacity;
+        fHeader->fCount = 0;
+    }
+    return true;
+}
+
+void AlignmentFingerprintCache::Unmap()
+{
+    if (!fHeader) return;
+
+#ifdef _WIN32
+    UnmapViewOfFile(fHeader);
+    CloseHandle(fMapping);
+    fMapping = nullptr;
+#else
+    munmap(fHeader, fMappedSize);
+#endif
+
+    fHeader = nullptr;
+    fEntries = nullptr;
+    fMappedSize = 0;
+}
+
+bool AlignmentFingerprintCache::Grow()
+{
+    std::vector<Entry> entries;
+    entries.reserve(static_cast<size_t>(fHeader->fCount));
+    for (uint64_t i = 0; i < fHeader->fCapacity; i++) {
+        if (fEntries[i].fKey != 0) {
+            entries.push_back(fEntries[i]);
+        }
+    }
+
+    const uint64_t capacity = fHeader->fCapacity * 2;
+    Unmap();
+    if (!Map(capacity, true)) return false;
+
+    for (const Entry& entry : entries) {
+        Entry* slot = Find(entry.fKey);
+        *slot = entry;
+        fHeader->fCount++;
+    }
+    return true;
+}
+
+AlignmentFingerprintCache::Entry* AlignmentFingerprintCache::Find(uint64_t key) const
+{
+    // Keys are hashes already; the load factor keeps an empty slot reachable
+    const uint64_t mask = fHeader->fCapacity - 1;
+    uint64_t index = key & mask;
+    while (fEntries[index].fKey != 0 && fEntries[index].fKey != key) {
+        index = (index + 1) & mask;
+    }
+    return &fEntries[index];
+}
+
+uint64_t AlignmentFingerprintCache::Get(uint64_t key) const
+{
+    if (!fHeader || key == 0) return 0;
+
+    const Entry* entry = Find(key);
+    return entry->fKey == key ? entry->fValue : 0;
+}
+
+void AlignmentFingerprintCache::Store(uint64_t key, uint64_t value)
+{
+    if (!fHeader || key == 0) return;
+
+    Entry* entry = Find(key);
+    if (entry->fKey == 0) {
+        // Keep the table at most 70 % full; a full table at the cap is mostly stale keys
+        if ((fHeader->fCount + 1) * 10 > fHeader->fCapacity * 7) {
+            if (fHeader->fCapacity >= kMaxCapacity) {
+                Clear();
+            }
+            else if (!Grow()) {
+                Close();
+                return;
+            }
+            entry = Find(key);
+        }
+        entry->fKey = key;
+        fHeader->fCount++;
+    }
+    entry->fValue = value;
+}
+
+void AlignmentFingerprintCache::Clear()
+{
+    if (!fHeader) return;
+
+    memset(fEntries, 0, static_cast<size_t>(fHeader->fCapacity) * sizeof(Entry));
+    fHeader->fCount = 0;
+}
+
+void AlignmentFingerprintCache::Flush()
+{
+    if (!fHeader) return;
+
+#ifdef _WIN32
+    FlushViewOfFile(fHeader, 0);
+#else
+    msync(fHeader, fMappedSize, MS_ASYNC);
+#endif
+}
+
+size_t AlignmentFingerprintCache::GetCount() const
+{
+    return fHeader ? static_cast<size_t>(fHeader->fCount) : 0;
+}
@@ -0,0 +1,500 @@
+#include "includes/AlignmentRecorder.h"
+#include "includes/AlignmentTrace.h"
+
+#include <cstring>
+
+namespace {
+
+const uint32_t kRecordingMagic = 0x52414742; // "BGAR"
+const uint32_t kRecordingVersion = 3;
+
+// Grid marker bytes: the item keeps the previous grid or carries a new one
+const uint8_t kGridSame = 0;
+const uint8_t kGridNew = 1;
+
+void PutUnsigned(std::vector<uint8_t>& out, uint64_t value)
+{
+    while (value >= 0x80) {
+        out.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+void PutSigned(std::vector<uint8_t>& out, int64_t value)
+{
+    PutUnsigned(out, (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63));
+}
+
+void PutDouble(std::vector<uint8_t>& out, double value)
+{
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    for (int i = 0; i < 8; i++) {
+        out.push_back(static_cast<uint8_t>(bits >> (i * 8)));
+    }
+}
+
+void PutFixed32(std::vector<uint8_t>& out, uint32_t value)
+{
+    for (int i = 0; i < 4; i++) {
+        out.push_back(static_cast<uint8_t>(value >> (i * 8)));
+    }
+}
+
+void PutGrid(std::vector<uint8_t>& out, const BaselineGrid& grid, BaselineGrid& previous)
+{
+    if (grid == previous) {
+        out.push_back(kGridSame);
+        return;
+    }
+    out.push_back(kGridNew);
+    PutSigned(out, grid.fIncrement);
+    PutSigned(out, grid.fStart);
+    previous = grid;
+}
+
+// Bounds-checked decoding; after the first overrun every read returns 0 and Ok() is false
+class ByteReader {
+public:
+    ByteReader(const uint8_t* data, size_t size)
+        : fData(data), fSize(size), fPosition(0), fOk(true)
+    {
+    }
+
+    bool Ok() const { return fOk; }
+    size_t Position() const { return fPosition; }
+
+    uint8_t Byte() {
+        if (fPosition >= fSize) {
+            fOk = false;
+            return 0;
+        }
+        return fData[fPosition++];
+    }
+
+    uint64_t Unsigned() {
+        uint64_t value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            const uint8_t byte = Byte();
+            value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            if ((byte & 0x80) == 0) return value;
+        }
+        fOk = false;
+        return 0;
+    }
+
+    int64_t Signed() {
+        const uint64_t value = Unsigned();
+        return static_cast<int64_t>((value >> 1) ^ (~(value & 1) + 1));
+    }
+
+    double Double() {
+        uint64_t bits = 0;
+        for (int i = 0; i < 8; i++) {
+            bits |= static_cast<uint64_t>(Byte()) << (i * 8);
+        }
+        double value;
+        memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+    uint32_t Fixed32() {
+        uint32_t value = 0;
+        for (int i = 0; i < 4; i++) {
+            value |= static_cast<uint32_t>(Byte()) << (i * 8);
+        }
+        return value;
+    }
+
+    BaselineGrid Grid(BaselineGrid& previous) {
+        if (Byte() == kGridNew) {
+            previous.fIncrement = Signed();
+            previous.fStart = Signed();
+        }
+        return previous;
+    }
+
+    // Item counts come from the file; never reserve more than the payload could hold
+    size_t Count() {
+        const uint64_t count = Unsigned();
+        if (count > fSize - fPosition) {
+            fOk = false;
+            return 0;
+        }
+        return static_cast<size_t>(count);
+    }
+
+private:
+    const uint8_t* fData;
+    size_t fSize;
+    size_t fPosition;
+    bool fOk;
+};
+
+} // namespace
+
+AlignmentRecorder& AlignmentRecorder::Instance()
+{
+    static AlignmentRecorder sInstance;
+    return sInstance;
+}
+
+AlignmentRecorder::AlignmentRecorder()
+    : fRecording(false),
+      fFile(nullptr),
+      fStartMicros(0),
+      fRunStartMicros(0)
+{
+}
+
+AlignmentRecorder::~AlignmentRecorder()
+{
+    Stop();
+}
+
+bool AlignmentRecorder::Start(const std::string& path)
+{
+    Stop();
+
+    std::lock_guard<std::mutex> lock(fMutex);
+    fFile = fopen(path.c_str(), "wb");
+    if (!fFile) return false;
+
+    std::vector<uint8_t> header;
+    PutFixed32(header, kRecordingMagic);
+    PutFixed32(header, kRecordingVersion);
+    fwrite(header.data(), 1, header.size(), fFile);
+
+    fStartMicros = AlignmentTrace::NowMicros();
+    fRecording.store(true, std::memory_order_relaxed);
+    return true;
+}
+
+void AlignmentRecorder::Stop()
+{
+    std::lock_guard<std::mutex> lock(fMutex);
+    fRecording.store(false, std::memory_order_relaxed);
+    if (fFile) {
+        fclose(fFile);
+        fFile = nullptr;
+    }
+}
+
+uint64_t AlignmentRecorder::ElapsedMicros() const
+{
+    return AlignmentTrace::NowMicros() - fStartMicros;
+}
+
+void AlignmentRecorder::BeginRecord()
+{
+    fPayload.clear();
+}
+
+void AlignmentRecorder::EndRecord(RecordType type)
+{
+    // Stop() may have closed the file since the caller checked IsRecording()
+    if (!fFile) return;
+
+    fFrame.clear();
+    fFrame.push_back(static_cast<uint8_t>(type));
+    PutUnsigned(fFrame, fPayload.size());
+    fwrite(fFrame.data(), 1, fFrame.size(), fFile);
+    fwrite(fPayload.data(), 1, fPayload.size(), fFile);
+}
+
+void AlignmentRecorder::RecordNotification(RecordedNotification notification, uint32_t subject)
+{
+    if (!IsRecording()) return;
+
+    std::lock_guard<std::mutex> lock(fMutex);
+    BeginRecord();
+    PutUnsigned(fPayload, ElapsedMicros());
+    PutUnsigned(fPayload, static_cast<uint64_t>(notification));
+    PutUnsigned(fPayload, subject);
+    EndRecord(kRecordNotification);
+}
+
+void AlignmentRecorder::RecordRunBegin(RecordedRunKind kind, const RecordedSettings& settings,
+                                       const BaselineGrid& documentGrid)
+{
+    if (!IsRecording()) return;
+
+    std::lock_guard<std::mutex> lock(fMutex);
+    fRunStartMicros = ElapsedMicros();
+    BeginRecord();
+    PutUnsigned(fPayload, fRunStartMicros);
+    PutUnsigned(fPayload, static_cast<uint64_t>(kind));
+    PutSigned(fPayload, settings.fAlignmentType);
+    PutDouble(fPayload, settings.fWordSpacingFactor);
+    PutSigned(fPayload, settings.fLeadingMultiple);
+    PutSigned(fPayload, documentGrid.fIncrement);
+    PutSigned(fPayload, documentGrid.fStart);
+    EndRecord(kRecordRunBegin);
+}
+
+void AlignmentRecorder::RecordRunEnd()
+{
+    if (!IsRecording()) return;
+
+    std::lock_guard<std::mutex> lock(fMutex);
+    const uint64_t now = ElapsedMicros();
+    BeginRecord();
+    PutUnsigned(fPayload, now);
+    PutUnsigned(fPayload, now >= fRunStartMicros ? now - fRunStartMicros : 0);
+    EndRecord(kRecordRunEnd);
+    if (fFile) {
+        fflush(fFile);
+    }
+}
+
+void AlignmentRecorder::RecordParcels(uint32_t story, const ParcelOffset* parcels, size_t count)
+{
+    if (!IsRecording()) return;
+
+    std::lock_guard<std::mutex> lock(fMutex);
+    BeginRecord();
+    PutUnsigned(fPayload, story);
+    PutUnsigned(fPayload, count);
+
+    int64_t previousEnd = 0;
+    BaselineGrid previousGrid = BaselineGrid();
+    for (size_t i = 0; i < count; i++) {
+        const ParcelOffset& parcel = parcels[i];
+        PutSigned(fPayload, parcel.fStart - previousEnd);
+        PutUnsigned(fPayload, static_cast<uint32_t>(parcel.fLength));
+        PutSigned(fPayload, parcel.fOffset);
+        PutGrid(fPayload, parcel.fGrid, previousGrid);
+        previousEnd = static_cast<int64_t>(parcel.fStart) + parcel.fLength;
+    }
+    EndRecord(kRecordParcels);
+}
+
+void AlignmentRecorder::RecordLines(uint32_t story, const BaselineLineMetrics& lines,
+                                    const ArenaVector<BaselineGrid>& lineGrids)
+{
+    if (!IsRecording()) return;
+
+    std::lock_guard<std::mutex> lock(fMutex);
+    BeginRecord();
+    PutUnsigned(fPayload, story);
+    PutUnsigned(fPayload, lines.Size());
+
+    int64_t previousEnd = 0;
+    GridFixed previousY = 0;
+    BaselineGrid previousGrid = BaselineGrid();
+    for (size_t i = 0; i < lines.Size(); i++) {
+        PutSigned(fPayload, lines.fTextIndex[i] - previousEnd);
+        PutUnsigned(fPayload, static_cast<uint32_t>(lines.fTextSpan[i]));
+        PutSigned(fPayload, lines.fBaselineY[i] - previousY);
+        PutSigned(fPayload, lines.fLineHeight[i]);
+        PutSigned(fPayload, lines.fBaselineShift[i]);
+        PutGrid(fPayload, lineGrids[i], previousGrid);
+        previousEnd = static_cast<int64_t>(lines.fTextIndex[i]) + lines.fTextSpan[i];
+        previousY = lines.fBaselineY[i];
+    }
+    EndRecord(kRecordLines);
+}
+
+void AlignmentRecorder::RecordStyleRuns(uint32_t story, const StyleRunSnapshot* runs, size_t count)
+{
+    if (!IsRecording()) return;
+
+    std::lock_guard<std::mutex> lock(fMutex);
+    BeginRecord();
+    PutUnsigned(fPayload, story);
+    PutUnsigned(fPayload, count);
+
+    int64_t previousEnd = 0;
+    for (size_t i = 0; i < count; i++) {
+        const StyleRunSnapshot& run = runs[i];
+        PutSigned(fPayload, run.fStart - previousEnd);
+        PutSigned(fPayload, run.fLength);
+        PutSigned(fPayload, run.fFontSize);
+        PutDouble(fPayload, run.fTracking);
+        PutDouble(fPayload, run.fWordSpacing);
+        PutDouble(fPayload, run.fBaseTracking);
+        PutDouble(fPayload, run.fBaseWordSpacing);
+        PutSigned(fPayload, run.fLeading);
+        PutSigned(fPayload, run.fGridIncrement);
+        // Unreadable runs have length 0 and must not move the next start
+        previousEnd = static_cast<int64_t>(run.fStart) + (run.fLength > 0 ? run.fLength : 0);
+    }
+    EndRecord(kRecordStyleRuns);
+}
+
+void AlignmentRecorder::RecordResult(uint32_t story, size_t changeCount, uint64_t checksum)
+{
+    if (!IsRecording()) return;
+
+    std::lock_guard<std::mutex> lock(fMutex);
+    BeginRecord();
+    PutUnsigned(fPayload, story);
+    PutUnsigned(fPayload, changeCount);
+    PutUnsigned(fPayload, checksum);
+    EndRecord(kRecordResult);
+}
+
+AlignmentRecordingReader::AlignmentRecordingReader()
+    : fPosition(0),
+      fDamaged(false)
+{
+}
+
+bool AlignmentRecordingReader::Open(const std::string& path)
+{
+    fData.clear();
+    fPosition = 0;
+    fDamaged = false;
+
+    FILE* file = fopen(path.c_str(), "rb");
+    if (!file) return false;
+
+    uint8_t buffer[1 << 16];
+    size_t read;
+    while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        fData.insert(fData.end(), buffer, buffer + read);
+    }
+    fclose(file);
+
+    ByteReader header(fData.data(), fData.size());
+    const uint32_t magic = header.Fixed32();
+    const uint32_t version = header.Fixed32();
+    if (!header.Ok() || magic != kRecordingMagic || version != kRecordingVersion) {
+        fData.clear();
+        return false;
+    }
+
+    fPosition = 8;
+    return true;
+}
+
+bool AlignmentRecordingReader::Next(RecordedEvent& event)
+{
+    while (fPosition < fData.size()) {
+        ByteReader frame(fData.data() + fPosition, fData.size() - fPosition);
+        const uint8_t type = frame.Byte();
+        const uint64_t payloadSize = frame.Unsigned();
+        const size_t frameHeader = frame.Position();
+
+        if (!frame.Ok() || payloadSize > fData.size() - fPosition - frameHeader) {
+            fDamaged = true;
+            fPosition = fData.size();
+            return false;
+        }
+
+        ByteReader in(fData.data() + fPosition + frameHeader, static_cast<size_t>(payloadSize));
+        fPosition += frameHeader + static_cast<size_t>(payloadSize);
+
+        event.fType = static_cast<RecordType>(type);
+        switch (type) {
+            case kRecordNotification:
+                event.fTimeMicros = in.Unsigned();
+                event.fKind = static_cast<int32_t>(in.Unsigned());
+                event.fStory = static_cast<uint32_t>(in.Unsigned());
+                break;
+
+            case kRecordRunBegin:
+                event.fTimeMicros = in.Unsigned();
+                event.fKind = static_cast<int32_t>(in.Unsigned());
+                event.fSettings.fAlignmentType = static_cast<int32_t>(in.Signed());
+                event.fSettings.fWordSpacingFactor = in.Double();
+                event.fSettings.fLeadingMultiple = static_cast<int32_t>(in.Signed());
+                event.fDocumentGrid.fIncrement = in.Signed();
+                event.fDocumentGrid.fStart = in.Signed();
+                break;
+
+            case kRecordRunEnd:
+                event.fTimeMicros = in.Unsigned();
+                event.fDurationMicros = in.Unsigned();
+                break;
+
+            case kRecordParcels: {
+                event.fStory = static_cast<uint32_t>(in.Unsigned());
+                const size_t count = in.Count();
+                event.fParcels.clear();
+                event.fParcels.reserve(count);
+
+                int64_t previousEnd = 0;
+                BaselineGrid previousGrid = BaselineGrid();
+                for (size_t i = 0; i < count && in.Ok(); i++) {
+                    ParcelOffset parcel;
+                    parcel.fStart = static_cast<int32_t>(previousEnd + in.Signed());
+                    parcel.fLength = static_cast<int32_t>(in.Unsigned());
+                    parcel.fOffset = in.Signed();
+                    parcel.fGrid = in.Grid(previousGrid);
+                    event.fParcels.push_back(parcel);
+                    previousEnd = static_cast<int64_t>(parcel.fStart) + parcel.fLength;
+                }
+                break;
+            }
+
+            case kRecordLines: {
+                event.fStory = static_cast<uint32_t>(in.Unsigned());
+                const size_t count = in.Count();
+                event.fLines = BaselineLineMetrics();
+                event.fLines.Reserve(count);
+                event.fLineGrids.clear();
+                event.fLineGrids.reserve(count);
+
+                int64_t previousEnd = 0;
+                GridFixed previousY = 0;
+                BaselineGrid previousGrid = BaselineGrid();
+                for (size_t i = 0; i < count && in.Ok(); i++) {
+                    const int32_t textIndex = static_cast<int32_t>(previousEnd + in.Signed());
+                    const int32_t textSpan = static_cast<int32_t>(in.Unsigned());
+                    const GridFixed baselineY = previousY + in.Signed();
+                    const GridFixed lineHeight = in.Signed();
+                    const GridFixed baselineShift = in.Signed();
+                    event.fLines.Append(textIndex, textSpan, baselineY, lineHeight, baselineShift);
+                    event.fLineGrids.push_back(in.Grid(previousGrid));
+                    previousEnd = static_cast<int64_t>(textIndex) + textSpan;
+                    previousY = baselineY;
+                }
+                break;
+            }
+
+            case kRecordStyleRuns: {
+                event.fStory = static_cast<uint32_t>(in.Unsigned());
+                const size_t count = in.Count();
+                event.fRuns.clear();
+                event.fRuns.reserve(count);
+
+                int64_t previousEnd = 0;
+                for (size_t i = 0; i < count && in.Ok(); i++) {
+                    StyleRunSnapshot run;
+                    run.fStart = static_cast<int32_t>(previousEnd + in.Signed());
+                    run.fLength = static_cast<int32_t>(in.Signed());
+                    run.fFontSize = in.Signed();
+                    run.fTracking = in.Double();
+                    run.fWordSpacing = in.Double();
+                    run.fBaseTracking = in.Double();
+                    run.fBaseWordSpacing = in.Double();
+                    run.fLeading = in.Signed();
+                    run.fGridIncrement = in.Signed();
+                    event.fRuns.push_back(run);
+                    previousEnd = static_cast<int64_t>(run.fStart) + (run.fLength > 0 ? run.fLength : 0);
+                }
+                break;
+            }
+
+            case kRecordResult:
+                event.fStory = static_cast<uint32_t>(in.Unsigned());
+                event.fChangeCount = in.Unsigned();
+                event.fChecksum = in.Unsigned();
+                break;
+
+            default:
+                // Written by a newer version; skip it
+                continue;
+        }
+
+        if (!in.Ok()) {
+            fDamaged = true;
+            fPosition = fData.size();
+            return false;
+        }
+        return true;
+    }
+    return false;
+}
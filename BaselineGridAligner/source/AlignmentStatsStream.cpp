@@ -0,0 +1,247 @@
+#include "includes/AlignmentStatsStream.h"
+
+#include <chrono>
+#include <cstring>
+#include <new>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+uint64_t WallClockMillis()
+{
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count());
+}
+
+} // namespace
+
+AlignmentStatsStream& AlignmentStatsStream::Instance()
+{
+    static AlignmentStatsStream sInstance;
+    return sInstance;
+}
+
+AlignmentStatsStream::AlignmentStatsStream()
+    : fRing(nullptr),
+#ifdef _WIN32
+      fFile(INVALID_HANDLE_VALUE),
+      fMapping(nullptr),
+#else
+      fFile(-1),
+#endif
+      fRunID(0),
+      fRunStartMicros(0),
+      fLastPublishMicros(0),
+      fRunKind(0),
+      fAlignmentType(0),
+      fProgressPermille(0)
+{
+    for (std::atomic<uint64_t>& count : fHistogram) {
+        count.store(0, std::memory_order_relaxed);
+    }
+}
+
+AlignmentStatsStream::~AlignmentStatsStream()
+{
+    Close();
+}
+
+bool AlignmentStatsStream::Open(const std::string& path)
+{
+    if (fRing && fPath == path) return true;
+
+    Close();
+
+#ifdef _WIN32
+    // Readers open the file while it is mapped here
+    fFile = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE,
+                        nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (fFile == INVALID_HANDLE_VALUE) return false;
+#else
+    fFile = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fFile < 0) return false;
+#endif
+
+    if (!Map()) {
+        Close();
+        return false;
+    }
+    fPath = path;
+    return true;
+}
+
+void AlignmentStatsStream::Close()
+{
+    // Wait for a publisher still writing into the mapping
+    while (fPublishing.test_and_set(std::memory_order_acquire)) {
+    }
+
+    Unmap();
+
+#ifdef _WIN32
+    if (fFile != INVALID_HANDLE_VALUE) {
+        CloseHandle(fFile);
+        fFile = INVALID_HANDLE_VALUE;
+    }
+#else
+    if (fFile >= 0) {
+        close(fFile);
+        fFile = -1;
+    }
+#endif
+
+    fPath.clear();
+    fPublishing.clear(std::memory_order_release);
+}
+
+bool AlignmentStatsStream::Map()
+{
+    const size_t size = sizeof(Ring);
+
+#ifdef _WIN32
+    fMapping = CreateFileMappingA(fFile, nullptr, PAGE_READWRITE, 0, static_cast<DWORD>(size), nullptr);
+    if (!fMapping) return false;
+
+    void* view = MapViewOfFile(fMapping, FILE_MAP_ALL_ACCESS, 0, 0, size);
+    if (!view) {
+        CloseHandle(fMapping);
+        fMapping = nullptr;
+        return false;
+    }
+#else
+    if (ftruncate(fFile, static_cast<off_t>(size)) != 0) return false;
+
+    void* view = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fFile, 0);
+    if (view == MAP_FAILED) return false;
+#endif
+
+    // A stream starts empty; a reader notices the new stream ID and starts over
+    memset(view, 0, size);
+    fRing = new (view) Ring;
+    fRing->fWriteIndex.store(0, std::memory_order_relaxed);
+    for (AlignmentStatsRecord& slot : fRing->fSlots) {
+        slot.fSequence.store(0, std::memory_order_relaxed);
+    }
+
+    Header& header = fRing->fHeader;
+    header.fVersion = kVersion;
+    header.fSlotCount = kSlotCount;
+    header.fSlotSize = sizeof(AlignmentStatsRecord);
+    header.fCounterCount = kCounterCount;
+    header.fBucketCount = MisalignmentHistogram::kBucketCount;
+    header.fStreamID = AlignmentCounters::NowMicros() ^ (WallClockMillis() << 20);
+
+    // The magic goes last, so a reader never accepts a half-initialized header
+    std::atomic_thread_fence(std::memory_order_release);
+    header.fMagic = kMagic;
+    return true;
+}
+
+void AlignmentStatsStream::Unmap()
+{
+    if (!fRing) return;
+
+#ifdef _WIN32
+    UnmapViewOfFile(fRing);
+    CloseHandle(fMapping);
+    fMapping = nullptr;
+#else
+    munmap(fRing, sizeof(Ring));
+#endif
+
+    fRing = nullptr;
+}
+
+void AlignmentStatsStream::BeginRun(AlignmentStatsRunKind kind, int32_t alignmentType)
+{
+    for (std::atomic<uint64_t>& count : fHistogram) {
+        count.store(0, std::memory_order_relaxed);
+    }
+    fRunID.fetch_add(1, std::memory_order_relaxed);
+    fRunKind.store(kind, std::memory_order_relaxed);
+    fAlignmentType.store(alignmentType, std::memory_order_relaxed);
+    fProgressPermille.store(0, std::memory_order_relaxed);
+
+    const uint64_t now = AlignmentCounters::NowMicros();
+    fRunStartMicros.store(now, std::memory_order_relaxed);
+    fLastPublishMicros.store(now, std::memory_order_relaxed);
+
+    Publish(kStatsRunBegin, true);
+}
+
+void AlignmentStatsStream::EndRun()
+{
+    fProgressPermille.store(1000, std::memory_order_relaxed);
+    Publish(kStatsRunEnd, true);
+}
+
+void AlignmentStatsStream::PublishProgress(float progress)
+{
+    if (!fRing) return;
+
+    const uint64_t now = AlignmentCounters::NowMicros();
+    uint64_t last = fLastPublishMicros.load(std::memory_order_relaxed);
+    if (now - last < kProgressIntervalMicros) return;
+
+    // Of several threads due at once only one publishes
+    if (!fLastPublishMicros.compare_exchange_strong(last, now, std::memory_order_relaxed)) return;
+
+    const float clamped = progress < 0.0f ? 0.0f : (progress > 1.0f ? 1.0f : progress);
+    fProgressPermille.store(static_cast<uint32_t>(clamped * 1000.0f), std::memory_order_relaxed);
+    Publish(kStatsRunProgress, false);
+}
+
+void AlignmentStatsStream::AddHistogram(const MisalignmentHistogram& histogram)
+{
+    for (int i = 0; i < MisalignmentHistogram::kBucketCount; i++) {
+        if (histogram.fCounts[i] != 0) {
+            fHistogram[i].fetch_add(histogram.fCounts[i], std::memory_order_relaxed);
+        }
+    }
+}
+
+bool AlignmentStatsStream::Publish(AlignmentStatsKind kind, bool wait)
+{
+    if (!fRing) return false;
+
+    while (fPublishing.test_and_set(std::memory_order_acquire)) {
+        if (!wait) return false;
+    }
+
+    if (fRing) {
+        const uint64_t index = fRing->fWriteIndex.load(std::memory_order_relaxed);
+        AlignmentStatsRecord& slot = fRing->fSlots[index % kSlotCount];
+
+        // Odd sequence first: a reader that copied this slot meanwhile discards it
+        slot.fSequence.store(2 * index + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        const AlignmentCounters& counters = AlignmentCounters::Instance();
+        slot.fRunID = fRunID.load(std::memory_order_relaxed);
+        slot.fTimeMillis = WallClockMillis();
+        slot.fElapsedMicros = AlignmentCounters::NowMicros() - fRunStartMicros.load(std::memory_order_relaxed);
+        slot.fKind = kind;
+        slot.fRunKind = fRunKind.load(std::memory_order_relaxed);
+        slot.fAlignmentType = fAlignmentType.load(std::memory_order_relaxed);
+        slot.fProgressPermille = fProgressPermille.load(std::memory_order_relaxed);
+        for (int i = 0; i < AlignmentStatsRecord::kMaxCounters; i++) {
+            slot.fCounters[i] = i < kCounterCount ? counters.Get(static_cast<AlignmentCounter>(i)) : 0;
+        }
+        for (int i = 0; i < MisalignmentHistogram::kBucketCount; i++) {
+            slot.fHistogram[i] = fHistogram[i].load(std::memory_order_relaxed);
+        }
+
+        slot.fSequence.store(2 * index + 2, std::memory_order_release);
+        fRing->fWriteIndex.store(index + 1, std::memory_order_release);
+    }
+
+    fPublishing.clear(std::memory_order_release);
+    return true;
+}
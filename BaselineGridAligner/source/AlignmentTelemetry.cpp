@@ -0,0 +1,181 @@
+#include "includes/AlignmentTelemetry.h"
+
+#include <algorithm>
+
+namespace {
+
+const std::chrono::milliseconds kFlushInterval(static_cast<int64_t>(AlignmentTelemetry::kFlushIntervalMillis));
+
+// Nearest-rank percentile of sorted samples
+uint64_t Percentile(const std::vector<uint64_t>& sorted, uint32_t percent)
+{
+    if (sorted.empty()) return 0;
+    const size_t rank = (sorted.size() * percent + 99) / 100;
+    return sorted[rank > 0 ? rank - 1 : 0];
+}
+
+} // namespace
+
+AlignmentTelemetryQueue::AlignmentTelemetryQueue()
+    : fEnqueue(0),
+      fDequeue(0)
+{
+    for (size_t i = 0; i < kCapacity; i++) {
+        fCells[i].fSequence.store(i, std::memory_order_relaxed);
+    }
+}
+
+bool AlignmentTelemetryQueue::TryPush(const AlignmentTelemetryRecord& record)
+{
+    uint64_t position = fEnqueue.load(std::memory_order_relaxed);
+    for (;;) {
+        Cell& cell = fCells[position & (kCapacity - 1)];
+        const uint64_t sequence = cell.fSequence.load(std::memory_order_acquire);
+        const int64_t difference = static_cast<int64_t>(sequence - position);
+
+        if (difference == 0) {
+            // The cell is free for this position; claim it
+            if (fEnqueue.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                cell.fRecord = record;
+                cell.fSequence.store(position + 1, std::memory_order_release);
+                return true;
+            }
+        }
+        else if (difference < 0) {
+            // The consumer hasn't freed the cell from the previous lap
+            return false;
+        }
+        else {
+            position = fEnqueue.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+bool AlignmentTelemetryQueue::TryPop(AlignmentTelemetryRecord& record)
+{
+    const uint64_t position = fDequeue.load(std::memory_order_relaxed);
+    Cell& cell = fCells[position & (kCapacity - 1)];
+    if (cell.fSequence.load(std::memory_order_acquire) != position + 1) return false;
+
+    record = cell.fRecord;
+    cell.fSequence.store(position + kCapacity, std::memory_order_release);
+    fDequeue.store(position + 1, std::memory_order_relaxed);
+    return true;
+}
+
+AlignmentTelemetry& AlignmentTelemetry::Instance()
+{
+    static AlignmentTelemetry sInstance;
+    return sInstance;
+}
+
+AlignmentTelemetry::AlignmentTelemetry()
+    : fSampleSeed(0x9E3779B97F4A7C15ull),
+      fNextPublish(std::chrono::steady_clock::now() + kFlushInterval)
+{
+    for (std::atomic<uint64_t>& dropped : fDropped) {
+        dropped.store(0, std::memory_order_relaxed);
+    }
+}
+
+void AlignmentTelemetry::SetSink(const AlignmentTelemetrySink& sink)
+{
+    std::lock_guard<std::mutex> lock(fFlushMutex);
+    fSink = sink;
+}
+
+void AlignmentTelemetry::Log(AlignmentTelemetryEvent event, int64_t value, uint64_t durationMicros)
+{
+    const AlignmentTelemetryRecord record = { static_cast<uint32_t>(event), value, durationMicros };
+    if (!fQueue.TryPush(record)) {
+        fDropped[event].fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void AlignmentTelemetry::Forward()
+{
+    std::lock_guard<std::mutex> lock(fFlushMutex);
+
+    // The queue is drained on every call so it doesn't fill, the window is published on schedule
+    Drain();
+    const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    if (now >= fNextPublish) {
+        Publish();
+        fNextPublish = now + kFlushInterval;
+    }
+}
+
+void AlignmentTelemetry::Flush()
+{
+    std::lock_guard<std::mutex> lock(fFlushMutex);
+    Drain();
+    Publish();
+    fNextPublish = std::chrono::steady_clock::now() + kFlushInterval;
+}
+
+void AlignmentTelemetry::Drain()
+{
+    AlignmentTelemetryRecord record;
+    while (fQueue.TryPop(record)) {
+        if (record.fEvent >= kTelemetryEventCount) continue;
+
+        Window& window = fWindows[record.fEvent];
+        window.fCount++;
+        window.fValueSum += record.fValue;
+        window.fMaxDuration = std::max(window.fMaxDuration, record.fDurationMicros);
+
+        // Reservoir sampling keeps the percentiles unbiased with bounded memory
+        if (window.fDurations.size() < kMaxWindowSamples) {
+            window.fDurations.push_back(record.fDurationMicros);
+        }
+        else {
+            fSampleSeed ^= fSampleSeed << 13;
+            fSampleSeed ^= fSampleSeed >> 7;
+            fSampleSeed ^= fSampleSeed << 17;
+            const uint64_t slot = fSampleSeed % window.fCount;
+            if (slot < kMaxWindowSamples) {
+                window.fDurations[slot] = record.fDurationMicros;
+            }
+        }
+    }
+}
+
+void AlignmentTelemetry::Publish()
+{
+    for (int i = 0; i < kTelemetryEventCount; i++) {
+        Window& window = fWindows[i];
+        const uint64_t dropped = fDropped[i].exchange(0, std::memory_order_relaxed);
+        if (window.fCount == 0 && dropped == 0) continue;
+
+        std::sort(window.fDurations.begin(), window.fDurations.end());
+
+        AlignmentTelemetrySummary summary;
+        summary.fEvent = static_cast<AlignmentTelemetryEvent>(i);
+        summary.fCount = window.fCount;
+        summary.fValueSum = window.fValueSum;
+        summary.fDurationP50Micros = Percentile(window.fDurations, 50);
+        summary.fDurationP95Micros = Percentile(window.fDurations, 95);
+        summary.fDurationP99Micros = Percentile(window.fDurations, 99);
+        summary.fDurationMaxMicros = window.fMaxDuration;
+        summary.fDropped = dropped;
+
+        if (fSink) {
+            fSink(summary);
+        }
+
+        window.fCount = 0;
+        window.fValueSum = 0;
+        window.fMaxDuration = 0;
+        window.fDurations.clear();
+    }
+}
+
+const char* AlignmentTelemetry::GetName(AlignmentTelemetryEvent event)
+{
+    switch (event) {
+        case kTelemetryAlignerInitialize:   return "BaselineGridAligner:Initialize";
+        case kTelemetryAlignerShutdown:     return "BaselineGridAligner:Shutdown";
+        case kTelemetryAlign:               return "BaselineGridAligner:Align";
+        default:                            return "BaselineGridAligner:Unknown";
+    }
+}
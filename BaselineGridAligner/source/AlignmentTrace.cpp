@@ -0,0 +1,162 @@
+#include "includes/AlignmentTrace.h"
+
+#include <cstdio>
+#include <thread>
+#include <functional>
+
+std::atomic<bool> AlignmentTrace::sEnabled(true);
+
+namespace {
+
+// Spans kept per thread; older spans are overwritten
+const uint32_t kTraceRingSize = 8192;
+
+// A slot's sequence is 2 * i + 1 while span i is being written and 2 * i + 2
+// once it is complete, as in AlignmentStatsStream. The fields are relaxed
+// atomics, so the export can read a slot while its thread overwrites it.
+// Each span keeps the id of the thread that wrote it, as a ring passes from
+// an exited thread to a new one with the older thread's spans still in it.
+struct TraceEvent {
+    std::atomic<uint64_t> fSequence;
+    std::atomic<const char*> fName;
+    std::atomic<uint64_t> fStart;
+    std::atomic<uint64_t> fDuration;
+    std::atomic<uint64_t> fThreadId;
+};
+
+// Ring buffer owned by one thread at a time. Buffers are never freed;
+// a buffer released by an exiting thread is reused by the next new thread.
+struct TraceRing {
+    TraceEvent fEvents[kTraceRingSize];
+    std::atomic<uint64_t> fWriteCount;
+    std::atomic<bool> fInUse;
+    std::atomic<uint64_t> fThreadId;    // of the thread owning the ring now
+    TraceRing* fNext;
+};
+
+std::atomic<TraceRing*> sRingList(nullptr);
+
+TraceRing* AcquireRing()
+{
+    // Reuse a ring released by a finished thread
+    for (TraceRing* ring = sRingList.load(std::memory_order_acquire); ring; ring = ring->fNext) {
+        bool expected = false;
+        if (ring->fInUse.compare_exchange_strong(expected, true, std::memory_order_acq_rel)) {
+            return ring;
+        }
+    }
+
+    TraceRing* ring = new TraceRing();
+    ring->fWriteCount.store(0, std::memory_order_relaxed);
+    ring->fInUse.store(true, std::memory_order_relaxed);
+    ring->fNext = sRingList.load(std::memory_order_relaxed);
+    while (!sRingList.compare_exchange_weak(ring->fNext, ring,
+                                            std::memory_order_release, std::memory_order_relaxed)) {
+    }
+    return ring;
+}
+
+// Claims a ring for the current thread and gives it back on thread exit
+class ThreadRing {
+public:
+    ThreadRing() : fRing(AcquireRing()) {
+        fRing->fThreadId.store(static_cast<uint64_t>(std::hash<std::thread::id>()(std::this_thread::get_id()) & 0xFFFFFFFF),
+                               std::memory_order_relaxed);
+    }
+
+    ~ThreadRing() {
+        fRing->fInUse.store(false, std::memory_order_release);
+    }
+
+    TraceRing* fRing;
+};
+
+TraceRing* CurrentRing()
+{
+    thread_local ThreadRing threadRing;
+    return threadRing.fRing;
+}
+
+void WriteJsonString(FILE* file, const char* text)
+{
+    fputc('"', file);
+    for (const char* c = text; *c; c++) {
+        if (*c == '"' || *c == '\\') fputc('\\', file);
+        fputc(*c, file);
+    }
+    fputc('"', file);
+}
+
+} // namespace
+
+void AlignmentTrace::SetEnabled(bool enabled)
+{
+    sEnabled.store(enabled, std::memory_order_relaxed);
+}
+
+void AlignmentTrace::Record(const char* name, uint64_t startMicros, uint64_t durationMicros)
+{
+    if (!IsEnabled()) return;
+
+    TraceRing* ring = CurrentRing();
+    const uint64_t index = ring->fWriteCount.load(std::memory_order_relaxed);
+    TraceEvent& event = ring->fEvents[index % kTraceRingSize];
+
+    // Odd sequence first: an export reading this slot meanwhile discards it
+    event.fSequence.store(2 * index + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    event.fName.store(name, std::memory_order_relaxed);
+    event.fStart.store(startMicros, std::memory_order_relaxed);
+    event.fDuration.store(durationMicros, std::memory_order_relaxed);
+    event.fThreadId.store(ring->fThreadId.load(std::memory_order_relaxed), std::memory_order_relaxed);
+
+    event.fSequence.store(2 * index + 2, std::memory_order_release);
+    ring->fWriteCount.store(index + 1, std::memory_order_release);
+}
+
+bool AlignmentTrace::ExportChromeTrace(const std::string& path)
+{
+    FILE* file = fopen(path.c_str(), "w");
+    if (!file) return false;
+
+    fputs("{\"traceEvents\":[", file);
+    bool first = true;
+    for (TraceRing* ring = sRingList.load(std::memory_order_acquire); ring; ring = ring->fNext) {
+        const uint64_t written = ring->fWriteCount.load(std::memory_order_acquire);
+        const uint64_t begin = written > kTraceRingSize ? written - kTraceRingSize : 0;
+        for (uint64_t i = begin; i < written; i++) {
+            // Copy the span, then keep it only if its slot still holds span i, complete
+            const TraceEvent& event = ring->fEvents[i % kTraceRingSize];
+            const uint64_t sequence = event.fSequence.load(std::memory_order_acquire);
+            if (sequence != 2 * i + 2) continue;
+
+            const char* name = event.fName.load(std::memory_order_relaxed);
+            const uint64_t start = event.fStart.load(std::memory_order_relaxed);
+            const uint64_t duration = event.fDuration.load(std::memory_order_relaxed);
+            const uint64_t threadId = event.fThreadId.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (event.fSequence.load(std::memory_order_relaxed) != sequence) continue;
+
+            fputs(first ? "\n" : ",\n", file);
+            first = false;
+            fputs("{\"name\":", file);
+            WriteJsonString(file, name);
+            fprintf(file, ",\"cat\":\"align\",\"ph\":\"X\",\"ts\":%llu,\"dur\":%llu,\"pid\":1,\"tid\":%llu}",
+                    static_cast<unsigned long long>(start),
+                    static_cast<unsigned long long>(duration),
+                    static_cast<unsigned long long>(threadId));
+        }
+    }
+    fputs("\n],\"displayTimeUnit\":\"ms\"}\n", file);
+
+    const bool ok = ferror(file) == 0;
+    return fclose(file) == 0 && ok;
+}
+
+void AlignmentTrace::Clear()
+{
+    for (TraceRing* ring = sRingList.load(std::memory_order_acquire); ring; ring = ring->fNext) {
+        ring->fWriteCount.store(0, std::memory_order_release);
+    }
+}
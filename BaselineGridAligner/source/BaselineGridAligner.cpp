@@ -1,9 +1,34 @@
 #include "VCPlugInHeaders.h"
 #include "ITextModel.h"
 #include "ITextFrameColumn.h"
+#include "IBaselineFrameGridData.h"
+#include "ITextParcelList.h"
+#include "IWaxStrand.h"
+#include "IWaxIterator.h"
+#include "IWaxLine.h"
+#include "IAttributeStrand.h"
+#include "IStyleInfo.h"
+#include "ITextModelCmds.h"
+#include "ITextAttrRealNumber.h"
+#include "AttributeBossList.h"
 #include "TextID.h"
 #include "CmdUtils.h"
 #include "IGraphicsPort.h"
+#include "IDocument.h"
+#include "IDataBase.h"
+#include "FileUtils.h"
+#include "IStoryList.h"
+#include "ISpreadList.h"
+#include "IHierarchy.h"
+#include "IGeometry.h"
+#include "IMargins.h"
+#include "IFrameList.h"
+#include "ILayoutUIUtils.h"
+#include "ILayoutUtils.h"
+#include "ILayoutControlData.h"
+#include "IPanorama.h"
+#include "IControlView.h"
+#include "TransformUtils.h"
 #include "IDocumentGridData.h"
 #include "IApplicationPreferences.h"
 #include "IGPUAcceleration.h"
@@ -14,9 +39,31 @@
 #include "IUserInterface.h"
 #include "IAnalytics.h"
 #include "IErrorLog.h"
+#include "CIdleTask.h"
+#include "LocaleSetting.h"
+#include "PMLocaleId.h"
 #include "includes/BaselineGridAlignerID.h"
 #include "includes/BaselineGridAlignerSettings.h"
 #include "includes/DPIScaler.h"
+#include "includes/BaselineGridMath.h"
+#include "includes/BaselineGridScaleCache.h"
+#include "includes/BaselineGridStrategies.h"
+#include "includes/AlignmentTrace.h"
+#include "includes/AlignmentCounters.h"
+#include "includes/ParallelPolicy.h"
+#include "includes/ParallelFor.h"
+#include "includes/RunArena.h"
+#include "includes/AlignmentFindings.h"
+#include "includes/AlignmentFindingGroups.h"
+#include "includes/AlignmentFingerprintCache.h"
+#include "includes/FrameGridCache.h"
+#include "includes/AlignmentPipeline.h"
+#include "includes/AlignmentEngine.h"
+#include "includes/AlignmentParallelEngine.h"
+#include "includes/AlignmentRecorder.h"
+#include "includes/AlignmentStatsStream.h"
+#include "includes/AlignmentTelemetry.h"
+#include "includes/ViewportOrder.h"
 
 // Include OpenMP for parallelization
 #ifdef _OPENMP
@@ -28,6 +75,32 @@
 #include <algorithm>
 #include <future>
 #include <atomic>
+#include <cstdlib>
+#include <chrono>
+#include <mutex>
+#include <cstdio>
+#include <filesystem>
+#include <string>
+
+/**
+ * @class BaselineGridAlignerTelemetryTask
+ *
+ * Idle task forwarding queued telemetry on the main thread, where
+ * ITelemetry and IAnalytics may be used.
+ */
+class BaselineGridAlignerTelemetryTask : public CIdleTask {
+public:
+    BaselineGridAlignerTelemetryTask(IPMUnknown* boss) : CIdleTask(boss) {}
+    
+    uint32 RunTask(uint32 appFlags, IdleTimer* timeCheck) override {
+        AlignmentTelemetry::Instance().Forward();
+        return AlignmentTelemetry::kDrainIntervalMillis;
+    }
+    
+    const char* TaskName() override {
+        return "BaselineGridAligner:Telemetry";
+    }
+};
 
 /**
  * @class BaselineGridAligner
@@ -44,11 +117,18 @@ class BaselineGridAligner : public CPMUnknown<IPMUnknown, IObserver> {
 public:
     BaselineGridAligner(IPMUnknown* boss) 
         : CPMUnknown<IPMUnknown, IObserver>(boss),
-          fCachedGridSize(0.0), 
+          fCachedGridSize(0), 
+          fCachedGridStart(0),
+          fGridRelativeToMargin(false),
           fGridValid(false),
           fIsProcessing(false),
-          fPreviewActive(false)
+          fPreviewActive(false),
+          fRecorder(AlignmentRecorder::Instance()),
+          fStats(AlignmentStatsStream::Instance()),
+          fTelemetry(AlignmentTelemetry::Instance())
     {
+        AlignmentStartupTimer timer(kStartupAlignerConstruct);
+        
         // Get settings
         InterfacePtr<BaselineGridAlignerSettings> settings(
             ::CreateObject2<BaselineGridAlignerSettings>(kBaselineGridAlignerSettingsImpl));
@@ -66,14 +146,26 @@ public:
             docSubject->AddObserver(this, IID_IDOCUMENT);
         }
         
-        // Initialize telemetry
-        InterfacePtr<ITelemetry> telemetry(GetExecutionContextSession(), UseDefaultIID());
-        if (telemetry) {
-            telemetry->LogEvent("BaselineGridAligner:Initialize");
+        // Style definitions change text attributes without a change to the text itself
+        IDocument* document = GetExecutionContextDocument();
+        if (document) {
+            InterfacePtr<ISubject> styleSubject(document->GetDocWorkSpace(), UseDefaultIID());
+            if (styleSubject) {
+                styleSubject->AddObserver(this, IID_ISTYLEINFO);
+            }
         }
+        
+        // Telemetry is only queued here; forwarding starts with the first alignment
+        fTelemetry.SetSink(&BaselineGridAligner::ForwardTelemetry);
+        fTelemetry.Log(kTelemetryAlignerInitialize);
     }
 
     ~BaselineGridAligner() {
+        // A run still going uses the members below
+        if (fProcessing.valid()) {
+            fProcessing.wait();
+        }
+        
         // Unregister observers
         InterfacePtr<ISubject> subject(this, IID_ITEXTMODEL);
         if (subject) {
@@ -85,11 +177,20 @@ public:
             docSubject->RemoveObserver(this, IID_IDOCUMENT);
         }
         
-        // Log telemetry
-        InterfacePtr<ITelemetry> telemetry(GetExecutionContextSession(), UseDefaultIID());
-        if (telemetry) {
-            telemetry->LogEvent("BaselineGridAligner:Shutdown");
+        IDocument* document = GetExecutionContextDocument();
+        if (document) {
+            InterfacePtr<ISubject> styleSubject(document->GetDocWorkSpace(), UseDefaultIID());
+            if (styleSubject) {
+                styleSubject->RemoveObserver(this, IID_ISTYLEINFO);
+            }
+        }
+        
+        // Last events go out now, while the session still exists
+        fTelemetry.Log(kTelemetryAlignerShutdown);
+        if (fTelemetryTask) {
+            fTelemetryTask->UninstallTask();
         }
+        fTelemetry.Flush();
     }
 
     void Update(const ClassID& theChange, ISubject* theSubject, 
@@ -97,43 +198,64 @@ public:
         if (protocol == IID_ITEXTMODEL && 
             (theChange == kTextAttrChangedMsg || theChange == kTextFrameChangedMsg)) {
             
+            fRecorder.RecordNotification(theChange == kTextFrameChangedMsg ? kRecordedTextFrameChanged
+                                                                           : kRecordedTextAttrChanged,
+                                         ::GetUID(theSubject).Get());
+            
+            // Content verified earlier may have changed; our own runs keep their results.
+            // Fingerprints hold no attributes, so this epoch is what makes them stale.
+            InterfacePtr<ITextModel> changedModel(theSubject, UseDefaultIID());
+            if (changedModel && !fIsProcessing) {
+                InvalidateStoryFingerprints(::GetUID(changedModel).Get());
+            }
+            
+            // Frame options may include the frame's own baseline grid. The message
+            // comes from the story, so only the grids of its frames are dropped.
+            if (theChange == kTextFrameChangedMsg) {
+                InvalidateFrameGrids(changedModel);
+            }
+            
             // Only process if auto-apply is enabled
             if (fSettings && fSettings->GetAutoApply()) {
                 // Use async to avoid blocking the UI
                 if (!fIsProcessing) {
-                    fIsProcessing = true;
-                    std::async(std::launch::async, [this]{ 
-                        AlignTextToBaselineGrid(false);
-                        fIsProcessing = false;
-                    });
+                    StartProcessing([this] { AlignTextToBaselineGrid(false); });
                 }
             }
         }
         else if (protocol == IID_IDOCUMENT && theChange == kDocGridChangedMsg) {
-            // Grid changed, invalidate cached grid size
+            fRecorder.RecordNotification(kRecordedDocGridChanged, ::GetUID(theSubject).Get());
+            
+            // Grid changed, invalidate cached grid size and the frames that inherit it
             fGridValid = false;
+            fFrameGrids.Clear();
             
             // Update if auto-apply is enabled
             if (fSettings && fSettings->GetAutoApply()) {
                 if (!fIsProcessing) {
-                    fIsProcessing = true;
-                    std::async(std::launch::async, [this]{ 
-                        AlignTextToBaselineGrid(false);
-                        fIsProcessing = false;
-                    });
+                    StartProcessing([this] { AlignTextToBaselineGrid(false); });
                 }
             }
         }
+        else if (protocol == IID_ISTYLEINFO) {
+            fRecorder.RecordNotification(kRecordedStyleChanged, ::GetUID(theSubject).Get());
+            
+            // Any paragraph or character style may be in use anywhere in the document
+            InvalidateStyleFingerprints();
+        }
     }
     
     // Public method to trigger alignment manually
     void AlignText() {
         if (!fIsProcessing) {
-            fIsProcessing = true;
-            std::async(std::launch::async, [this]{ 
-                AlignTextToBaselineGrid(false);
-                fIsProcessing = false;
-            });
+            StartProcessing([this] { AlignTextToBaselineGrid(false); });
+        }
+    }
+    
+    // Public method to align every story of the document
+    void AlignDocument() {
+        if (!fIsProcessing) {
+            StartProcessing([this] { AlignDocumentToBaselineGrid(); });
         }
     }
     
@@ -141,14 +263,33 @@ public:
     void GeneratePreview() {
         if (!fIsProcessing && fSettings && fSettings->GetPreviewEnabled()) {
             fPreviewActive = true;
-            fIsProcessing = true;
-            std::async(std::launch::async, [this]{ 
-                AlignTextToBaselineGrid(true);
-                fIsProcessing = false;
-            });
+            StartProcessing([this] { AlignTextToBaselineGrid(true); });
         }
     }
     
+    // Export the recorded pipeline timeline as Chrome trace JSON
+    bool ExportTrace(const PMString& path) {
+        return AlignmentTrace::ExportChromeTrace(path.GetPlatformString());
+    }
+    
+    // Write the counters of the last run to a local file
+    bool DumpCounters(const PMString& path) {
+        return AlignmentCounters::Instance().DumpToFile(path.GetPlatformString());
+    }
+    
+    // Record notifications, settings and snapshots of every run to a file for offline replay
+    bool StartRecording(const PMString& path) {
+        return fRecorder.Start(path.GetPlatformString());
+    }
+    
+    void StopRecording() {
+        fRecorder.Stop();
+    }
+    
+    bool IsRecording() const {
+        return fRecorder.IsRecording();
+    }
+    
     // Public method to clear preview
     void ClearPreview() {
         if (fPreviewActive) {
@@ -159,20 +300,279 @@ public:
     }
 
 private:
-    PMReal fCachedGridSize;
+    GridFixed fCachedGridSize;
+    GridFixed fCachedGridStart;
+    bool fGridRelativeToMargin;     // document grid starts at the top margin, not the page top
     bool fGridValid;
     std::atomic<bool> fIsProcessing;
+    std::future<void> fProcessing;  // the run in progress; see StartProcessing
     bool fPreviewActive;
     std::unique_ptr<BaselineGridAlignerSettings> fSettings;
+    BaselineGridScaleCache fScaleCache;
+    ParallelPolicy fBaselinePolicy;
+    ParallelPolicy fLinesPolicy;
+    ParallelPolicy fStyleRunPolicy;
+    ParallelPolicy fReportPolicy;
+    
+    // Temporary data of a run lives here and is released in one step when it ends
+    RunArenaPool fArenas;
+    
+    // Finding groups of the report, per thread and merged; cleared, not freed, between runs
+    std::vector<AlignmentFindingGroups> fReportThreadGroups;
+    AlignmentFindingGroups fReportGroups;
+    
+    // Parcels verified as aligned in this or earlier sessions
+    AlignmentFingerprintCache fFingerprints;
+    
+    // Effective baseline grid of each text frame seen so far
+    FrameGridCache fFrameGrids;
+    
+    // Writes sessions to a file for AlignmentReplay while recording is on
+    AlignmentRecorder& fRecorder;
+    
+    // Live counters and histograms for the companion app
+    AlignmentStatsStream& fStats;
+    
+    // Queued telemetry and analytics events, forwarded by ForwardTelemetry
+    AlignmentTelemetry& fTelemetry;
+    InterfacePtr<IIdleTask> fTelemetryTask;
+    
+    // Checks whose results are cached separately
+    enum FingerprintCheck {
+        kFingerprintCheckBaseline = 1,
+        kFingerprintCheckReport = 2
+    };
+    
+    // Cache identity of one story for one check
+    struct StoryFingerprint {
+        uint32 fStoryID;
+        uint64 fEpoch;
+        uint64 fStyleEpoch;
+        FingerprintCheck fCheck;
+        GridFixed fTolerance;
+    };
+    
+    // Parcels overlapping the processed range and not verified before, as parallel arrays.
+    // Attributes are read from the model here, so parallel loops only compute.
+    struct ParcelRangeList {
+        explicit ParcelRangeList(RunArena& arena)
+            : fIndex(ArenaAllocator<int32>(&arena)),
+              fFingerprint(ArenaAllocator<uint64>(&arena)),
+              fStart(ArenaAllocator<TextIndex>(&arena)),
+              fLength(ArenaAllocator<int32>(&arena)),
+              fGrid(ArenaAllocator<BaselineGrid>(&arena)),
+              fSpread(ArenaAllocator<int32>(&arena)),
+              fBaseline(ArenaAllocator<GridFixed>(&arena)),
+              fLeading(ArenaAllocator<GridFixed>(&arena)),
+              fPointSize(ArenaAllocator<GridFixed>(&arena)),
+              fParaStyle(ArenaAllocator<uint32>(&arena))
+        {
+        }
+        
+        ArenaVector<int32> fIndex;
+        ArenaVector<TextIndex> fStart;
+        ArenaVector<int32> fLength;
+        ArenaVector<BaselineGrid> fGrid;    // grid of the frame holding the parcel
+        ArenaVector<int32> fSpread;         // spread index of that frame, for viewport order
+        ArenaVector<GridFixed> fBaseline;   // resolved baseline offset
+        ArenaVector<GridFixed> fLeading;    // resolved leading
+        ArenaVector<GridFixed> fPointSize;
+        ArenaVector<uint32> fParaStyle;     // paragraph style UID at the parcel start, 0 if unknown
+        ArenaVector<uint64> fFingerprint;   // cache fingerprint the parcel is stored under once verified
+        
+        int64 fCached = 0;                  // parcels in range skipped as verified before
+        uint64 fStoryFingerprint = 0;       // stored once every listed parcel verifies; 0 if the range misses parcels
+    };
+    
+    // Grid at text positions visited in increasing order.
+    // The parcel is looked up again only when a position leaves the current one.
+    class TextGridCursor {
+    public:
+        TextGridCursor(BaselineGridAligner& aligner, ITextParcelList* parcelList)
+            : fAligner(aligner),
+              fParcelList(parcelList),
+              fParcel(-1),
+              fStart(0),
+              fEnd(0),
+              fGrid(aligner.GetDocumentGrid()),
+              fSpaceResolved(false),
+              fGridOrigin(0)
+        {
+        }
+        
+        BaselineGrid At(TextIndex index) {
+            if (index >= fStart && index < fEnd) return fGrid;
+            
+            fParcel = fParcelList ? fParcelList->GetParcelContaining(index) : -1;
+            fSpaceResolved = false;
+            if (fParcel < 0) {
+                // Overset or unplaced text follows the document grid
+                fStart = fEnd = index;
+                fGrid = fAligner.GetDocumentGrid();
+                return fGrid;
+            }
+            
+            fParcelList->GetParcelRange(fParcel, &fStart, &fEnd);
+            fGrid = fAligner.ResolveParcelGrid(fParcelList, fParcel);
+            return fGrid;
+        }
+        
+        // Turn a y coordinate of the frame holding the last position passed to At()
+        // into the space its grid starts in: from the top of the page or of its top
+        // margin for the document grid, as the grid preferences say, and from the
+        // top of the frame for the frame's own grid.
+        PMReal ToGridSpace(PMReal innerY) {
+            if (!fSpaceResolved) {
+                ResolveGridSpace();
+            }
+            
+            PMPoint point(0, innerY);
+            fInnerToPasteboard.Transform(&point);
+            return point.Y() - fGridOrigin;
+        }
+        
+    private:
+        // Transform of the current frame and pasteboard y of its grid origin
+        void ResolveGridSpace() {
+            fSpaceResolved = true;
+            fInnerToPasteboard = PMMatrix();
+            fGridOrigin = 0;
+            if (fParcel < 0) return;
+            
+            InterfacePtr<ITextFrameColumn> frameColumn(fParcelList->QueryParcelFrame(fParcel));
+            InterfacePtr<IGeometry> frameGeometry(frameColumn, UseDefaultIID());
+            if (!frameGeometry) return;
+            fInnerToPasteboard = ::InnerToPasteboardMatrix(frameGeometry);
+            
+            BaselineGrid frameGrid;
+            if (QueryFrameGrid(frameColumn, frameGrid)) {
+                PMPoint frameTop = frameGeometry->GetStrokeBoundingBox().LeftTop();
+                fInnerToPasteboard.Transform(&frameTop);
+                fGridOrigin = frameTop.Y();
+                return;
+            }
+            
+            InterfacePtr<IGeometry> pageGeometry(::GetDataBase(frameColumn),
+                                                 Utils<ILayoutUtils>()->GetOwnerPageUID(frameColumn),
+                                                 UseDefaultIID());
+            if (!pageGeometry) return;
+            PMPoint pageTop = pageGeometry->GetStrokeBoundingBox().LeftTop();
+            if (fAligner.fGridRelativeToMargin) {
+                InterfacePtr<IMargins> margins(pageGeometry, IID_IMARGINS);
+                if (margins) {
+                    PMReal left, top, right, bottom;
+                    margins->GetMargins(&left, &top, &right, &bottom);
+                    pageTop.Y() += top;
+                }
+            }
+            ::InnerToPasteboardMatrix(pageGeometry).Transform(&pageTop);
+            fGridOrigin = pageTop.Y();
+        }
+        
+        BaselineGridAligner& fAligner;
+        ITextParcelList* fParcelList;
+        int32 fParcel;
+        TextIndex fStart;
+        TextIndex fEnd;
+        BaselineGrid fGrid;
+        bool fSpaceResolved;
+        PMMatrix fInnerToPasteboard;
+        PMReal fGridOrigin;
+    };
+    
+    // Cache entry of a parcel that passed a check, stored once the run's changes went in
+    struct VerifiedParcel {
+        uint64 fKey;
+        uint64 fFingerprint;
+    };
+    
+    // Everything a run would change, gathered read-only before any command is issued
+    struct AlignmentChanges {
+        explicit AlignmentChanges(RunArena& arena)
+            : fBaseline(ArenaAllocator<BaselineCorrection>(&arena)),
+              fRuns(ArenaAllocator<StyleRunSnapshot>(&arena)),
+              fRunCorrections(ArenaAllocator<StyleRunCorrection>(&arena)),
+              fVerified(ArenaAllocator<VerifiedParcel>(&arena))
+        {
+        }
+        
+        bool IsEmpty() const { return fBaseline.empty() && fRuns.empty(); }
+        
+        ArenaVector<BaselineCorrection> fBaseline;
+        ArenaVector<StyleRunSnapshot> fRuns;
+        ArenaVector<StyleRunCorrection> fRunCorrections;
+        ArenaVector<VerifiedParcel> fVerified;
+    };
 
-    void AlignTextToBaselineGrid(bool previewOnly) {
-        // Create command sequence for undo/redo support
-        InterfacePtr<ICommandSequence> cmdSeq(CmdUtils::CreateCommandSequence());
-        if (!previewOnly) {
-            CmdUtils::BeginCommandSequence(cmdSeq);
+    // One story read from the model by the snapshot stage of the document pipeline.
+    // Its arrays, and those of its StoryChanges, live in the story's own arena
+    // (RunArenaPool::ForItem): one stage at a time uses it as the story moves
+    // through the queues, and it is reused only after the story is committed.
+    struct StorySnapshot {
+        explicit StorySnapshot(RunArena* arena = nullptr)
+            : fArena(arena),
+              fParcels(ArenaAllocator<ParcelOffset>(arena)),
+              fParcelFingerprints(ArenaAllocator<uint64>(arena)),
+              fLines(arena),
+              fLineGrids(ArenaAllocator<BaselineGrid>(arena)),
+              fRuns(ArenaAllocator<StyleRunSnapshot>(arena))
+        {
+        }
+        
+        RunArena* fArena;
+        UIDRef fStory;
+        StoryFingerprint fFingerprint = StoryFingerprint();
+        ArenaVector<ParcelOffset> fParcels;
+        ArenaVector<uint64> fParcelFingerprints;    // cache fingerprint of each of fParcels
+        uint64 fStoryFingerprint = 0;               // cache fingerprint of the whole story, 0 if not cacheable
+        BaselineLineMetrics fLines;
+        ArenaVector<BaselineGrid> fLineGrids;
+        ArenaVector<StyleRunSnapshot> fRuns;
+    };
+    
+    // What the compute stage found for one story, waiting to be committed
+    struct StoryChanges {
+        explicit StoryChanges(RunArena* arena = nullptr)
+            : fBaseline(ArenaAllocator<BaselineCorrection>(arena)),
+              fRuns(ArenaAllocator<StyleRunSnapshot>(arena)),
+              fRunCorrections(ArenaAllocator<StyleRunCorrection>(arena)),
+              fVerified(ArenaAllocator<ParcelOffset>(arena)),
+              fVerifiedFingerprints(ArenaAllocator<uint64>(arena))
+        {
         }
         
+        UIDRef fStory;
+        StoryFingerprint fFingerprint = StoryFingerprint();
+        ArenaVector<BaselineCorrection> fBaseline;
+        ArenaVector<StyleRunSnapshot> fRuns;
+        ArenaVector<StyleRunCorrection> fRunCorrections;
+        ArenaVector<ParcelOffset> fVerified;
+        ArenaVector<uint64> fVerifiedFingerprints;  // cache fingerprint of each of fVerified
+        uint64 fStoryFingerprint = 0;               // set when every parcel of the story verified
+        MisalignmentHistogram fHistogram;
+        
+        bool IsEmpty() const { return fBaseline.empty() && fRuns.empty(); }
+    };
+    
+    // Stories snapshotted ahead of the compute stage and computed ahead of the commit stage
+    static const size_t kPipelineDepth = 2;
+    
+    // Parallel loops offer the stats stream a progress snapshot every 64 items
+    static const int32 kStatsProgressMask = 63;
+
+    void AlignTextToBaselineGrid(bool previewOnly) {
+        AlignmentRunScope runScope;
+        AlignmentTraceScope runSpan(previewOnly ? "Align:Preview" : "Align:Run");
+        RunArenaScope arenaScope(fArenas);
+        const uint64 runStartMicros = AlignmentCounters::NowMicros();
+        
+        // Opened only when the read-only pass finds something to change,
+        // so already aligned text creates no undo step and no recomposition
+        InterfacePtr<ICommandSequence> cmdSeq;
+        
         try {
+            AlignmentTraceScope lookupSpan("Align:TargetLookup");
+            
             // Get text target
             InterfacePtr<ITextTarget> textTarget(Utils<ISelectionUtils>()->QueryActiveTextTarget());
             if (!textTarget) return;
@@ -181,65 +581,111 @@ private:
             InterfacePtr<ITextModel> textModel(textTarget->QueryTextModel());
             if (!textModel) return;
             
-            // Get grid data
-            InterfacePtr<IDocumentGridData> gridData(GetExecutionContextDocument()->QueryPreferences());
+            lookupSpan.End();
+            AlignmentTraceScope gridSpan("Align:GridFetch");
             
-            // Update cached grid size if needed
-            if(!fGridValid || GetExecutionContextDocument()->IsModified()) {
-                fCachedGridSize = gridData->GetBaselineGridIncrement();
-                fGridValid = true;
-            }
+            RefreshDocumentGrid();
             
-            // Validate grid size
-            if(fCachedGridSize < 0.5) {
-                if (fSettings && fSettings->GetShowWarnings()) {
-                    Utils<IErrorLog>()->LogError(kBaselineGridPluginID, "Neplatná velikost baseline gridu");
-                }
-                return;
-            }
+            gridSpan.End();
+            OpenFingerprintCache();
             
             // Get text range
             const TextIndex start = textTarget->GetRange().Start(nil);
             const TextIndex end = textTarget->GetRange().End(nil);
             
-            // Process based on alignment type
-            if (fSettings) {
-                switch (fSettings->GetAlignmentType()) {
+            // Default to tracking alignment if settings not available
+            const int32 alignmentType = fSettings ? fSettings->GetAlignmentType() : kAlignmentTypeTracking;
+            RecordedRunScope recordedRun(fRecorder, previewOnly ? kRecordedRunPreview : kRecordedRunSelection,
+                                         GetRecordedSettings(alignmentType), GetDocumentGrid());
+            OpenStatsStream();
+            AlignmentStatsRunScope statsRun(fStats, previewOnly ? kStatsRunPreview : kStatsRunSelection,
+                                            alignmentType);
+            
+            // Read-only pass: find what would change without touching the document
+            AlignmentChanges changes(fArenas.Main());
+            switch (alignmentType) {
+                case kAlignmentTypeBaseline:
+                    // Parcels in view are previewed or applied before the rest of the range is read
+                    CollectBaselineChanges(textModel, start, end, changes,
+                        [&](const ArenaVector<BaselineCorrection>& visible) {
+                            if (previewOnly) {
+                                AlignmentChanges visibleChanges(fArenas.Main());
+                                visibleChanges.fBaseline.assign(visible.begin(), visible.end());
+                                HighlightChanges(visibleChanges);
+                                return false;
+                            }
+                            AlignmentTraceScope visibleSpan("Align:ApplyVisible");
+                            BeginCommandSequence(cmdSeq);
+                            AlignmentCounters::Instance().Add(kCounterParcelsModified, visible.size());
+                            ApplyBaselineCorrections(textModel, visible, cmdSeq);
+                            return true;
+                        });
+                    break;
+                case kAlignmentTypeTracking:
+                    CollectStyleRunChanges<TrackingStrategy>(textModel, start, end, changes);
+                    break;
+                case kAlignmentTypeWordSpacing:
+                    CollectStyleRunChanges<WordSpacingStrategy>(textModel, start, end, changes);
+                    break;
+                case kAlignmentTypeCombined:
+                    CollectStyleRunChanges<CombinedStrategy>(textModel, start, end, changes);
+                    break;
+                case kAlignmentTypeLines:
+                    CollectLineChanges(textModel, start, end, changes.fBaseline);
+                    break;
+                case kAlignmentTypeLeading:
+                    CollectStyleRunChanges<LeadingStrategy>(textModel, start, end, changes);
+                    break;
+            }
+            
+            if (previewOnly) {
+                HighlightChanges(changes);
+            }
+            else if (!changes.IsEmpty()) {
+                // Create command sequence for undo/redo support, unless the visible part opened it
+                BeginCommandSequence(cmdSeq);
+                
+                switch (alignmentType) {
                     case kAlignmentTypeBaseline:
-                        AlignBaseline(textModel, start, end, previewOnly, cmdSeq);
+                        AlignmentCounters::Instance().Add(kCounterParcelsModified, changes.fBaseline.size());
+                        ApplyBaselineCorrections(textModel, changes.fBaseline, cmdSeq);
                         break;
                     case kAlignmentTypeTracking:
-                        AlignTracking(textModel, start, end, previewOnly, cmdSeq);
+                        ApplyStyleRunChanges<TrackingStrategy>(textModel, changes.fRuns, changes.fRunCorrections, cmdSeq);
                         break;
                     case kAlignmentTypeWordSpacing:
-                        AlignWordSpacing(textModel, start, end, previewOnly, cmdSeq);
+                        ApplyStyleRunChanges<WordSpacingStrategy>(textModel, changes.fRuns, changes.fRunCorrections, cmdSeq);
                         break;
                     case kAlignmentTypeCombined:
-                        AlignCombined(textModel, start, end, previewOnly, cmdSeq);
+                        ApplyStyleRunChanges<CombinedStrategy>(textModel, changes.fRuns, changes.fRunCorrections, cmdSeq);
+                        break;
+                    case kAlignmentTypeLines:
+                        ApplyBaselineCorrections(textModel, changes.fBaseline, cmdSeq);
+                        break;
+                    case kAlignmentTypeLeading:
+                        ApplyStyleRunChanges<LeadingStrategy>(textModel, changes.fRuns, changes.fRunCorrections, cmdSeq);
                         break;
                 }
             }
-            else {
-                // Default to tracking alignment if settings not available
-                AlignTracking(textModel, start, end, previewOnly, cmdSeq);
-            }
+            
+            // Parcels found on the grid are cached only once the changes went in without error
+            StoreVerifiedParcels(changes.fVerified);
             
             // Generate report if warnings are enabled
             if (fSettings && fSettings->GetShowWarnings() && !previewOnly) {
+                AlignmentTraceScope reportSpan("Align:Report");
                 GenerateAlignmentReport(textModel, start, end);
             }
             
-            // Log analytics
-            InterfacePtr<IAnalytics> analytics(GetExecutionContextSession(), UseDefaultIID());
-            if (analytics) {
-                analytics->LogEvent("BaselineGridAligner:Align", "Range", end - start);
-            }
+            fFingerprints.Flush();
+            
+            fTelemetry.Log(kTelemetryAlign, end - start, AlignmentCounters::NowMicros() - runStartMicros);
         }
         catch (CancelException&) {
+            AlignmentCounters::Instance().CancelObserved();
+            
             // User cancelled, clean up
-            if (!previewOnly) {
-                CmdUtils::EndCommandSequence(cmdSeq);
-            }
+            EndCommandSequence(cmdSeq);
             return;
         }
         catch (std::exception& e) {
@@ -249,9 +695,7 @@ private:
                 errorMsg.Append(e.what());
                 Utils<IErrorLog>()->LogError(kBaselineGridPluginID, errorMsg);
             }
-            if (!previewOnly) {
-                CmdUtils::EndCommandSequence(cmdSeq);
-            }
+            EndCommandSequence(cmdSeq);
             throw;
         }
         catch (...) {
@@ -259,173 +703,830 @@ private:
             if (fSettings && fSettings->GetShowWarnings()) {
                 Utils<IErrorLog>()->LogError(kBaselineGridPluginID, "Kritická chyba během zarovnávání");
             }
-            if (!previewOnly) {
-                CmdUtils::EndCommandSequence(cmdSeq);
-            }
+            EndCommandSequence(cmdSeq);
             throw;
         }
         
-        if (!previewOnly) {
-            CmdUtils::EndCommandSequence(cmdSeq);
+        EndCommandSequence(cmdSeq);
+    }
+    
+    // Open the run's command sequence on first use; all commands of a run form one undo step
+    static void BeginCommandSequence(InterfacePtr<ICommandSequence>& cmdSeq) {
+        if (cmdSeq) return;
+        
+        cmdSeq.reset(CmdUtils::CreateCommandSequence());
+        CmdUtils::BeginCommandSequence(cmdSeq);
+    }
+    
+    // Close the run's sequence if it was opened. It is opened right before the first
+    // command, and InDesign recomposes the text its commands damaged once, when it
+    // ends, so each closed sequence counts as one recomposition.
+    static void EndCommandSequence(InterfacePtr<ICommandSequence>& cmdSeq) {
+        if (!cmdSeq) return;
+        
+        AlignmentTraceScope recomposeSpan("Align:Recompose");
+        CmdUtils::EndCommandSequence(cmdSeq);
+        AlignmentCounters::Instance().Add(kCounterRecompositions, 1);
+    }
+    
+    // Process one command of the run's sequence. Commands only damage the wax;
+    // InDesign recomposes the damaged text once, when the sequence ends or
+    // composed data is read. The read-only pass reads everything up front, so
+    // only the pass after applied visible baseline corrections forces one more.
+    static void ProcessAlignmentCommand(ICommandSequence* cmdSeq, ICommand* cmd) {
+        if (!cmd) return;
+        
+        CmdUtils::ProcessCommand(cmdSeq, cmd);
+        AlignmentCounters::Instance().Add(kCounterCommandsIssued, 1);
+    }
+    
+    // Reload the document grid when it may have changed
+    void RefreshDocumentGrid() {
+        InterfacePtr<IDocumentGridData> gridData(GetExecutionContextDocument()->QueryPreferences());
+        
+        // Update cached grid size if needed
+        if(!fGridValid || GetExecutionContextDocument()->IsModified()) {
+            const BaselineGrid documentGrid = GetDocumentGrid();
+            fCachedGridSize = ToGridFixed(ToDouble(gridData->GetBaselineGridIncrement()));
+            fCachedGridStart = ToGridFixed(ToDouble(gridData->GetBaselineGridStart()));
+            fGridRelativeToMargin =
+                gridData->GetBaselineGridRelativeOption() == IDocumentGridData::kBaselineGridRelativeToTopMargin;
+            fGridValid = true;
+            
+            // Frames without their own grid resolved to the old document grid
+            if (GetDocumentGrid() != documentGrid) {
+                fFrameGrids.Clear();
+            }
         }
+        
+        // Frames with their own grid are still aligned; text following the document grid is skipped
+        if(!IsAlignableGrid(GetDocumentGrid())) {
+            if (fSettings && fSettings->GetShowWarnings()) {
+                Utils<IErrorLog>()->LogError(kBaselineGridPluginID,
+                    "Neplatná velikost baseline gridu dokumentu, zarovná se jen text v rámečcích s vlastním gridem");
+            }
+        }
+    }
+    
+    RecordedSettings GetRecordedSettings(int32 alignmentType) const {
+        RecordedSettings settings;
+        settings.fAlignmentType = alignmentType;
+        settings.fWordSpacingFactor = fSettings ? ToDouble(fSettings->GetWordSpacingFactor()) : 1.0;
+        settings.fLeadingMultiple = fSettings ? fSettings->GetLeadingMultiple() : 0;
+        return settings;
     }
     
-    void AlignBaseline(ITextModel* textModel, TextIndex start, TextIndex end, 
-                       bool previewOnly, ICommandSequence* cmdSeq) {
-        // Implementation for baseline alignment
+    // Read-only pass of baseline alignment: collect offsets of parcels off the grid into
+    // changes.fBaseline and parcels already on it into changes.fVerified.
+    // Parcels on visible spreads are read first and their corrections handed to
+    // onVisible(corrections) before the rest; those are not added to changes.fBaseline.
+    // onVisible returns true if it changed the document; a baseline shift can move
+    // lines between parcels, so the range is then read again for the rest.
+    template <class VisibleFn>
+    void CollectBaselineChanges(ITextModel* textModel, TextIndex start, TextIndex end,
+                                AlignmentChanges& changes, VisibleFn onVisible) {
         InterfacePtr<ITextParcelList> parcelList(textModel, UseDefaultIID());
         if (!parcelList) return;
         
-        int32 parcelCount = parcelList->GetParcelCount();
+        ArenaVector<BaselineCorrection>& corrections = changes.fBaseline;
+        
         InterfacePtr<IProgressBar> progressBar(this, IID_IPROGRESS);
         
-        // Use OpenMP for parallelization if available
-        #pragma omp parallel for schedule(dynamic) if(_OPENMP)
-        for (int32 p = 0; p < parcelCount; p++) {
-            // Check for user cancel in each thread
-            if (Utils<IUserCancel>()->WasCancelled()) {
-                #pragma omp critical
-                {
-                    throw CancelException();
-                }
-            }
+        AlignmentTraceScope computeSpan("Baseline:Compute");
+        
+        // Only parcels overlapping the range and not verified on the grid before take part
+        // in the work split; newly verified ones are returned for caching
+        const StoryFingerprint story = GetStoryFingerprint(textModel, kFingerprintCheckBaseline, 0);
+        
+        // Offsets read by the loop, kept only while a session is being recorded
+        const bool recording = fRecorder.IsRecording();
+        ArenaVector<ParcelOffset> recorded(ArenaAllocator<ParcelOffset>(&fArenas.Main()));
+        
+        // Corrections handed out early, so the recorded result still covers the whole range
+        ArenaVector<BaselineCorrection> recordedCorrections(ArenaAllocator<BaselineCorrection>(&fArenas.Main()));
+        
+        // Corrections are collected first and applied afterwards, those in view
+        // right after their wave; only the pass that follows them reads composed data
+        ArenaVector<int32> verifiedIndices(ArenaAllocator<int32>(&fArenas.Main()));
+        ArenaVector<ParcelOffset> waveParcels(ArenaAllocator<ParcelOffset>(&fArenas.Main()));
+        ArenaVector<BaselineCorrection> waveCorrections(ArenaAllocator<BaselineCorrection>(&fArenas.Main()));
+        ArenaVector<ParcelOffset> waveVerified(ArenaAllocator<ParcelOffset>(&fArenas.Main()));
+        
+        // The visible wave is handed out once, as the first wave of a pass. If that changed
+        // the document, the parcels read so far are stale and a second pass reads the range
+        // again; the applied parcels now sit on the grid and only verify.
+        bool visibleHandled = false;
+        bool reflowed = true;
+        while (reflowed) {
+            reflowed = false;
             
-            // Update progress
-            if (progressBar) {
-                const float progress = static_cast<float>(p) / parcelCount;
-                #pragma omp critical
-                {
-                    progressBar->SetValue(progress);
+            ParcelRangeList parcels(fArenas.Main());
+            CollectParcelsInRange(textModel, parcelList, start, end, story, parcels);
+            const int32 itemCount = static_cast<int32>(parcels.fIndex.size());
+            verifiedIndices.clear();
+            
+            // Each wave plans serial/parallel execution, thread count and chunks from its own work size
+            ForEachViewportWave(parcels, fBaselinePolicy, [&](const ParallelPlan& plan, const int32* order,
+                                                              const ViewportWave& wave) {
+                // Parcels of the wave in viewport order, for the shared engine
+                const size_t waveCount = wave.fEnd - wave.fBegin;
+                waveParcels.clear();
+                waveCorrections.clear();
+                waveVerified.clear();
+                waveParcels.reserve(waveCount);
+                for (size_t n = 0; n < waveCount; n++) {
+                    ThrowIfCancelled();
+                    
+                    const int32 done = static_cast<int32>(wave.fBegin + n);
+                    if (progressBar) {
+                        progressBar->SetValue(static_cast<float>(done) / itemCount);
+                    }
+                    if ((done & kStatsProgressMask) == 0) {
+                        fStats.PublishProgress(static_cast<float>(done) / itemCount);
+                    }
+                    
+                    const int32 i = order[n];
+                    waveParcels.push_back(ParcelOffset{parcels.fStart[i], parcels.fLength[i],
+                                                       parcels.fBaseline[i], parcels.fGrid[i]});
+                }
+                
+                // Same engine as the document pipeline and replay; parcels already
+                // on the grid come back as verified, so re-runs issue no commands
+                MisalignmentHistogram histogram;
+                ComputeParcelCorrectionsParallel(plan, waveParcels.data(), waveParcels.size(), &fArenas.Main(),
+                                                 waveCorrections, waveVerified, &histogram);
+                fStats.AddHistogram(histogram);
+                
+                // Verified parcels keep wave order, so their list indices are found in one pass
+                size_t n = 0;
+                for (const ParcelOffset& parcel : waveVerified) {
+                    while (waveParcels[n].fStart != parcel.fStart) {
+                        n++;
+                    }
+                    verifiedIndices.push_back(order[n]);
                 }
+                if (recording) {
+                    recorded.insert(recorded.end(), waveParcels.begin(), waveParcels.end());
+                }
+            },
+            [&](const ViewportWave& wave) {
+                // The visible part is applied or previewed, in text order, while the rest is still unread
+                if (wave.fVisible && wave.fBegin == 0 && !visibleHandled && !waveCorrections.empty()) {
+                    visibleHandled = true;
+                    std::sort(waveCorrections.begin(), waveCorrections.end(),
+                        [](const BaselineCorrection& a, const BaselineCorrection& b) { return a.fStart < b.fStart; });
+                    if (recording) {
+                        recordedCorrections.insert(recordedCorrections.end(), waveCorrections.begin(),
+                                                   waveCorrections.end());
+                    }
+                    reflowed = onVisible(waveCorrections);
+                    return !reflowed;
+                }
+                corrections.insert(corrections.end(), waveCorrections.begin(), waveCorrections.end());
+                return true;
+            });
+            
+            if (reflowed) {
+                // Reading the range again recomposes what the visible commands damaged
+                AlignmentCounters::Instance().Add(kCounterRecompositions, 1);
+            }
+            else {
+                CollectVerifiedParcels(story, parcels, verifiedIndices, changes.fVerified);
             }
+        }
+        
+        // Waves follow the viewport; keep commands in text order
+        std::sort(corrections.begin(), corrections.end(),
+            [](const BaselineCorrection& a, const BaselineCorrection& b) { return a.fStart < b.fStart; });
+        
+        if (recording) {
+            std::sort(recorded.begin(), recorded.end(),
+                [](const ParcelOffset& a, const ParcelOffset& b) { return a.fStart < b.fStart; });
+            
+            recordedCorrections.insert(recordedCorrections.end(), corrections.begin(), corrections.end());
+            std::sort(recordedCorrections.begin(), recordedCorrections.end(),
+                [](const BaselineCorrection& a, const BaselineCorrection& b) { return a.fStart < b.fStart; });
             
+            const uint32 storyID = ::GetUID(textModel).Get();
+            fRecorder.RecordParcels(storyID, recorded.data(), recorded.size());
+            fRecorder.RecordResult(storyID, recordedCorrections.size(),
+                                   ChecksumCorrections(recordedCorrections.data(), recordedCorrections.size()));
+        }
+    }
+    
+    // Gather parcels overlapping [start, end]; out-of-range parcels are only counted.
+    // The grid, spread and composition attributes of each parcel are read here,
+    // so the parallel loops never query the model. Parcels without a composition
+    // style or on a grid too fine to align to are left out, and so are parcels,
+    // or the whole story, verified for this check before: the cache is looked up
+    // ahead of the attribute reads, so a verified story or parcel costs no queries.
+    void CollectParcelsInRange(ITextModel* textModel, ITextParcelList* parcelList, TextIndex start, TextIndex end,
+                               const StoryFingerprint& story, ParcelRangeList& parcels) {
+        const int32 parcelCount = parcelList->GetParcelCount();
+        AlignmentCounters::Instance().Add(kCounterParcelsScanned, parcelCount);
+        
+        const uint64 storyFingerprint = StoryVerifiedFingerprint(story, textModel->TotalLength(), parcelCount);
+        if (fFingerprints.Contains(StoryVerifiedKey(story), storyFingerprint)) {
+            AlignmentCounters::Instance().Add(kCounterParcelsSkippedByCache, parcelCount);
+            return;
+        }
+        
+        parcels.fIndex.reserve(parcelCount);
+        parcels.fStart.reserve(parcelCount);
+        parcels.fLength.reserve(parcelCount);
+        parcels.fGrid.reserve(parcelCount);
+        parcels.fSpread.reserve(parcelCount);
+        parcels.fBaseline.reserve(parcelCount);
+        parcels.fLeading.reserve(parcelCount);
+        parcels.fPointSize.reserve(parcelCount);
+        parcels.fParaStyle.reserve(parcelCount);
+        parcels.fFingerprint.reserve(parcelCount);
+        
+        // Consecutive parcels mostly share a frame, so only a new frame is looked up
+        InterfacePtr<ISpreadList> spreadList(GetExecutionContextDocument(), UseDefaultIID());
+        uint32 lastFrameID = 0;
+        int32 lastSpread = ViewportRange::kUnknownSpread;
+        
+        InterfacePtr<IAttributeStrand> paraStrand(
+            static_cast<IAttributeStrand*>(textModel->QueryStrand(kParaAttrStrandBoss, IID_IATTRIBUTESTRAND)));
+        
+        int32 outOfRange = 0;
+        for (int32 p = 0; p < parcelCount; p++) {
             TextIndex parcelStart, parcelEnd;
             parcelList->GetParcelRange(p, &parcelStart, &parcelEnd);
             
-            if (parcelEnd < start || parcelStart > end) continue;
+            if (parcelEnd < start || parcelStart > end) {
+                outOfRange++;
+                continue;
+            }
+            
+            const BaselineGrid grid = ResolveParcelGrid(parcelList, p);
+            if (!IsAlignableGrid(grid)) continue;
+            
+            const uint32 frameID = parcelList->GetParcelFrameUID(p).Get();
+            const uint64 fingerprint = ParcelFingerprint(story, parcelStart, parcelEnd - parcelStart, frameID, grid);
+            if (fFingerprints.Contains(ParcelKey(story, parcelStart), fingerprint)) {
+                parcels.fCached++;
+                continue;
+            }
             
             InterfacePtr<ICompositionStyle> style(parcelList->QueryParcelCompositionStyle(p));
             if (!style) continue;
             
-            // Calculate new baseline offset
-            PMReal currentOffset = style->GetBaselineOffset();
-            PMReal newOffset = round(currentOffset / fCachedGridSize) * fCachedGridSize;
+            if (frameID != lastFrameID) {
+                InterfacePtr<ITextFrameColumn> frameColumn(parcelList->QueryParcelFrame(p));
+                lastSpread = GetSpreadIndex(spreadList, frameColumn);
+                lastFrameID = frameID;
+            }
             
-            // Apply change if not in preview mode
-            if (!previewOnly) {
-                #pragma omp critical
-                {
-                    CmdUtils::ProcessCommand(cmdSeq, 
-                        style->ApplyBaselineOffset(newOffset, parcelStart, parcelEnd - parcelStart));
-                }
+            parcels.fIndex.push_back(p);
+            parcels.fStart.push_back(parcelStart);
+            parcels.fLength.push_back(parcelEnd - parcelStart);
+            parcels.fGrid.push_back(grid);
+            parcels.fSpread.push_back(lastSpread);
+            parcels.fBaseline.push_back(ToGridFixed(ToDouble(style->GetBaselineOffset())));
+            parcels.fLeading.push_back(ToGridFixed(ToDouble(style->GetLeading())));
+            parcels.fPointSize.push_back(ToGridFixed(ToDouble(style->GetFontSize())));
+            parcels.fParaStyle.push_back(paraStrand ? paraStrand->GetStyleUID(parcelStart).Get() : 0);
+            parcels.fFingerprint.push_back(fingerprint);
+        }
+        
+        // Only a range covering every parcel can verify the story as a whole
+        parcels.fStoryFingerprint = outOfRange == 0 ? storyFingerprint : 0;
+        
+        AlignmentCounters::Instance().Add(kCounterParcelsSkippedByCache, parcels.fCached);
+        AlignmentCounters::Instance().Add(kCounterParcelsSkippedByRange, outOfRange);
+    }
+    
+    void ApplyBaselineCorrections(ITextModel* textModel, const ArenaVector<BaselineCorrection>& corrections,
+                                  ICommandSequence* cmdSeq) {
+        if (corrections.empty()) return;
+        
+        AlignmentTraceScope applySpan("Baseline:Apply");
+        InterfacePtr<ITextModelCmds> textModelCmds(textModel, UseDefaultIID());
+        if (!textModelCmds) return;
+        
+        for (const BaselineCorrection& correction : corrections) {
+            boost::shared_ptr<AttributeBossList> attributes(new AttributeBossList());
+            InterfacePtr<ITextAttrRealNumber> offsetAttr(
+                ::CreateObject2<ITextAttrRealNumber>(kTextAttrBLShiftBoss));
+            offsetAttr->SetRealNumber(FromGridFixed(correction.fOffset));
+            attributes->ApplyAttribute(offsetAttr);
+            
+            InterfacePtr<ICommand> applyCmd(
+                textModelCmds->ApplyCmd(correction.fStart, correction.fLength, attributes, kCharAttrStrandBoss));
+            ProcessAlignmentCommand(cmdSeq, applyCmd);
+        }
+    }
+    
+    // Shared engine for attribute strategies, read-only pass: query and compute per style run.
+    // Only runs whose attributes would actually change are kept.
+    template <class Strategy>
+    void CollectStyleRunChanges(ITextModel* textModel, TextIndex start, TextIndex end,
+                                AlignmentChanges& changes) {
+        // Settings shared by all runs
+        StyleRunParameters parameters;
+        parameters.fWordSpacingFactor = fSettings ? ToDouble(fSettings->GetWordSpacingFactor()) : 1.0;
+        parameters.fLeadingMultiple = fSettings ? fSettings->GetLeadingMultiple() : 0;
+        
+        // Query only the attributes the strategy touches. The text model may
+        // only be read on this thread, so runs are queried here, like parcels
+        // in CollectParcelsInRange, and the compute below works on the snapshots.
+        AlignmentTraceScope querySpan("StyleRuns:Query");
+        ArenaVector<StyleRunSnapshot> runs = CollectStyleRuns(textModel, start, end, fArenas.Main());
+        for (StyleRunSnapshot& run : runs) {
+            ThrowIfCancelled();
+            QueryStyleRunAttributes<Strategy>(textModel, run);
+        }
+        querySpan.End();
+        fRecorder.RecordStyleRuns(::GetUID(textModel).Get(), runs.data(), runs.size());
+        
+        // Compute new values for all runs in a planned loop; the scale cache is not
+        // thread safe, so scales are looked up before it
+        AlignmentTraceScope computeSpan("StyleRuns:Compute");
+        ComputeStyleRunChangesPlanned<Strategy>(fStyleRunPolicy, runs.data(), runs.size(), parameters, fScaleCache,
+                                                &fArenas.Main(), changes.fRuns, changes.fRunCorrections);
+        if (fRecorder.IsRecording()) {
+            fRecorder.RecordResult(::GetUID(textModel).Get(), changes.fRuns.size(),
+                                   ChecksumStyleRunChanges(changes.fRuns.data(), changes.fRunCorrections.data(),
+                                                           changes.fRuns.size()));
+        }
+    }
+    
+    // Read the attributes the strategy touches into the run; a run that can't be read gets length 0
+    template <class Strategy>
+    void QueryStyleRunAttributes(ITextModel* textModel, StyleRunSnapshot& run) {
+        InterfacePtr<ITextAttributes> textAttributes(textModel->QueryTextAttributes(run.fStart));
+        if (!textAttributes) {
+            // Nothing to read, keep the run unchanged
+            run.fLength = 0;
+            return;
+        }
+        
+        // The run's own point size; character formatting may override the paragraph's
+        run.fFontSize = ToGridFixed(ToDouble(textAttributes->QueryPointSize()));
+        
+        // Corrections scale the paragraph style's value, so applying them again changes
+        // nothing; text without a readable style scales its current value
+        InterfacePtr<ITextAttributes> styleAttributes(QueryParagraphStyleAttributes(textModel, run.fStart));
+        if constexpr (Strategy::kTouchesTracking) {
+            run.fTracking = ToDouble(textAttributes->QueryTracking());
+            run.fBaseTracking = styleAttributes ? ToDouble(styleAttributes->QueryTracking()) : run.fTracking;
+        }
+        if constexpr (Strategy::kTouchesWordSpacing) {
+            run.fWordSpacing = ToDouble(textAttributes->QueryWordSpacing());
+            run.fBaseWordSpacing = styleAttributes ? ToDouble(styleAttributes->QueryWordSpacing()) : run.fWordSpacing;
+        }
+        if constexpr (Strategy::kTouchesLeading) {
+            // Auto leading is negative; it resolves to the paragraph's auto leading
+            // percentage of the font size (120 % unless the paragraph sets another)
+            const GridFixed leading = ToGridFixed(ToDouble(textAttributes->QueryLeading()));
+            run.fLeading = leading >= 0 ? leading :
+                ResolveAutoLeading(run.fFontSize, ToGridFixed(ToDouble(textAttributes->QueryAutoLeading())));
+        }
+    }
+    
+    // Apply collected style run changes, one command per run for all touched attributes
+    template <class Strategy>
+    void ApplyStyleRunChanges(ITextModel* textModel, const ArenaVector<StyleRunSnapshot>& runs,
+                              const ArenaVector<StyleRunCorrection>& corrections,
+                              ICommandSequence* cmdSeq) {
+        AlignmentTraceScope applySpan("StyleRuns:Apply");
+        InterfacePtr<ITextModelCmds> textModelCmds(textModel, UseDefaultIID());
+        if (!textModelCmds) return;
+        
+        for (size_t i = 0; i < runs.size(); i++) {
+            const StyleRunSnapshot& run = runs[i];
+            
+            boost::shared_ptr<AttributeBossList> attributes(
+                CreateStyleRunAttributes<Strategy>(corrections[i]));
+            
+            InterfacePtr<ICommand> applyCmd(
+                textModelCmds->ApplyCmd(run.fStart, run.fLength, attributes, kCharAttrStrandBoss));
+            ProcessAlignmentCommand(cmdSeq, applyCmd);
+        }
+    }
+    
+    // Read-only pass of line alignment: collect offsets of composed lines off the grid
+    void CollectLineChanges(ITextModel* textModel, TextIndex start, TextIndex end,
+                            ArenaVector<BaselineCorrection>& corrections) {
+        // Collect composed line metrics and the grid of each line's frame; wax access stays on this thread
+        AlignmentTraceScope querySpan("Lines:Query");
+        BaselineLineMetrics lines(&fArenas.Main());
+        ArenaVector<BaselineGrid> lineGrids(ArenaAllocator<BaselineGrid>(&fArenas.Main()));
+        QueryLineMetrics(textModel, start, end, lines, lineGrids);
+        
+        querySpan.End();
+        
+        const uint32 storyID = ::GetUID(textModel).Get();
+        fRecorder.RecordLines(storyID, lines, lineGrids);
+        
+        AlignmentTraceScope computeSpan("Lines:Compute");
+        MisalignmentHistogram histogram;
+        FindOffGridLinesPlanned(fLinesPolicy, lines, lineGrids, &fArenas.Main(), corrections, &histogram);
+        fStats.AddHistogram(histogram);
+        if (fRecorder.IsRecording()) {
+            fRecorder.RecordResult(storyID, corrections.size(), ChecksumCorrections(corrections.data(), corrections.size()));
+        }
+    }
+    
+    void QueryLineMetrics(ITextModel* textModel, TextIndex start, TextIndex end,
+                          BaselineLineMetrics& lines, ArenaVector<BaselineGrid>& lineGrids) {
+        InterfacePtr<IWaxStrand> waxStrand(
+            static_cast<IWaxStrand*>(textModel->QueryStrand(kFrameListBoss, IID_IWAXSTRAND)));
+        if (!waxStrand) return;
+        
+        InterfacePtr<ITextParcelList> parcelList(textModel, UseDefaultIID());
+        TextGridCursor gridCursor(*this, parcelList);
+        std::unique_ptr<IWaxIterator> waxIterator(waxStrand->NewWaxIterator());
+        for (IWaxLine* waxLine = waxIterator->GetFirstWaxLine(start);
+             waxLine && waxLine->GetTextIndex() <= end;
+             waxLine = waxIterator->GetNextWaxLine()) {
+            // Lines on a grid too fine to align to stay as they are
+            const BaselineGrid grid = gridCursor.At(waxLine->GetTextIndex());
+            if (!IsAlignableGrid(grid)) continue;
+            
+            // The wax y is the composed baseline without baseline shift, so the engine
+            // computes the shift that aligns the line from it, not from the current shift
+            InterfacePtr<ICompositionStyle> style(textModel->QueryParcelCompositionStyleAt(waxLine->GetTextIndex()));
+            const GridFixed shift = style ? ToGridFixed(ToDouble(style->GetBaselineOffset())) : 0;
+            
+            // Wax positions are in frame coordinates, the grid starts at the page, margin or frame top
+            lineGrids.push_back(grid);
+            lines.Append(waxLine->GetTextIndex(), waxLine->GetTextSpan(),
+                         ToGridFixed(ToDouble(gridCursor.ToGridSpace(waxLine->GetYPosition()))),
+                         ToGridFixed(ToDouble(waxLine->GetLineHeight())), shift);
+        }
+    }
+    
+    // Align all stories of the document as a pipeline: while story N is computed
+    // on a worker thread, this thread snapshots story N+1 and commits story N-1.
+    // Stories on visible spreads go first, the rest by distance from the viewport.
+    // All commits go to one command sequence, so the whole run is one undo step.
+    void AlignDocumentToBaselineGrid() {
+        AlignmentRunScope runScope;
+        AlignmentTraceScope runSpan("Align:Document");
+        RunArenaScope arenaScope(fArenas);
+        
+        InterfacePtr<ICommandSequence> cmdSeq;
+        
+        try {
+            IDocument* document = GetExecutionContextDocument();
+            if (!document) return;
+            
+            InterfacePtr<IStoryList> storyList(document, UseDefaultIID());
+            if (!storyList) return;
+            
+            RefreshDocumentGrid();
+            OpenFingerprintCache();
+            
+            const int32 alignmentType = fSettings ? fSettings->GetAlignmentType() : kAlignmentTypeTracking;
+            RecordedRunScope recordedRun(fRecorder, kRecordedRunDocument,
+                                         GetRecordedSettings(alignmentType), GetDocumentGrid());
+            OpenStatsStream();
+            AlignmentStatsRunScope statsRun(fStats, kStatsRunDocument, alignmentType);
+            
+            switch (alignmentType) {
+                case kAlignmentTypeBaseline:
+                case kAlignmentTypeLines:
+                    AlignStoryGeometryPipelined(storyList, alignmentType == kAlignmentTypeLines, cmdSeq);
+                    break;
+                case kAlignmentTypeTracking:
+                    AlignStyleRunsPipelined<TrackingStrategy>(storyList, cmdSeq);
+                    break;
+                case kAlignmentTypeWordSpacing:
+                    AlignStyleRunsPipelined<WordSpacingStrategy>(storyList, cmdSeq);
+                    break;
+                case kAlignmentTypeCombined:
+                    AlignStyleRunsPipelined<CombinedStrategy>(storyList, cmdSeq);
+                    break;
+                case kAlignmentTypeLeading:
+                    AlignStyleRunsPipelined<LeadingStrategy>(storyList, cmdSeq);
+                    break;
             }
-            else if (fSettings) {
-                // In preview mode, highlight the text that would be affected
-                PMColor highlightColor = fSettings->GetHighlightColor();
-                // Code to apply highlight would go here
-                // This would depend on how highlighting is implemented in InDesign
+            
+            fFingerprints.Flush();
+        }
+        catch (CancelException&) {
+            AlignmentCounters::Instance().CancelObserved();
+        }
+        catch (...) {
+            if (fSettings && fSettings->GetShowWarnings()) {
+                Utils<IErrorLog>()->LogError(kBaselineGridPluginID, "Kritická chyba během zarovnávání dokumentu");
             }
+            EndCommandSequence(cmdSeq);
+            throw;
         }
+        
+        EndCommandSequence(cmdSeq);
     }
     
-    void AlignTracking(ITextModel* textModel, TextIndex start, TextIndex end, 
-                      bool previewOnly, ICommandSequence* cmdSeq) {
-        // Calculate optimal scale factor
-        const PMReal scaleFactor = CalculateOptimalScale(fCachedGridSize, textModel, start);
+    // Baseline and line modes: snapshot parcels or composed lines, compute corrections off the main thread
+    void AlignStoryGeometryPipelined(IStoryList* storyList, bool lines, InterfacePtr<ICommandSequence>& cmdSeq) {
+        const size_t storyCount = storyList->GetUserAccessibleStoryCount();
+        size_t committed = 0;
+        ViewportSchedule stories = ScheduleStories(storyList);
         
-        InterfacePtr<ITextAttributes> textAttributes(textModel->QueryTextAttributes(start));
-        if (!textAttributes) return;
+        fArenas.ResizeItems(PipelineItemsInFlight(kPipelineDepth));
+        RunAlignmentPipeline<StorySnapshot, StoryChanges>(
+            storyCount, kPipelineDepth,
+            [this, storyList, &stories, lines](size_t item) {
+                size_t story = 0;
+                stories.Next(GetViewport(), story);
+                StorySnapshot snapshot = SnapshotStoryGeometry(
+                    storyList->GetNthUserAccessibleStoryUID(static_cast<int32>(story)), lines,
+                    fArenas.ForItem(item));
+                RecordStoryGeometry(snapshot, lines);
+                return snapshot;
+            },
+            [this, lines](StorySnapshot&& snapshot) {
+                return ComputeStoryGeometry(std::move(snapshot), lines);
+            },
+            [this, lines, &cmdSeq, &committed, storyCount](StoryChanges& changes) {
+                CommitStoryChanges(changes, cmdSeq,
+                    [this, lines](ITextModel* textModel, StoryChanges& storyChanges, ICommandSequence* sequence) {
+                        if (!lines) {
+                            AlignmentCounters::Instance().Add(kCounterParcelsModified, storyChanges.fBaseline.size());
+                        }
+                        ApplyBaselineCorrections(textModel, storyChanges.fBaseline, sequence);
+                    });
+                fStats.PublishProgress(static_cast<float>(++committed) / storyCount);
+            });
+    }
+    
+    // Attribute strategies: snapshot style runs, compute corrections off the main thread
+    template <class Strategy>
+    void AlignStyleRunsPipelined(IStoryList* storyList, InterfacePtr<ICommandSequence>& cmdSeq) {
+        StyleRunParameters parameters;
+        parameters.fWordSpacingFactor = fSettings ? ToDouble(fSettings->GetWordSpacingFactor()) : 1.0;
+        parameters.fLeadingMultiple = fSettings ? fSettings->GetLeadingMultiple() : 0;
+        
+        const size_t storyCount = storyList->GetUserAccessibleStoryCount();
+        size_t committed = 0;
+        ViewportSchedule stories = ScheduleStories(storyList);
         
-        // Calculate new tracking
-        const PMReal currentTracking = textAttributes->QueryTracking();
-        const PMReal newTracking = currentTracking * scaleFactor;
+        fArenas.ResizeItems(PipelineItemsInFlight(kPipelineDepth));
+        RunAlignmentPipeline<StorySnapshot, StoryChanges>(
+            storyCount, kPipelineDepth,
+            [this, storyList, &stories](size_t item) {
+                size_t story = 0;
+                stories.Next(GetViewport(), story);
+                StorySnapshot snapshot = SnapshotStoryStyleRuns<Strategy>(
+                    storyList->GetNthUserAccessibleStoryUID(static_cast<int32>(story)), fArenas.ForItem(item));
+                fRecorder.RecordStyleRuns(snapshot.fStory.GetUID().Get(), snapshot.fRuns.data(), snapshot.fRuns.size());
+                return snapshot;
+            },
+            [this, parameters](StorySnapshot&& snapshot) {
+                return ComputeStoryStyleRuns<Strategy>(std::move(snapshot), parameters);
+            },
+            [this, &cmdSeq, &committed, storyCount](StoryChanges& changes) {
+                CommitStoryChanges(changes, cmdSeq,
+                    [this](ITextModel* textModel, StoryChanges& storyChanges, ICommandSequence* sequence) {
+                        ApplyStyleRunChanges<Strategy>(textModel, storyChanges.fRuns,
+                                                       storyChanges.fRunCorrections, sequence);
+                    });
+                fStats.PublishProgress(static_cast<float>(++committed) / storyCount);
+            });
+    }
+    
+    // Every snapshot is recorded, even an empty one, so replay pairs results with snapshots in order
+    void RecordStoryGeometry(const StorySnapshot& snapshot, bool lines) {
+        if (!fRecorder.IsRecording()) return;
         
-        // Apply change if not in preview mode
-        if (!previewOnly) {
-            CmdUtils::ProcessCommand(cmdSeq,
-                textAttributes->ApplyTrackingSpan(newTracking, start, end - start));
+        if (lines) {
+            fRecorder.RecordLines(snapshot.fStory.GetUID().Get(), snapshot.fLines, snapshot.fLineGrids);
         }
-        else if (fSettings) {
-            // In preview mode, highlight the text that would be affected
-            PMColor highlightColor = fSettings->GetHighlightColor();
-            // Code to apply highlight would go here
+        else {
+            fRecorder.RecordParcels(snapshot.fStory.GetUID().Get(), snapshot.fParcels.data(), snapshot.fParcels.size());
         }
     }
     
-    void AlignWordSpacing(ITextModel* textModel, TextIndex start, TextIndex end, 
-                         bool previewOnly, ICommandSequence* cmdSeq) {
-        // Get word spacing factor from settings
-        PMReal wordSpacingFactor = 1.0;
-        if (fSettings) {
-            wordSpacingFactor = fSettings->GetWordSpacingFactor();
+    void ThrowIfCancelled() {
+        if (Utils<IUserCancel>()->WasCancelled()) {
+            AlignmentCounters::Instance().CancelRequested();
+            throw CancelException();
         }
+    }
+    
+    // Snapshot stage, main thread: read parcel offsets or composed lines of one story into its arena
+    StorySnapshot SnapshotStoryGeometry(const UIDRef& storyRef, bool lines, RunArena& arena) {
+        ThrowIfCancelled();
+        AlignmentTraceScope snapshotSpan("Pipeline:Snapshot");
         
-        InterfacePtr<ITextAttributes> textAttributes(textModel->QueryTextAttributes(start));
-        if (!textAttributes) return;
-        
-        // Calculate optimal scale factor
-        const PMReal scaleFactor = CalculateOptimalScale(fCachedGridSize, textModel, start);
+        StorySnapshot snapshot(&arena);
+        snapshot.fStory = storyRef;
         
-        // Calculate new word spacing
-        const PMReal currentWordSpacing = textAttributes->QueryWordSpacing();
-        const PMReal newWordSpacing = currentWordSpacing * scaleFactor * wordSpacingFactor;
+        InterfacePtr<ITextModel> textModel(storyRef, UseDefaultIID());
+        if (!textModel) return snapshot;
         
-        // Apply change if not in preview mode
-        if (!previewOnly) {
-            CmdUtils::ProcessCommand(cmdSeq,
-                textAttributes->ApplyWordSpacingSpan(newWordSpacing, start, end - start));
+        const TextIndex end = textModel->TotalLength();
+        if (lines) {
+            QueryLineMetrics(textModel, 0, end, snapshot.fLines, snapshot.fLineGrids);
+            return snapshot;
         }
-        else if (fSettings) {
-            // In preview mode, highlight the text that would be affected
-            PMColor highlightColor = fSettings->GetHighlightColor();
-            // Code to apply highlight would go here
+        
+        InterfacePtr<ITextParcelList> parcelList(textModel, UseDefaultIID());
+        if (!parcelList) return snapshot;
+        
+        // Parcels, or the whole story, verified on the grid before are left out of the snapshot
+        snapshot.fFingerprint = GetStoryFingerprint(textModel, kFingerprintCheckBaseline, 0);
+        ParcelRangeList parcels(arena);
+        CollectParcelsInRange(textModel, parcelList, 0, end, snapshot.fFingerprint, parcels);
+        
+        snapshot.fStoryFingerprint = parcels.fStoryFingerprint;
+        snapshot.fParcels.reserve(parcels.fIndex.size());
+        for (int32 i = 0; i < static_cast<int32>(parcels.fIndex.size()); i++) {
+            snapshot.fParcels.push_back(ParcelOffset{parcels.fStart[i], parcels.fLength[i],
+                                                     parcels.fBaseline[i], parcels.fGrid[i]});
         }
+        snapshot.fParcelFingerprints = std::move(parcels.fFingerprint);
+        return snapshot;
     }
     
-    void AlignCombined(ITextModel* textModel, TextIndex start, TextIndex end, 
-                      bool previewOnly, ICommandSequence* cmdSeq) {
-        // Get word spacing factor from settings
-        PMReal wordSpacingFactor = 1.0;
-        if (fSettings) {
-            wordSpacingFactor = fSettings->GetWordSpacingFactor();
+    // Compute stage, worker thread: pure grid arithmetic on the snapshot, in the same planned
+    // loops as the selection flow. Only this stage runs loops while the pipeline runs.
+    StoryChanges ComputeStoryGeometry(StorySnapshot&& snapshot, bool lines) {
+        AlignmentTraceScope computeSpan("Pipeline:Compute");
+        
+        StoryChanges changes(snapshot.fArena);
+        changes.fStory = snapshot.fStory;
+        changes.fFingerprint = snapshot.fFingerprint;
+        
+        if (lines) {
+            FindOffGridLinesPlanned(fLinesPolicy, snapshot.fLines, snapshot.fLineGrids, snapshot.fArena,
+                                    changes.fBaseline, &changes.fHistogram);
+            return changes;
         }
         
-        // Calculate optimal scale factor
-        const PMReal scaleFactor = CalculateOptimalScale(fCachedGridSize, textModel, start);
+        ComputeParcelCorrectionsPlanned(fBaselinePolicy, snapshot.fParcels.data(), snapshot.fParcels.size(),
+                                        snapshot.fArena, changes.fBaseline, changes.fVerified, &changes.fHistogram);
         
-        InterfacePtr<ITextAttributes> textAttributes(textModel->QueryTextAttributes(start));
-        if (!textAttributes) return;
+        // Verified parcels keep snapshot order, so their fingerprints are found in one pass
+        changes.fVerifiedFingerprints.reserve(changes.fVerified.size());
+        size_t p = 0;
+        for (const ParcelOffset& parcel : changes.fVerified) {
+            while (snapshot.fParcels[p].fStart != parcel.fStart) {
+                p++;
+            }
+            changes.fVerifiedFingerprints.push_back(snapshot.fParcelFingerprints[p]);
+        }
         
-        // Calculate new tracking and word spacing
-        const PMReal currentTracking = textAttributes->QueryTracking();
-        const PMReal newTracking = currentTracking * scaleFactor;
+        // A story whose parcels all verified is skipped as a whole next time
+        if (changes.fVerified.size() == snapshot.fParcels.size()) {
+            changes.fStoryFingerprint = snapshot.fStoryFingerprint;
+        }
+        return changes;
+    }
+    
+    // Snapshot stage, main thread: split one story into style runs in its arena and read their attributes
+    template <class Strategy>
+    StorySnapshot SnapshotStoryStyleRuns(const UIDRef& storyRef, RunArena& arena) {
+        ThrowIfCancelled();
+        AlignmentTraceScope snapshotSpan("Pipeline:Snapshot");
         
-        const PMReal currentWordSpacing = textAttributes->QueryWordSpacing();
-        const PMReal newWordSpacing = currentWordSpacing * scaleFactor * wordSpacingFactor;
+        StorySnapshot snapshot(&arena);
+        snapshot.fStory = storyRef;
         
-        // Apply changes if not in preview mode
-        if (!previewOnly) {
-            CmdUtils::ProcessCommand(cmdSeq,
-                textAttributes->ApplyTrackingSpan(newTracking, start, end - start));
+        InterfacePtr<ITextModel> textModel(storyRef, UseDefaultIID());
+        if (!textModel) return snapshot;
+        
+        snapshot.fRuns = CollectStyleRuns(textModel, 0, textModel->TotalLength(), arena);
+        for (StyleRunSnapshot& run : snapshot.fRuns) {
+            QueryStyleRunAttributes<Strategy>(textModel, run);
+        }
+        return snapshot;
+    }
+    
+    // Compute stage, worker thread. Only this stage uses the scale cache while the pipeline runs.
+    template <class Strategy>
+    StoryChanges ComputeStoryStyleRuns(StorySnapshot&& snapshot, const StyleRunParameters& parameters) {
+        AlignmentTraceScope computeSpan("Pipeline:Compute");
+        
+        StoryChanges changes(snapshot.fArena);
+        changes.fStory = snapshot.fStory;
+        
+        ComputeStyleRunChangesPlanned<Strategy>(fStyleRunPolicy, snapshot.fRuns.data(), snapshot.fRuns.size(),
+                                                parameters, fScaleCache, snapshot.fArena,
+                                                changes.fRuns, changes.fRunCorrections);
+        return changes;
+    }
+    
+    // Commit stage, main thread: apply the changes of one story, then cache its verified parcels.
+    // The command sequence is opened by the first story that has something to change.
+    template <class ApplyFn>
+    void CommitStoryChanges(StoryChanges& changes, InterfacePtr<ICommandSequence>& cmdSeq, ApplyFn apply) {
+        ThrowIfCancelled();
+        AlignmentTraceScope commitSpan("Pipeline:Commit");
+        
+        // A story holds either geometry or style run changes
+        if (fRecorder.IsRecording()) {
+            fRecorder.RecordResult(changes.fStory.GetUID().Get(), changes.fBaseline.size() + changes.fRuns.size(),
+                                   changes.fRuns.empty()
+                                       ? ChecksumCorrections(changes.fBaseline.data(), changes.fBaseline.size())
+                                       : ChecksumStyleRunChanges(changes.fRuns.data(), changes.fRunCorrections.data(),
+                                                                 changes.fRuns.size()));
+        }
+        fStats.AddHistogram(changes.fHistogram);
+        
+        if (!changes.IsEmpty()) {
+            InterfacePtr<ITextModel> textModel(changes.fStory, UseDefaultIID());
+            if (!textModel) return;
             
-            CmdUtils::ProcessCommand(cmdSeq,
-                textAttributes->ApplyWordSpacingSpan(newWordSpacing, start, end - start));
+            BeginCommandSequence(cmdSeq);
+            apply(textModel, changes, cmdSeq);
         }
-        else if (fSettings) {
-            // In preview mode, highlight the text that would be affected
-            PMColor highlightColor = fSettings->GetHighlightColor();
-            // Code to apply highlight would go here
+        
+        // Parcels found on the grid are cached only once the story's changes went in
+        for (size_t i = 0; i < changes.fVerified.size(); i++) {
+            fFingerprints.Store(ParcelKey(changes.fFingerprint, changes.fVerified[i].fStart),
+                                changes.fVerifiedFingerprints[i]);
         }
+        if (changes.fStoryFingerprint != 0) {
+            fFingerprints.Store(StoryVerifiedKey(changes.fFingerprint), changes.fStoryFingerprint);
+        }
+    }
+    
+    void HighlightChanges(const AlignmentChanges& changes) {
+        if (!fSettings || changes.IsEmpty()) return;
+        
+        // In preview mode, highlight the text that would be affected
+        PMColor highlightColor = fSettings->GetHighlightColor();
+        // Code to apply highlight would go here
+        // This would depend on how highlighting is implemented in InDesign
     }
 
-    PMReal CalculateOptimalScale(PMReal gridSize, ITextModel* textModel, TextIndex start) {
-        InterfacePtr<ICompositionStyle> style(textModel->QueryParcelCompositionStyleAt(start));
-        if(!style) return 1.0;
+    // Build the attribute list for one run so all attributes change in a single command
+    template <class Strategy>
+    AttributeBossList* CreateStyleRunAttributes(const StyleRunCorrection& correction) {
+        AttributeBossList* attributes = new AttributeBossList();
+        
+        if constexpr (Strategy::kTouchesTracking) {
+            InterfacePtr<ITextAttrRealNumber> trackingAttr(
+                ::CreateObject2<ITextAttrRealNumber>(kTextAttrTrackKernBoss));
+            trackingAttr->SetRealNumber(correction.fTracking);
+            attributes->ApplyAttribute(trackingAttr);
+        }
+        if constexpr (Strategy::kTouchesWordSpacing) {
+            InterfacePtr<ITextAttrRealNumber> wordSpacingAttr(
+                ::CreateObject2<ITextAttrRealNumber>(kTextAttrWordspaceDesBoss));
+            wordSpacingAttr->SetRealNumber(correction.fWordSpacing);
+            attributes->ApplyAttribute(wordSpacingAttr);
+        }
+        if constexpr (Strategy::kTouchesLeading) {
+            InterfacePtr<ITextAttrRealNumber> leadingAttr(
+                ::CreateObject2<ITextAttrRealNumber>(kTextAttrLeadingBoss));
+            leadingAttr->SetRealNumber(FromGridFixed(correction.fLeading));
+            attributes->ApplyAttribute(leadingAttr);
+        }
+        
+        return attributes;
+    }
+    
+    // Attributes defined by the paragraph style at a text position; nil if it has none
+    ITextAttributes* QueryParagraphStyleAttributes(ITextModel* textModel, TextIndex position) {
+        InterfacePtr<IAttributeStrand> paraStrand(
+            static_cast<IAttributeStrand*>(textModel->QueryStrand(kParaAttrStrandBoss, IID_IATTRIBUTESTRAND)));
+        if (!paraStrand) return nil;
         
-        const PMReal fontSize = style->GetFontSize();
-        if(fontSize <= 0) return 1.0;
+        const UID styleUID = paraStrand->GetStyleUID(position);
+        if (styleUID == kInvalidUID) return nil;
         
-        return (round(fontSize / gridSize) * gridSize / fontSize);
+        InterfacePtr<ITextAttributes> styleAttributes(::GetDataBase(textModel), styleUID, UseDefaultIID());
+        return styleAttributes.forget();
+    }
+    
+    // Split [start, end) into runs of uniform character attributes,
+    // each with the grid increment of the frame where it starts.
+    // Runs starting on a grid too fine to align to are left out.
+    ArenaVector<StyleRunSnapshot> CollectStyleRuns(ITextModel* textModel, TextIndex start, TextIndex end,
+                                                   RunArena& arena) {
+        ArenaVector<StyleRunSnapshot> runs(ArenaAllocator<StyleRunSnapshot>(&arena));
+        
+        InterfacePtr<ITextParcelList> parcelList(textModel, UseDefaultIID());
+        TextGridCursor gridCursor(*this, parcelList);
+        
+        InterfacePtr<IAttributeStrand> charStrand(
+            static_cast<IAttributeStrand*>(textModel->QueryStrand(kCharAttrStrandBoss, IID_IATTRIBUTESTRAND)));
+        if (!charStrand) {
+            // Fall back to treating the whole range as one run
+            if (end > start && IsAlignableGrid(gridCursor.At(start))) {
+                runs.push_back(StyleRunSnapshot{start, end - start, 0, 0.0, 0.0, 0.0, 0.0, 0,
+                                                gridCursor.At(start).fIncrement});
+            }
+            return runs;
+        }
+        
+        TextIndex position = start;
+        while (position < end) {
+            const int32 runLength = charStrand->GetRunLength(position);
+            const int32 length = std::max<int32>(1, std::min<int32>(runLength, end - position));
+            const BaselineGrid grid = gridCursor.At(position);
+            if (IsAlignableGrid(grid)) {
+                runs.push_back(StyleRunSnapshot{position, length, 0, 0.0, 0.0, 0.0, 0.0, 0, grid.fIncrement});
+            }
+            position += length;
+        }
+        return runs;
     }
 
     void GenerateAlignmentReport(ITextModel* textModel, TextIndex start, TextIndex end) {
@@ -433,72 +1534,505 @@ private:
         if(!parcelList) return;
         
         const PMReal dpiScale = DPIScaler::GetScale();
-        const PMReal tolerance = 0.1 * dpiScale;
+        const GridFixed tolerance = ToGridFixed(0.1 * ToDouble(dpiScale));
         
-        int32 parcelCount = parcelList->GetParcelCount();
         InterfacePtr<IProgressBar> progressBar(this, IID_IPROGRESS);
         
-        // Use OpenMP for parallelization if available
-        std::vector<std::pair<TextIndex, PMString>> misalignments;
+        // Parcels that passed the report before are skipped, newly passing ones cached
+        const StoryFingerprint story = GetStoryFingerprint(textModel, kFingerprintCheckReport, tolerance);
+        ParcelRangeList parcels(fArenas.Main());
+        CollectParcelsInRange(textModel, parcelList, start, end, story, parcels);
+        const int32 itemCount = static_cast<int32>(parcels.fIndex.size());
+        const int threadLimit = fReportPolicy.GetThreadLimit();
         
-        #pragma omp parallel for schedule(dynamic) if(_OPENMP)
-        for(int32 p = 0; p < parcelCount; p++) {
+        // Findings are grouped as they are found. Each thread keeps the first findings
+        // in text order up to the detail limit, so after the merge the export holds
+        // the first kMaxFindings of the range, whatever the thread count or viewport.
+        PerThreadVectors<AlignmentFinding> threadFindings(fArenas, threadLimit);
+        if (fReportThreadGroups.size() < static_cast<size_t>(threadLimit)) {
+            fReportThreadGroups.resize(threadLimit);
+        }
+        for (int t = 0; t < threadLimit; t++) {
+            fReportThreadGroups[t].Clear();
+        }
+        
+        PerThreadVectors<int32> threadVerified(fArenas, threadLimit);
+        std::mutex progressLock;
+        
+        // Parcels in view are checked first, the rest by distance from the viewport
+        ForEachViewportWave(parcels, fReportPolicy, [&](const ParallelPlan& plan, const int32* order,
+                                                        const ViewportWave& wave) {
+        ParallelForChunks(plan, "Report:Worker", [&](int32 c) {
+        ArenaVector<AlignmentFinding>& localFindings = threadFindings.Local();
+        AlignmentFindingGroups& localGroups = fReportThreadGroups[RunThreadIndex()];
+        ArenaVector<int32>& localVerified = threadVerified.Local();
+        AlignmentCounterSum criticalNanos(kCounterCriticalSectionNanos);
+        
+        for(int32 n = plan.fChunkBounds[c]; n < plan.fChunkBounds[c + 1]; n++) {
             if(Utils<IUserCancel>()->WasCancelled()) {
-                #pragma omp critical
-                {
-                    throw CancelException();
-                }
+                AlignmentCounters::Instance().CancelRequested();
+                throw CancelException();
             }
             
+            const int32 done = static_cast<int32>(wave.fBegin) + n;
             if(progressBar) {
-                const float progress = static_cast<float>(p) / parcelCount;
-                #pragma omp critical
-                {
-                    progressBar->SetValue(progress);
-                }
+                const float progress = static_cast<float>(done) / itemCount;
+                AlignmentCounterSum::Span criticalSpan(criticalNanos);
+                std::lock_guard<std::mutex> lock(progressLock);
+                progressBar->SetValue(progress);
+            }
+            if((done & kStatsProgressMask) == 0) {
+                fStats.PublishProgress(static_cast<float>(done) / itemCount);
             }
             
-            TextIndex parcelStart, parcelEnd;
-            parcelList->GetParcelRange(p, &parcelStart, &parcelEnd);
-            
-            if(parcelEnd < start || parcelStart > end) continue;
-            
-            InterfacePtr<ICompositionStyle> style(parcelList->QueryParcelCompositionStyle(p));
-            if(!style) continue;
+            const int32 i = order[n];
+            const TextIndex parcelStart = parcels.fStart[i];
             
             // Check alignment
-            const PMReal baseline = style->GetBaselineOffset();
-            const PMReal lineHeight = style->GetLeading();
+            const GridFixed baseline = parcels.fBaseline[i];
+            const GridFixed lineHeight = parcels.fLeading[i];
             
-            if(fabs(round(baseline / fCachedGridSize) * fCachedGridSize - baseline) > tolerance) {
-                #pragma omp critical
-                {
-                    misalignments.push_back(std::make_pair(parcelStart, PMString("Nesprávná baseline")));
-                }
+            const GridFixed gridSize = parcels.fGrid[i].fIncrement;
+            const uint32_t failed = CheckParcelRules(baseline, lineHeight, gridSize, tolerance);
+            
+            if(failed == 0) {
+                localVerified.push_back(i);
+                continue;
             }
             
-            if(fabs(round(lineHeight / fCachedGridSize) * fCachedGridSize - lineHeight) > tolerance) {
-                #pragma omp critical
-                {
-                    misalignments.push_back(std::make_pair(parcelStart, PMString("Nesprávný leading")));
-                }
+            // Paragraph style for grouping, read with the other parcel attributes
+            const uint32 paraStyle = parcels.fParaStyle[i];
+            for(int32 rule = 0; rule < kRuleCount; rule++) {
+                if(!(failed & (1u << rule))) continue;
+                
+                const GridFixed measured = rule == kRuleBaselineOffGrid ? baseline : lineHeight;
+                const AlignmentFinding finding{measured, SnapToGrid(measured, gridSize), parcelStart,
+                                               static_cast<AlignmentRule>(rule)};
+                localGroups.Add(finding, paraStyle);
+                KeepFirstFindings(localFindings, finding, AlignmentReportDetail::kMaxFindings);
             }
         }
+        });
+        },
+        [](const ViewportWave&) { return true; });
+        
+        // The report changes nothing, so what passed can be cached right away
+        ArenaVector<VerifiedParcel> verified(ArenaAllocator<VerifiedParcel>(&fArenas.Main()));
+        CollectVerifiedParcels(story, parcels, threadVerified, verified);
+        StoreVerifiedParcels(verified);
+        
+        AlignmentFindingGroups& groups = fReportGroups;
+        groups.Clear();
+        for (int t = 0; t < threadLimit; t++) {
+            groups.Merge(fReportThreadGroups[t]);
+        }
+        AlignmentCounters::Instance().Add(kCounterMisalignmentsFound, groups.GetFindingCount());
         
-        // Sort misalignments by text index
-        std::sort(misalignments.begin(), misalignments.end(), 
-            [](const auto& a, const auto& b) { return a.first < b.first; });
+        // Keep the detail sorted by text index for export on request
+        ArenaVector<AlignmentFinding> findings(ArenaAllocator<AlignmentFinding>(&fArenas.Main()));
+        threadFindings.MergeInto(findings);
+        std::sort(findings.begin(), findings.end(), FindingPrecedes);
+        if (findings.size() > AlignmentReportDetail::kMaxFindings) {
+            findings.resize(AlignmentReportDetail::kMaxFindings);
+        }
+        
+        const FindingLanguage language = GetFindingLanguage();
+        AlignmentReportDetail::Instance().Store(findings.data(), findings.size(), groups.GetFindingCount(), language);
         
-        // Report misalignments
+        // One log entry per group; messages are built only here, when findings are shown
         InterfacePtr<IErrorLog> log(GetExecutionContextSession()->QueryErrorLog());
-        for (const auto& misalignment : misalignments) {
-            PMString reportMsg = misalignment.second;
-            reportMsg += " na pozici ";
-            reportMsg.AppendNumber(misalignment.first);
-            
+        for (const AlignmentFindingGroup& group : groups.Sorted()) {
+            PMString reportMsg(AlignmentFindingFormatter::FormatGroup(
+                group, GetParagraphStyleName(textModel, group.fStyle), language).c_str());
             log->AddEntry(kBaselineGridPluginID, reportMsg, IErrorLog::kWarning);
         }
     }
+    
+    // Name of a paragraph style for report summaries; empty if unknown
+    std::string GetParagraphStyleName(ITextModel* textModel, uint32 styleUID) const {
+        if (styleUID == 0 || styleUID == AlignmentFindingGroup::kOverflowStyle) return std::string();
+        
+        InterfacePtr<IStyleInfo> styleInfo(::GetDataBase(textModel), UID(styleUID), UseDefaultIID());
+        if (!styleInfo) return std::string();
+        
+        return styleInfo->GetName().GetPlatformString();
+    }
+
+    // Map the fingerprint cache of the current document, one file per document file.
+    // Unsaved documents have no lasting identity and are not cached.
+    void OpenFingerprintCache() {
+        IDocument* document = GetExecutionContextDocument();
+        IDataBase* database = document ? ::GetDataBase(document) : nil;
+        const IDFile* documentFile = database ? database->GetSysFile() : nil;
+        if (!documentFile) {
+            fFingerprints.Close();
+            return;
+        }
+        
+        // Documents of the same name in different folders get different caches
+        const std::string platformPath = FileUtils::SysFileToPMString(*documentFile).GetPlatformString();
+        uint64 pathHash = AlignmentFingerprintCache::kHashSeed;
+        for (const char c : platformPath) {
+            pathHash = AlignmentFingerprintCache::Mix(pathHash, static_cast<unsigned char>(c));
+        }
+        
+        std::error_code error;
+        const std::filesystem::path directory =
+            std::filesystem::temp_directory_path(error) / kBaselineGridAlignerCacheFolderName;
+        if (error) return;
+        std::filesystem::create_directories(directory, error);
+        
+        char fileName[32];
+        snprintf(fileName, sizeof(fileName), "%016llx" kBaselineGridAlignerCacheExtension,
+                 static_cast<unsigned long long>(pathHash));
+        const std::string path = (directory / fileName).string();
+        
+        // Without a cache every parcel is simply checked again
+        if (fFingerprints.GetPath() != path) {
+            fFingerprints.Open(path);
+        }
+    }
+    
+    // Map the live stats file the companion app reads; without it publishing does nothing
+    void OpenStatsStream() {
+        if (fStats.IsOpen()) return;
+        
+        std::error_code error;
+        const std::filesystem::path directory = std::filesystem::temp_directory_path(error);
+        if (error) return;
+        
+        fStats.Open((directory / kBaselineGridAlignerStatsFileName).string());
+    }
+    
+    // Install the idle task that forwards queued telemetry; main thread, once per aligner
+    void StartTelemetryForwarding() {
+        if (fTelemetryTask) return;
+        
+        fTelemetryTask.reset(::CreateObject2<IIdleTask>(kBaselineGridAlignerTelemetryTaskImpl));
+        if (fTelemetryTask) {
+            fTelemetryTask->InstallTask(AlignmentTelemetry::kDrainIntervalMillis);
+        }
+    }
+    
+    // Start a run off the calling thread and keep its future: the future of a
+    // std::async task blocks in its destructor, so a discarded one would make
+    // the caller wait for the whole run. The previous run has finished by now,
+    // since fIsProcessing is cleared only at its end.
+    template <class RunFn>
+    void StartProcessing(RunFn run) {
+        StartTelemetryForwarding();
+        fIsProcessing = true;
+        fProcessing = std::async(std::launch::async, [this, run] {
+            try {
+                run();
+            }
+            catch (...) {
+                fIsProcessing = false;
+                throw;
+            }
+            fIsProcessing = false;
+        });
+    }
+    
+    // Sink of AlignmentTelemetry, called on the main thread with one summary per event and window
+    static void ForwardTelemetry(const AlignmentTelemetrySummary& summary) {
+        ISession* session = GetExecutionContextSession();
+        if (!session) return;
+        
+        const char* name = AlignmentTelemetry::GetName(summary.fEvent);
+        
+        if (summary.fEvent != kTelemetryAlign && summary.fCount > 0) {
+            InterfacePtr<ITelemetry> telemetry(session, UseDefaultIID());
+            if (telemetry) {
+                telemetry->LogEvent(name);
+            }
+        }
+        
+        InterfacePtr<IAnalytics> analytics(session, UseDefaultIID());
+        if (!analytics) return;
+        
+        analytics->LogEvent(name, "Count", static_cast<int64>(summary.fCount));
+        if (summary.fEvent == kTelemetryAlign) {
+            analytics->LogEvent(name, "Range", summary.fValueSum);
+            analytics->LogEvent(name, "DurationP50Micros", static_cast<int64>(summary.fDurationP50Micros));
+            analytics->LogEvent(name, "DurationP95Micros", static_cast<int64>(summary.fDurationP95Micros));
+            analytics->LogEvent(name, "DurationP99Micros", static_cast<int64>(summary.fDurationP99Micros));
+            analytics->LogEvent(name, "DurationMaxMicros", static_cast<int64>(summary.fDurationMaxMicros));
+        }
+        if (summary.fDropped > 0) {
+            analytics->LogEvent(name, "Dropped", static_cast<int64>(summary.fDropped));
+        }
+    }
+    
+    static uint64 StoryEpochKey(uint32 storyID) {
+        return AlignmentFingerprintCache::Mix(
+            AlignmentFingerprintCache::Mix(AlignmentFingerprintCache::kHashSeed, storyID), 0);
+    }
+    
+    // Changing the epoch of a story makes all its cached parcels stale at once
+    void InvalidateStoryFingerprints(uint32 storyID) {
+        const uint64 key = StoryEpochKey(storyID);
+        fFingerprints.Store(key, fFingerprints.Get(key) + 1);
+    }
+    
+    // UID 0 is never a story, so its epoch counts style definition changes of the document
+    void InvalidateStyleFingerprints() {
+        InvalidateStoryFingerprints(0);
+    }
+    
+    StoryFingerprint GetStoryFingerprint(ITextModel* textModel, FingerprintCheck check, GridFixed tolerance) {
+        const uint32 storyID = ::GetUID(textModel).Get();
+        return StoryFingerprint{storyID, fFingerprints.Get(StoryEpochKey(storyID)),
+                                fFingerprints.Get(StoryEpochKey(0)), check, tolerance};
+    }
+    
+    uint64 ParcelKey(const StoryFingerprint& story, TextIndex parcelStart) const {
+        uint64 key = AlignmentFingerprintCache::Mix(AlignmentFingerprintCache::kHashSeed, story.fStoryID);
+        key = AlignmentFingerprintCache::Mix(key, story.fCheck);
+        return AlignmentFingerprintCache::Mix(key, static_cast<uint64>(parcelStart));
+    }
+    
+    // Parcel starts are never negative, so the story entry can't collide with a parcel
+    uint64 StoryVerifiedKey(const StoryFingerprint& story) const {
+        return ParcelKey(story, -1);
+    }
+    
+    // What the check depended on, all known before the parcel's attributes are read:
+    // story and style epochs, parcel geometry and frame, grid and tolerance. Attribute
+    // edits reach the cache through the epochs, which the observer bumps on every
+    // text, frame and style change outside our own runs.
+    static uint64 ParcelFingerprint(const StoryFingerprint& story, TextIndex start, int32 length,
+                                    uint32 frameID, const BaselineGrid& grid) {
+        uint64 fingerprint = AlignmentFingerprintCache::Mix(AlignmentFingerprintCache::kHashSeed, story.fEpoch);
+        fingerprint = AlignmentFingerprintCache::Mix(fingerprint, story.fStyleEpoch);
+        fingerprint = AlignmentFingerprintCache::Mix(fingerprint, static_cast<uint64>(start));
+        fingerprint = AlignmentFingerprintCache::Mix(fingerprint, static_cast<uint64>(length));
+        fingerprint = AlignmentFingerprintCache::Mix(fingerprint, frameID);
+        fingerprint = AlignmentFingerprintCache::Mix(fingerprint, static_cast<uint64>(grid.fIncrement));
+        fingerprint = AlignmentFingerprintCache::Mix(fingerprint, static_cast<uint64>(grid.fStart));
+        return AlignmentFingerprintCache::Mix(fingerprint, static_cast<uint64>(story.fTolerance));
+    }
+    
+    // The whole story for one check: epochs, text length, parcel count and the document grid.
+    // Checked before any parcel is read, so a verified story costs two cache lookups.
+    uint64 StoryVerifiedFingerprint(const StoryFingerprint& story, int32 textLength, int32 parcelCount) const {
+        uint64 fingerprint = AlignmentFingerprintCache::Mix(AlignmentFingerprintCache::kHashSeed, story.fEpoch);
+        fingerprint = AlignmentFingerprintCache::Mix(fingerprint, story.fStyleEpoch);
+        fingerprint = AlignmentFingerprintCache::Mix(fingerprint, static_cast<uint64>(textLength));
+        fingerprint = AlignmentFingerprintCache::Mix(fingerprint, static_cast<uint64>(parcelCount));
+        fingerprint = AlignmentFingerprintCache::Mix(fingerprint, static_cast<uint64>(fCachedGridSize));
+        fingerprint = AlignmentFingerprintCache::Mix(fingerprint, static_cast<uint64>(fCachedGridStart));
+        fingerprint = AlignmentFingerprintCache::Mix(fingerprint, fGridRelativeToMargin ? 1 : 0);
+        return AlignmentFingerprintCache::Mix(fingerprint, static_cast<uint64>(story.fTolerance));
+    }
+    
+    // Cache entries of the parcels that passed the check, and of the story once all
+    // of its parcels have; runs after the parallel loop
+    void CollectVerifiedParcels(const StoryFingerprint& story, const ParcelRangeList& parcels,
+                                const PerThreadVectors<int32>& threadVerified,
+                                ArenaVector<VerifiedParcel>& verified) {
+        if (!fFingerprints.IsOpen()) return;
+        
+        ArenaVector<int32> indices(ArenaAllocator<int32>(&fArenas.Main()));
+        threadVerified.MergeInto(indices);
+        CollectVerifiedParcels(story, parcels, indices, verified);
+    }
+    
+    void CollectVerifiedParcels(const StoryFingerprint& story, const ParcelRangeList& parcels,
+                                const ArenaVector<int32>& indices, ArenaVector<VerifiedParcel>& verified) {
+        if (!fFingerprints.IsOpen()) return;
+        
+        verified.reserve(verified.size() + indices.size() + 1);
+        for (const int32 i : indices) {
+            verified.push_back(VerifiedParcel{ParcelKey(story, parcels.fStart[i]), parcels.fFingerprint[i]});
+        }
+        if (parcels.fStoryFingerprint != 0 && indices.size() == parcels.fIndex.size()) {
+            verified.push_back(VerifiedParcel{StoryVerifiedKey(story), parcels.fStoryFingerprint});
+        }
+    }
+    
+    void StoreVerifiedParcels(const ArenaVector<VerifiedParcel>& verified) {
+        for (const VerifiedParcel& parcel : verified) {
+            fFingerprints.Store(parcel.fKey, parcel.fFingerprint);
+        }
+    }
+    
+    BaselineGrid GetDocumentGrid() const {
+        return BaselineGrid{fCachedGridSize, fCachedGridStart};
+    }
+    
+    // Effective grid of the frame holding a parcel: the frame's own grid if it
+    // has one, otherwise the document grid. Each frame is resolved once and cached.
+    BaselineGrid ResolveParcelGrid(ITextParcelList* parcelList, int32 parcelIndex) {
+        const uint32 frameID = parcelList->GetParcelFrameUID(parcelIndex).Get();
+        BaselineGrid grid;
+        if (fFrameGrids.Lookup(frameID, &grid)) return grid;
+        
+        InterfacePtr<ITextFrameColumn> frameColumn(parcelList->QueryParcelFrame(parcelIndex));
+        if (!QueryFrameGrid(frameColumn, grid)) {
+            grid = GetDocumentGrid();
+        }
+        
+        fFrameGrids.Insert(frameID, grid);
+        return grid;
+    }
+    
+    // The frame's own grid, relative to the frame top; false if it has none.
+    // An invalid frame grid counts as unset, so the frame follows the document grid.
+    static bool QueryFrameGrid(ITextFrameColumn* frameColumn, BaselineGrid& grid) {
+        InterfacePtr<IBaselineFrameGridData> frameGrid(frameColumn, UseDefaultIID());
+        if (!frameGrid || !frameGrid->GetUseCustomBaselineFrameGrid()) return false;
+        
+        const BaselineGrid ownGrid{ToGridFixed(ToDouble(frameGrid->GetBaselineFrameGridIncrement())),
+                                   ToGridFixed(ToDouble(frameGrid->GetBaselineFrameGridOffset()))};
+        if (!IsAlignableGrid(ownGrid)) return false;
+        
+        grid = ownGrid;
+        return true;
+    }
+    
+    // Grids finer than half a point can't be aligned to
+    static bool IsAlignableGrid(const BaselineGrid& grid) {
+        return grid.fIncrement >= kGridFixedScale / 2;
+    }
+    
+    // Drop the cached grids of a story's frames
+    void InvalidateFrameGrids(ITextModel* textModel) {
+        InterfacePtr<IFrameList> frameList(textModel ? textModel->QueryFrameList() : nil);
+        if (!frameList) return;
+        
+        for (int32 f = 0; f < frameList->GetFrameCount(); f++) {
+            fFrameGrids.Invalidate(frameList->GetNthFrameUID(f).Get());
+        }
+    }
+    
+    // Index of the spread holding a page item; unknown for pasteboard-less or overset items
+    static int32 GetSpreadIndex(ISpreadList* spreadList, IPMUnknown* pageItem) {
+        InterfacePtr<IHierarchy> hierarchy(pageItem, UseDefaultIID());
+        if (!spreadList || !hierarchy) return ViewportRange::kUnknownSpread;
+        
+        const UID spreadUID = hierarchy->GetSpreadUID();
+        if (spreadUID == kInvalidUID) return ViewportRange::kUnknownSpread;
+        return spreadList->GetSpreadIndex(spreadUID);
+    }
+    
+    // Spreads shown in the front layout window, if it shows the document being aligned.
+    // The layout's current spread is always part of it, neighbours while they overlap the window.
+    ViewportRange GetViewport() const {
+        IDocument* document = GetExecutionContextDocument();
+        InterfacePtr<ILayoutControlData> layoutData(Utils<ILayoutUIUtils>()->QueryFrontLayoutData());
+        if (!document || !layoutData || layoutData->GetDocument() != document) return ViewportRange::Unknown();
+        
+        InterfacePtr<ISpreadList> spreadList(document, UseDefaultIID());
+        if (!spreadList) return ViewportRange::Unknown();
+        
+        const int32 current = spreadList->GetSpreadIndex(layoutData->GetSpreadRef().GetUID());
+        if (current < 0) return ViewportRange::Unknown();
+        ViewportRange viewport{current, current};
+        
+        // Window area in pasteboard coordinates
+        InterfacePtr<IPanorama> panorama(layoutData, UseDefaultIID());
+        InterfacePtr<IControlView> layoutView(layoutData, UseDefaultIID());
+        if (!panorama || !layoutView) return viewport;
+        
+        const PBPMPoint origin = panorama->GetContentLocationAtFrameOrigin();
+        const PMRect frame = layoutView->GetFrame();
+        const PMRect visible(origin.X(), origin.Y(),
+                             origin.X() + frame.Width() / panorama->GetXScaleFactor(),
+                             origin.Y() + frame.Height() / panorama->GetYScaleFactor());
+        
+        const int32 spreadCount = spreadList->GetSpreadCount();
+        while (viewport.fFirstSpread > 0 && SpreadOverlaps(spreadList, viewport.fFirstSpread - 1, visible)) {
+            viewport.fFirstSpread--;
+        }
+        while (viewport.fLastSpread + 1 < spreadCount && SpreadOverlaps(spreadList, viewport.fLastSpread + 1, visible)) {
+            viewport.fLastSpread++;
+        }
+        return viewport;
+    }
+    
+    static bool SpreadOverlaps(ISpreadList* spreadList, int32 spreadIndex, const PMRect& visible) {
+        InterfacePtr<IGeometry> geometry(spreadList->QueryNthSpread(spreadIndex), UseDefaultIID());
+        if (!geometry) return false;
+        
+        const PMRect bounds = geometry->GetStrokeBoundingBox(::InnerToPasteboardMatrix(geometry));
+        return bounds.Left() < visible.Right() && visible.Left() < bounds.Right() &&
+               bounds.Top() < visible.Bottom() && visible.Top() < bounds.Bottom();
+    }
+    
+    // First and last spread holding frames of a story
+    void GetStorySpreads(ISpreadList* spreadList, const UIDRef& storyRef, int32& firstSpread, int32& lastSpread) const {
+        firstSpread = ViewportRange::kUnknownSpread;
+        lastSpread = ViewportRange::kUnknownSpread;
+        
+        InterfacePtr<ITextModel> textModel(storyRef, UseDefaultIID());
+        InterfacePtr<IFrameList> frameList(textModel ? textModel->QueryFrameList() : nil);
+        if (!frameList) return;
+        
+        for (int32 f = 0; f < frameList->GetFrameCount(); f++) {
+            InterfacePtr<ITextFrameColumn> frameColumn(frameList->QueryNthFrame(f));
+            const int32 spread = GetSpreadIndex(spreadList, frameColumn);
+            if (spread == ViewportRange::kUnknownSpread) continue;
+            
+            firstSpread = firstSpread == ViewportRange::kUnknownSpread ? spread : std::min(firstSpread, spread);
+            lastSpread = std::max(lastSpread, spread);
+        }
+    }
+    
+    // Stories of the document in viewport order. Spreads are looked up only
+    // when a layout window shows the document; otherwise stories keep list order.
+    ViewportSchedule ScheduleStories(IStoryList* storyList) const {
+        const int32 storyCount = storyList->GetUserAccessibleStoryCount();
+        ViewportSchedule schedule;
+        schedule.Reserve(storyCount);
+        
+        InterfacePtr<ISpreadList> spreadList(GetExecutionContextDocument(), UseDefaultIID());
+        const bool ordered = spreadList && GetViewport().IsKnown();
+        for (int32 story = 0; story < storyCount; story++) {
+            int32 firstSpread = ViewportRange::kUnknownSpread;
+            int32 lastSpread = ViewportRange::kUnknownSpread;
+            if (ordered) {
+                GetStorySpreads(spreadList, storyList->GetNthUserAccessibleStoryUID(story), firstSpread, lastSpread);
+            }
+            schedule.Add(firstSpread, lastSpread);
+        }
+        return schedule;
+    }
+    
+    // Run a parcel loop in viewport order: parcels on visible spreads as the first wave,
+    // the rest in waves of increasing distance, sorted again whenever the user scrolls.
+    // runWave(plan, order, wave) runs one planned wave over parcels order[0] .. order[count - 1];
+    // waveDone(wave) follows outside the cost measured for the policy and returns false to stop.
+    template <class WaveFn, class WaveDoneFn>
+    void ForEachViewportWave(const ParcelRangeList& parcels, ParallelPolicy& policy,
+                             WaveFn runWave, WaveDoneFn waveDone) {
+        ViewportSchedule schedule;
+        schedule.Reserve(parcels.fSpread.size());
+        for (const int32 spread : parcels.fSpread) {
+            schedule.Add(spread, spread);
+        }
+        
+        ArenaVector<int32> lengths(ArenaAllocator<int32>(&fArenas.Main()));
+        ViewportWave wave;
+        while (schedule.NextWave(GetViewport(), wave)) {
+            const int32* order = schedule.GetOrder() + wave.fBegin;
+            lengths.clear();
+            for (size_t n = 0; n < wave.fEnd - wave.fBegin; n++) {
+                lengths.push_back(parcels.fLength[order[n]]);
+            }
+            
+            RunPlannedLoop(policy, lengths.data(), lengths.size(), [&](const ParallelPlan& plan) {
+                runWave(plan, order, wave);
+            });
+            if (!waveDone(wave)) return;
+        }
+    }
+    
+    // Czech UI gets Czech messages, every other locale English
+    FindingLanguage GetFindingLanguage() const {
+        const PMLocaleId locale = LocaleSetting::GetLocale();
+        return locale.GetUserInterfaceId() == k_csCZ ? kFindingLanguageCzech : kFindingLanguageEnglish;
+    }
 
     BEGIN_OBSERVER_MAP(BaselineGridAligner)
         ON_NOTIFY(kUserCancelMsg, IID_IINTERACTIVE, HandleCancel)
@@ -506,5 +2040,6 @@ private:
     END_OBSERVER_MAP
 };
 
-// Register implementation
+// Register implementations
 CREATE_PMINTERFACE(BaselineGridAligner, kBaselineGridAlignerImpl)
+CREATE_PMINTERFACE(BaselineGridAlignerTelemetryTask, kBaselineGridAlignerTelemetryTaskImpl)
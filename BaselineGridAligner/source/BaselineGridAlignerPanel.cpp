@@ -57,9 +57,15 @@
 #include "IUIDrawingStyleAttributeValuesProvider.h"
 #include "IUIDrawingStyleAttributeValuesManager.h"
 #include "IUIDrawingStyleAttributeValuesUtils.h"
+#include "includes/AlignmentCounters.h"
+#include "includes/AlignmentTrace.h"
+#include "includes/AlignmentRecorder.h"
+#include "includes/AlignmentFindingGroups.h"
 #include <memory>
 #include <string>
 #include <vector>
+#include <filesystem>
+#include <ctime>
 
 // Control IDs
 #define kAlignmentTypeDropDownID       1
@@ -70,6 +76,11 @@
 #define kPreviewEnabledCheckboxID      6
 #define kApplyButtonID                 7
 #define kResetButtonID                 8
+#define kCountersTextID                9
+#define kExportDiagnosticsButtonID     10
+#define kLeadingMultipleEditID         11
+#define kAlignDocumentButtonID         12
+#define kRecordSessionButtonID         13
 
 // Panel dimensions
 #define kPanelMargin                   10
@@ -88,48 +99,30 @@ BaselineGridAlignerPanel::BaselineGridAlignerPanel(IPMUnknown* boss)
       fAlignmentTypeDropDown(nil),
       fHighlightColorSelector(nil),
       fWordSpacingEdit(nil),
+      fLeadingMultipleEdit(nil),
       fAutoApplyCheckbox(nil),
       fShowWarningsCheckbox(nil),
       fPreviewEnabledCheckbox(nil),
+      fCountersText(nil),
       fIsActive(false),
       fIsVisible(false),
       fHasSelection(false),
-      fHasDocument(false)
+      fHasDocument(false),
+      fControlsInitialized(false),
+      fObserversAttached(false)
 {
-    // Create settings
-    InterfacePtr<BaselineGridAlignerSettings> settings(
-        ::CreateObject2<BaselineGridAlignerSettings>(kBaselineGridAlignerSettingsImpl));
-    fSettings.reset(settings.forget());
-    
-    // Register as observer for selection changes
-    InterfacePtr<ISubject> selectionSubject(GetExecutionContextSession()->QuerySelectionManager(), IID_ISELECTION);
-    if (selectionSubject) {
-        selectionSubject->AddObserver(this, IID_ISELECTION);
-    }
-    
-    // Register as observer for document changes
-    InterfacePtr<ISubject> docSubject(GetExecutionContextSession(), IID_IAPPLICATION);
-    if (docSubject) {
-        docSubject->AddObserver(this, IID_IAPPLICATION);
-    }
+    // Settings, controls and observers wait for the first show (EnsureControls, AutoAttach)
 }
 
 BaselineGridAlignerPanel::~BaselineGridAlignerPanel()
 {
-    // Unregister observers
-    InterfacePtr<ISubject> selectionSubject(GetExecutionContextSession()->QuerySelectionManager(), IID_ISELECTION);
-    if (selectionSubject) {
-        selectionSubject->RemoveObserver(this, IID_ISELECTION);
-    }
-    
-    InterfacePtr<ISubject> docSubject(GetExecutionContextSession(), IID_IAPPLICATION);
-    if (docSubject) {
-        docSubject->RemoveObserver(this, IID_IAPPLICATION);
-    }
+    AutoDetach();
 }
 
 void BaselineGridAlignerPanel::RegisterPanelWidget(IPanelControlData* panelControlData)
 {
+    AlignmentStartupTimer timer(kStartupPanelRegister);
+    
     fPanelControlData = panelControlData;
     
     // Get widget view
@@ -139,14 +132,10 @@ void BaselineGridAlignerPanel::RegisterPanelWidget(IPanelControlData* panelContr
     // Get widget parent
     fWidgetParent = static_cast<IWidgetParent*>(widget->QueryInterface(IID_IWIDGETPARENT));
     
-    // Initialize controls
-    InitializeControls();
-    
-    // Update controls from settings
-    UpdateControlsFromSettings();
-    
-    // Enable/disable controls based on current state
-    EnableDisableControls();
+    // Controls are built on first show, or now if the widget is replaced while shown
+    if (fIsVisible) {
+        EnsureControls();
+    }
 }
 
 void BaselineGridAlignerPanel::UnRegisterPanelWidget(IPanelControlData* panelControlData)
@@ -157,9 +146,12 @@ void BaselineGridAlignerPanel::UnRegisterPanelWidget(IPanelControlData* panelCon
     fAlignmentTypeDropDown = nil;
     fHighlightColorSelector = nil;
     fWordSpacingEdit = nil;
+    fLeadingMultipleEdit = nil;
     fAutoApplyCheckbox = nil;
     fShowWarningsCheckbox = nil;
     fPreviewEnabledCheckbox = nil;
+    fCountersText = nil;
+    fControlsInitialized = false;
 }
 
 void BaselineGridAlignerPanel::Update(const ClassID& theChange, ISubject* theSubject, 
@@ -173,6 +165,56 @@ void BaselineGridAlignerPanel::Update(const ClassID& theChange, ISubject* theSub
             HandleDocumentChange();
         }
     }
+    else {
+        // Control notifications registered in InitializeControls; the subject is the widget
+        InterfacePtr<IControlView> controlView(theSubject, UseDefaultIID());
+        if (controlView) {
+            HandleControlChange(theChange, protocol, controlView->GetWidgetID());
+        }
+    }
+}
+
+void BaselineGridAlignerPanel::HandleControlChange(const ClassID& theChange, const PMIID& protocol, const WidgetID& widgetID)
+{
+    if (protocol == IID_IBOOLEANCONTROLDATA) {
+        // Buttons report a click as the true state
+        if (theChange != kTrueStateMessage) return;
+        
+        switch (widgetID.Get()) {
+            case kApplyButtonID:             HandleApplyButtonClick(); break;
+            case kResetButtonID:             HandleResetButtonClick(); break;
+            case kAlignDocumentButtonID:     HandleAlignDocumentButtonClick(); break;
+            case kExportDiagnosticsButtonID: HandleExportDiagnosticsButtonClick(); break;
+            case kRecordSessionButtonID:     HandleRecordSessionButtonClick(); break;
+        }
+    }
+    else if (protocol == IID_ITRISTATECONTROLDATA) {
+        if (theChange != kTrueStateMessage && theChange != kFalseStateMessage) return;
+        
+        switch (widgetID.Get()) {
+            case kAutoApplyCheckboxID:       HandleAutoApplyChange(); break;
+            case kShowWarningsCheckboxID:    HandleShowWarningsChange(); break;
+            case kPreviewEnabledCheckboxID:  HandlePreviewEnabledChange(); break;
+        }
+    }
+    else if (protocol == IID_ITEXTCONTROLDATA) {
+        if (theChange != kTextChangeStateMessage) return;
+        
+        switch (widgetID.Get()) {
+            case kWordSpacingEditID:         HandleWordSpacingChange(); break;
+            case kLeadingMultipleEditID:     HandleLeadingMultipleChange(); break;
+        }
+    }
+    else if (protocol == IID_ISTRINGLISTCONTROLDATA) {
+        if (theChange == kPopupChangeStateMessage && widgetID.Get() == kAlignmentTypeDropDownID) {
+            HandleAlignmentTypeChange();
+        }
+    }
+    else if (protocol == IID_ICOLORSELECTORDATA) {
+        if (widgetID.Get() == kHighlightColorSelectorID) {
+            HandleHighlightColorChange();
+        }
+    }
 }
 
 void BaselineGridAlignerPanel::HandleSelectionUpdate()
@@ -184,6 +226,9 @@ void BaselineGridAlignerPanel::HandleSelectionUpdate()
     // Enable/disable controls based on selection
     EnableDisableControls();
     
+    // Auto-apply may have run since the last update
+    UpdateCountersDisplay();
+    
     // Update preview if enabled
     if (fSettings && fSettings->GetPreviewEnabled() && fHasSelection) {
         UpdatePreview();
@@ -216,16 +261,22 @@ void BaselineGridAlignerPanel::HandlePanelShow()
 {
     fIsVisible = true;
     
-    // Update preview if enabled
-    if (fSettings && fSettings->GetPreviewEnabled() && fHasSelection) {
-        UpdatePreview();
-    }
+    EnsureControls();
+    AutoAttach();
+    
+    // Selection and document may have changed while the panel was hidden;
+    // this also shows counters of the last run and updates the preview
+    HandleDocumentChange();
+    HandleSelectionUpdate();
 }
 
 void BaselineGridAlignerPanel::HandlePanelHide()
 {
     fIsVisible = false;
     
+    // A hidden panel doesn't need selection or document notifications
+    AutoDetach();
+    
     // Clear preview
     if (fSettings && fSettings->GetPreviewEnabled()) {
         // Code to clear preview would go here
@@ -234,12 +285,38 @@ void BaselineGridAlignerPanel::HandlePanelHide()
 
 void BaselineGridAlignerPanel::AutoAttach()
 {
-    // Nothing to do
+    if (fObserversAttached) return;
+    
+    // Register as observer for selection changes
+    InterfacePtr<ISubject> selectionSubject(GetExecutionContextSession()->QuerySelectionManager(), IID_ISELECTION);
+    if (selectionSubject) {
+        selectionSubject->AddObserver(this, IID_ISELECTION);
+    }
+    
+    // Register as observer for document changes
+    InterfacePtr<ISubject> docSubject(GetExecutionContextSession(), IID_IAPPLICATION);
+    if (docSubject) {
+        docSubject->AddObserver(this, IID_IAPPLICATION);
+    }
+    
+    fObserversAttached = true;
 }
 
 void BaselineGridAlignerPanel::AutoDetach()
 {
-    // Nothing to do
+    if (!fObserversAttached) return;
+    
+    InterfacePtr<ISubject> selectionSubject(GetExecutionContextSession()->QuerySelectionManager(), IID_ISELECTION);
+    if (selectionSubject) {
+        selectionSubject->RemoveObserver(this, IID_ISELECTION);
+    }
+    
+    InterfacePtr<ISubject> docSubject(GetExecutionContextSession(), IID_IAPPLICATION);
+    if (docSubject) {
+        docSubject->RemoveObserver(this, IID_IAPPLICATION);
+    }
+    
+    fObserversAttached = false;
 }
 
 void BaselineGridAlignerPanel::GetObserverInfo(int32* numProtos, const PMIID** protoList)
@@ -253,6 +330,26 @@ void BaselineGridAlignerPanel::GetObserverInfo(int32* numProtos, const PMIID** p
     *protoList = kProtoList;
 }
 
+void BaselineGridAlignerPanel::EnsureControls()
+{
+    if (fControlsInitialized || !fPanelWidgetView) return;
+    
+    AlignmentStartupTimer timer(kStartupPanelBuildControls);
+    
+    // Create settings; reading preferences is the costly part
+    if (!fSettings) {
+        InterfacePtr<BaselineGridAlignerSettings> settings(
+            ::CreateObject2<BaselineGridAlignerSettings>(kBaselineGridAlignerSettingsImpl));
+        fSettings.reset(settings.forget());
+    }
+    
+    InitializeControls();
+    UpdateControlsFromSettings();
+    EnableDisableControls();
+    
+    fControlsInitialized = true;
+}
+
 void BaselineGridAlignerPanel::InitializeControls()
 {
     if (!fPanelWidgetView || !fWidgetParent) return;
@@ -303,6 +400,8 @@ void BaselineGridAlignerPanel::InitializeControls()
         fAlignmentTypeDropDown->AddItem("Baseline", kAlignmentTypeBaseline);
         fAlignmentTypeDropDown->AddItem("Mezislovní mezery", kAlignmentTypeWordSpacing);
         fAlignmentTypeDropDown->AddItem("Kombinované", kAlignmentTypeCombined);
+        fAlignmentTypeDropDown->AddItem("Po řádcích", kAlignmentTypeLines);
+        fAlignmentTypeDropDown->AddItem("Leading", kAlignmentTypeLeading);
     }
     
     // Move to next control
@@ -352,6 +451,28 @@ void BaselineGridAlignerPanel::InitializeControls()
     // Move to next control
     currentY += controlHeight + spacing;
     
+    // Create leading multiple edit
+    editRect = PMRect(margin + labelWidth + spacing, currentY, 
+                     margin + labelWidth + spacing + controlWidth, currentY + controlHeight);
+    
+    editView = Utils<IWidgetUtils>()->CreateControl(fPanelWidgetView, 
+                                                 kLeadingMultipleEditID, 
+                                                 kEditBoxWidgetBoss, 
+                                                 editRect);
+    
+    // Add label
+    labelRect = PMRect(margin, currentY, margin + labelWidth, currentY + controlHeight);
+    labelView = Utils<IWidgetUtils>()->CreateStaticTextControl(fPanelWidgetView, 
+                                                            0, 
+                                                            "Leading v krocích gridu (0 = nejbližší):", 
+                                                            labelRect);
+    
+    // Get edit control
+    fLeadingMultipleEdit = static_cast<ITextControlData*>(editView->QueryInterface(IID_ITEXTCONTROLDATA));
+    
+    // Move to next control
+    currentY += controlHeight + spacing;
+    
     // Create auto apply checkbox
     PMRect checkboxRect(margin, currentY, panelBounds.Width() - margin, currentY + controlHeight);
     
@@ -442,16 +563,83 @@ void BaselineGridAlignerPanel::InitializeControls()
         resetButtonText->SetText("Reset");
     }
     
+    // Create align document button
+    PMRect alignDocumentButtonRect(margin, currentY, 
+                                  margin + buttonWidth * 1.5, currentY + buttonHeight);
+    
+    InterfacePtr<IControlView> alignDocumentButtonView(Utils<IWidgetUtils>()->CreateControl(fPanelWidgetView, 
+                                                                                         kAlignDocumentButtonID, 
+                                                                                         kButtonWidgetBoss, 
+                                                                                         alignDocumentButtonRect));
+    
+    // Set button text
+    InterfacePtr<ITextControlData> alignDocumentButtonText(alignDocumentButtonView, IID_ITEXTCONTROLDATA);
+    if (alignDocumentButtonText) {
+        alignDocumentButtonText->SetText("Celý dokument");
+    }
+    
+    // Move to next control
+    currentY += buttonHeight + spacing;
+    
+    // Create export diagnostics button
+    PMRect exportButtonRect(margin, currentY, 
+                           panelBounds.Width() / 2 - spacing / 2, currentY + buttonHeight);
+    
+    InterfacePtr<IControlView> exportButtonView(Utils<IWidgetUtils>()->CreateControl(fPanelWidgetView, 
+                                                                                  kExportDiagnosticsButtonID, 
+                                                                                  kButtonWidgetBoss, 
+                                                                                  exportButtonRect));
+    
+    // Set button text
+    InterfacePtr<ITextControlData> exportButtonText(exportButtonView, IID_ITEXTCONTROLDATA);
+    if (exportButtonText) {
+        exportButtonText->SetText("Exportovat diagnostiku");
+    }
+    
+    // Create record session button
+    PMRect recordButtonRect(panelBounds.Width() / 2 + spacing / 2, currentY, 
+                           panelBounds.Width() - margin, currentY + buttonHeight);
+    
+    InterfacePtr<IControlView> recordButtonView(Utils<IWidgetUtils>()->CreateControl(fPanelWidgetView, 
+                                                                                  kRecordSessionButtonID, 
+                                                                                  kButtonWidgetBoss, 
+                                                                                  recordButtonRect));
+    
+    // Set button text
+    InterfacePtr<ITextControlData> recordButtonText(recordButtonView, IID_ITEXTCONTROLDATA);
+    if (recordButtonText) {
+        recordButtonText->SetText(AlignmentRecorder::Instance().IsRecording() ? "Zastavit nahrávání" : "Nahrávat relaci");
+    }
+    
+    // Move to next control
+    currentY += buttonHeight + spacing;
+    
+    // Create counters display for the last run
+    PMRect countersRect(margin, currentY, 
+                       panelBounds.Width() - margin, currentY + controlHeight * 4);
+    
+    InterfacePtr<IControlView> countersView(Utils<IWidgetUtils>()->CreateStaticTextControl(fPanelWidgetView, 
+                                                                                        kCountersTextID, 
+                                                                                        "", 
+                                                                                        countersRect));
+    
+    // Get counters text control
+    fCountersText = static_cast<ITextControlData*>(countersView->QueryInterface(IID_ITEXTCONTROLDATA));
+    
     // Register for control events
     if (fWidgetParent) {
         fWidgetParent->RegisterForControlNotifications(kAlignmentTypeDropDownID, this);
         fWidgetParent->RegisterForControlNotifications(kHighlightColorSelectorID, this);
         fWidgetParent->RegisterForControlNotifications(kWordSpacingEditID, this);
+        fWidgetParent->RegisterForControlNotifications(kLeadingMultipleEditID, this);
         fWidgetParent->RegisterForControlNotifications(kAutoApplyCheckboxID, this);
         fWidgetParent->RegisterForControlNotifications(kShowWarningsCheckboxID, this);
         fWidgetParent->RegisterForControlNotifications(kPreviewEnabledCheckboxID, this);
         fWidgetParent->RegisterForControlNotifications(kApplyButtonID, this);
         fWidgetParent->RegisterForControlNotifications(kResetButtonID, this);
+        fWidgetParent->RegisterForControlNotifications(kExportDiagnosticsButtonID, this);
+        fWidgetParent->RegisterForControlNotifications(kAlignDocumentButtonID, this);
+        fWidgetParent->RegisterForControlNotifications(kRecordSessionButtonID, this);
     }
 }
 
@@ -476,6 +664,13 @@ void BaselineGridAlignerPanel::UpdateControlsFromSettings()
         fWordSpacingEdit->SetText(wordSpacingStr);
     }
     
+    // Update leading multiple edit
+    if (fLeadingMultipleEdit) {
+        PMString leadingMultipleStr;
+        leadingMultipleStr.AppendNumber(fSettings->GetLeadingMultiple());
+        fLeadingMultipleEdit->SetText(leadingMultipleStr);
+    }
+    
     // Update checkboxes
     if (fAutoApplyCheckbox) {
         fAutoApplyCheckbox->SetState(fSettings->GetAutoApply() ? ITriStateControlData::kSelected : ITriStateControlData::kUnselected);
@@ -514,6 +709,16 @@ void BaselineGridAlignerPanel::UpdateSettingsFromControls()
         fSettings->SetWordSpacingFactor(factor);
     }
     
+    // Update leading multiple
+    if (fLeadingMultipleEdit) {
+        PMString leadingMultipleStr;
+        fLeadingMultipleEdit->GetText(&leadingMultipleStr);
+        
+        int32 multiple = 0;
+        leadingMultipleStr.GetAsNumber(&multiple);
+        fSettings->SetLeadingMultiple(multiple);
+    }
+    
     // Update checkboxes
     if (fAutoApplyCheckbox) {
         fSettings->SetAutoApply(fAutoApplyCheckbox->GetState() == ITriStateControlData::kSelected);
@@ -573,12 +778,23 @@ void BaselineGridAlignerPanel::EnableDisableControls()
             }
         }
         
+        InterfacePtr<IControlView> leadingMultipleEdit(fPanelWidgetView->FindWidget(kLeadingMultipleEditID));
+        if (leadingMultipleEdit) {
+            leadingMultipleEdit->Enable(enableControls);
+        }
+        
         // Enable/disable apply button
         InterfacePtr<IControlView> applyButton(fPanelWidgetView->FindWidget(kApplyButtonID));
         if (applyButton) {
             applyButton->Enable(enableApply);
         }
         
+        // Aligning the whole document needs no selection
+        InterfacePtr<IControlView> alignDocumentButton(fPanelWidgetView->FindWidget(kAlignDocumentButtonID));
+        if (alignDocumentButton) {
+            alignDocumentButton->Enable(enableControls);
+        }
+        
         // Reset button is always enabled if panel is active
         InterfacePtr<IControlView> resetButton(fPanelWidgetView->FindWidget(kResetButtonID));
         if (resetButton) {
@@ -617,6 +833,16 @@ void BaselineGridAlignerPanel::HandleWordSpacingChange()
     }
 }
 
+void BaselineGridAlignerPanel::HandleLeadingMultipleChange()
+{
+    UpdateSettingsFromControls();
+    
+    // Update preview if enabled
+    if (fSettings && fSettings->GetPreviewEnabled() && fHasSelection) {
+        UpdatePreview();
+    }
+}
+
 void BaselineGridAlignerPanel::HandleAutoApplyChange()
 {
     UpdateSettingsFromControls();
@@ -652,6 +878,18 @@ void BaselineGridAlignerPanel::HandleApplyButtonClick()
     ApplyAlignment();
 }
 
+void BaselineGridAlignerPanel::HandleAlignDocumentButtonClick()
+{
+    // Get BaselineGridAligner instance
+    InterfacePtr<BaselineGridAligner> aligner(
+        ::CreateObject2<BaselineGridAligner>(kBaselineGridAlignerImpl));
+    
+    if (aligner) {
+        // Align all stories of the document
+        aligner->AlignDocument();
+    }
+}
+
 void BaselineGridAlignerPanel::HandleResetButtonClick()
 {
     // Reset settings to defaults
@@ -666,6 +904,82 @@ void BaselineGridAlignerPanel::HandleResetButtonClick()
     }
 }
 
+void BaselineGridAlignerPanel::HandleExportDiagnosticsButtonClick()
+{
+    // Dump counters, trace and full report detail of the last run next to each other in the temp folder
+    std::error_code error;
+    const std::filesystem::path directory = std::filesystem::temp_directory_path(error);
+    if (error) return;
+    
+    AlignmentCounters::Instance().DumpToFile((directory / kBaselineGridAlignerCountersFileName).string());
+    AlignmentTrace::ExportChromeTrace((directory / kBaselineGridAlignerTraceFileName).string());
+    AlignmentReportDetail::Instance().Export((directory / kBaselineGridAlignerReportFileName).string());
+}
+
+void BaselineGridAlignerPanel::HandleRecordSessionButtonClick()
+{
+    // Toggle recording of alignment sessions for offline replay (tools/AlignmentReplay)
+    InterfacePtr<BaselineGridAligner> aligner(
+        ::CreateObject2<BaselineGridAligner>(kBaselineGridAlignerImpl));
+    if (!aligner) return;
+    
+    if (aligner->IsRecording()) {
+        aligner->StopRecording();
+    }
+    else {
+        std::error_code error;
+        const std::filesystem::path directory = std::filesystem::temp_directory_path(error);
+        if (error) return;
+        
+        // Every session gets its own file, so an earlier recording is never overwritten
+        const std::time_t now = std::time(nullptr);
+        char stamp[32];
+        std::strftime(stamp, sizeof(stamp), "%Y%m%d-%H%M%S", std::localtime(&now));
+        const std::string fileName = std::string(kBaselineGridAlignerRecordingFilePrefix) + stamp +
+                                     kBaselineGridAlignerRecordingExtension;
+        
+        if (!aligner->StartRecording(PMString((directory / fileName).string().c_str()))) return;
+    }
+    
+    InterfacePtr<IControlView> recordButton(fPanelWidgetView->FindWidget(kRecordSessionButtonID));
+    InterfacePtr<ITextControlData> recordButtonText(recordButton, IID_ITEXTCONTROLDATA);
+    if (recordButtonText) {
+        recordButtonText->SetText(aligner->IsRecording() ? "Zastavit nahrávání" : "Nahrávat relaci");
+    }
+}
+
+void BaselineGridAlignerPanel::UpdateCountersDisplay()
+{
+    if (!fCountersText) return;
+    
+    const AlignmentCounters& counters = AlignmentCounters::Instance();
+    
+    PMString countersStr("Prohledané odstavce: ");
+    countersStr.AppendNumber(static_cast<int32>(counters.Get(kCounterParcelsScanned)));
+    countersStr += " (mimo výběr: ";
+    countersStr.AppendNumber(static_cast<int32>(counters.Get(kCounterParcelsSkippedByRange)));
+    countersStr += ", ověřené dříve: ";
+    countersStr.AppendNumber(static_cast<int32>(counters.Get(kCounterParcelsSkippedByCache)));
+    countersStr += ")\nUpravené odstavce: ";
+    countersStr.AppendNumber(static_cast<int32>(counters.Get(kCounterParcelsModified)));
+    countersStr += "\nPříkazy: ";
+    countersStr.AppendNumber(static_cast<int32>(counters.Get(kCounterCommandsIssued)));
+    countersStr += "\nRekompozice: ";
+    countersStr.AppendNumber(static_cast<int32>(counters.Get(kCounterRecompositions)));
+    countersStr += "\nNalezené chyby: ";
+    countersStr.AppendNumber(static_cast<int32>(counters.Get(kCounterMisalignmentsFound)));
+    countersStr += "\nDoba běhu (ms): ";
+    countersStr.AppendNumber(static_cast<int32>(counters.Get(kCounterRunMicros) / 1000));
+    countersStr += "\nKritické sekce (µs): ";
+    countersStr.AppendNumber(static_cast<int32>(counters.Get(kCounterCriticalSectionNanos) / 1000));
+    countersStr += "\nOdezva na zrušení (ms): ";
+    countersStr.AppendNumber(static_cast<int32>(counters.Get(kCounterCancelLatencyMicros) / 1000));
+    countersStr += "\nAlokace na haldě: ";
+    countersStr.AppendNumber(static_cast<int32>(counters.Get(kCounterArenaHeapAllocations)));
+    
+    fCountersText->SetText(countersStr);
+}
+
 // BaselineGridAlignerPanelWidget implementation
 BaselineGridAlignerPanelWidget::BaselineGridAlignerPanelWidget(IPMUnknown* boss)
     : CPMUnknown<IPanelControlData>(boss),
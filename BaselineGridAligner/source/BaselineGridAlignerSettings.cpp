@@ -4,6 +4,7 @@ BaselineGridAlignerSettings::BaselineGridAlignerSettings(IPMUnknown* boss)
     : CPMUnknown<IPMUnknown>(boss),
       fAlignmentType(kAlignmentTypeTracking),
       fWordSpacingFactor(1.0),
+      fLeadingMultiple(0),
       fAutoApply(true),
       fShowWarnings(true),
       fPreviewEnabled(true)
@@ -44,6 +45,11 @@ void BaselineGridAlignerSettings::LoadSettings()
     prefs->GetRealPref(kBaselineGridAlignerWordSpacingKey, &factor);
     fWordSpacingFactor = factor;
     
+    // Load leading multiple
+    int32 leadingMultiple = 0;
+    prefs->GetInt32Pref(kBaselineGridAlignerLeadingMultipleKey, &leadingMultiple);
+    fLeadingMultiple = leadingMultiple;
+    
     // Load boolean settings
     bool autoApply = true;
     prefs->GetBoolPref(kBaselineGridAlignerAutoApplyKey, &autoApply);
@@ -75,6 +81,9 @@ void BaselineGridAlignerSettings::SaveSettings()
     // Save word spacing factor
     prefs->SetRealPref(kBaselineGridAlignerWordSpacingKey, fWordSpacingFactor);
     
+    // Save leading multiple
+    prefs->SetInt32Pref(kBaselineGridAlignerLeadingMultipleKey, fLeadingMultiple);
+    
     // Save boolean settings
     prefs->SetBoolPref(kBaselineGridAlignerAutoApplyKey, fAutoApply);
     prefs->SetBoolPref(kBaselineGridAlignerShowWarningsKey, fShowWarnings);
@@ -96,6 +105,11 @@ void BaselineGridAlignerSettings::SetWordSpacingFactor(PMReal factor)
     fWordSpacingFactor = factor;
 }
 
+void BaselineGridAlignerSettings::SetLeadingMultiple(int32 multiple)
+{
+    fLeadingMultiple = multiple < 0 ? 0 : multiple;
+}
+
 void BaselineGridAlignerSettings::SetAutoApply(bool autoApply)
 {
     fAutoApply = autoApply;
@@ -116,6 +130,7 @@ void BaselineGridAlignerSettings::ResetToDefaults()
     fHighlightColor = PMColor(0.5, 0.8, 1.0, 0.3);
     fAlignmentType = kAlignmentTypeTracking;
     fWordSpacingFactor = 1.0;
+    fLeadingMultiple = 0;
     fAutoApply = true;
     fShowWarnings = true;
     fPreviewEnabled = true;
@@ -0,0 +1,218 @@
+#ifndef __AlignmentCounters__
+#define __AlignmentCounters__
+
+#include "AlignmentTrace.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+// Hot-path counters collected for each alignment run
+enum AlignmentCounter {
+    kCounterParcelsScanned = 0,
+    kCounterParcelsSkippedByRange,
+    kCounterParcelsSkippedByCache,
+    kCounterParcelsModified,
+    kCounterCommandsIssued,
+    kCounterMisalignmentsFound,
+    kCounterCriticalSectionNanos,
+    kCounterCancelLatencyMicros,
+    kCounterRunMicros,
+    kCounterArenaHeapAllocations,
+    kCounterArenaBytes,
+    kCounterRecompositions,             // command sequences ended, each recomposes its damaged text once
+    kCounterCount
+};
+
+// One-time costs of the plugin's setup and UI; unlike the counters they survive runs
+enum AlignmentStartupPhase {
+    kStartupAlignerConstruct = 0,
+    kStartupPanelRegister,
+    kStartupPanelBuildControls,
+    kStartupPhaseCount
+};
+
+/**
+ * @class AlignmentCounters
+ *
+ * Process-wide registry of per-run counters. Each counter sits on its own
+ * cache line and is updated with relaxed atomics; hot loops should sum
+ * locally and add once per thread, which keeps the cost low enough to
+ * leave the counters on in production.
+ */
+class AlignmentCounters {
+public:
+    static AlignmentCounters& Instance();
+
+    // Reset all counters at the start of a run
+    void BeginRun();
+
+    // Mark the end of a run and store its duration
+    void EndRun();
+
+    void Add(AlignmentCounter counter, uint64_t value) {
+        fValues[counter].fValue.fetch_add(value, std::memory_order_relaxed);
+    }
+
+    uint64_t Get(AlignmentCounter counter) const {
+        return fValues[counter].fValue.load(std::memory_order_relaxed);
+    }
+
+    // Remember when cancellation was first seen; latency is stored by CancelObserved
+    void CancelRequested();
+    void CancelObserved();
+
+    // Stable identifier used in dumps
+    static const char* GetName(AlignmentCounter counter);
+
+    // Duration of the last time a startup phase ran
+    void SetStartupMicros(AlignmentStartupPhase phase, uint64_t micros) {
+        fStartupMicros[phase].store(micros, std::memory_order_relaxed);
+    }
+
+    uint64_t GetStartupMicros(AlignmentStartupPhase phase) const {
+        return fStartupMicros[phase].load(std::memory_order_relaxed);
+    }
+
+    // Stable identifier used in dumps, also the span name in the trace
+    static const char* GetStartupName(AlignmentStartupPhase phase);
+
+    // Write counters of the last run and startup timings as JSON; returns false if the file can't be written
+    bool DumpToFile(const std::string& path) const;
+
+    static uint64_t NowMicros() {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+private:
+    AlignmentCounters();
+
+    struct alignas(64) Slot {
+        std::atomic<uint64_t> fValue;
+    };
+
+    Slot fValues[kCounterCount];
+    std::atomic<uint64_t> fRunStart;
+    std::atomic<uint64_t> fCancelStart;
+    std::atomic<uint64_t> fStartupMicros[kStartupPhaseCount];
+};
+
+/**
+ * @class AlignmentCounterTimer
+ *
+ * Adds the lifetime of the object in nanoseconds to a counter.
+ */
+class AlignmentCounterTimer {
+public:
+    explicit AlignmentCounterTimer(AlignmentCounter counter)
+        : fCounter(counter),
+          fStart(std::chrono::steady_clock::now())
+    {
+    }
+
+    ~AlignmentCounterTimer() {
+        const auto elapsed = std::chrono::steady_clock::now() - fStart;
+        AlignmentCounters::Instance().Add(fCounter, static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
+    }
+
+private:
+    AlignmentCounter fCounter;
+    std::chrono::steady_clock::time_point fStart;
+};
+
+/**
+ * @class AlignmentCounterSum
+ *
+ * Sums timed spans locally and adds the total to a counter once, when the
+ * object goes out of scope. Used inside per-item loops, where a timer per
+ * item would put an atomic add on the shared counter in every iteration.
+ */
+class AlignmentCounterSum {
+public:
+    explicit AlignmentCounterSum(AlignmentCounter counter)
+        : fCounter(counter),
+          fNanos(0)
+    {
+    }
+
+    ~AlignmentCounterSum() {
+        if (fNanos > 0) {
+            AlignmentCounters::Instance().Add(fCounter, fNanos);
+        }
+    }
+
+    AlignmentCounterSum(const AlignmentCounterSum&) = delete;
+    AlignmentCounterSum& operator=(const AlignmentCounterSum&) = delete;
+
+    // Adds its lifetime to the sum
+    class Span {
+    public:
+        explicit Span(AlignmentCounterSum& sum)
+            : fSum(sum),
+              fStart(std::chrono::steady_clock::now())
+        {
+        }
+
+        ~Span() {
+            const auto elapsed = std::chrono::steady_clock::now() - fStart;
+            fSum.fNanos += static_cast<uint64_t>(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+        }
+
+    private:
+        AlignmentCounterSum& fSum;
+        std::chrono::steady_clock::time_point fStart;
+    };
+
+private:
+    AlignmentCounter fCounter;
+    uint64_t fNanos;
+};
+
+/**
+ * @class AlignmentStartupTimer
+ *
+ * Stores the lifetime of the object as the duration of a startup phase
+ * and records it as a span in the trace.
+ */
+class AlignmentStartupTimer {
+public:
+    explicit AlignmentStartupTimer(AlignmentStartupPhase phase)
+        : fPhase(phase),
+          fStart(AlignmentCounters::NowMicros())
+    {
+    }
+
+    ~AlignmentStartupTimer() {
+        const uint64_t elapsed = AlignmentCounters::NowMicros() - fStart;
+        AlignmentCounters::Instance().SetStartupMicros(fPhase, elapsed);
+        if (AlignmentTrace::IsEnabled()) {
+            AlignmentTrace::Record(AlignmentCounters::GetStartupName(fPhase), fStart, elapsed);
+        }
+    }
+
+    AlignmentStartupTimer(const AlignmentStartupTimer&) = delete;
+    AlignmentStartupTimer& operator=(const AlignmentStartupTimer&) = delete;
+
+private:
+    AlignmentStartupPhase fPhase;
+    uint64_t fStart;
+};
+
+/**
+ * @class AlignmentRunScope
+ *
+ * Resets the counters when a run starts and records its duration on every exit path.
+ */
+class AlignmentRunScope {
+public:
+    AlignmentRunScope() { AlignmentCounters::Instance().BeginRun(); }
+    ~AlignmentRunScope() { AlignmentCounters::Instance().EndRun(); }
+
+    AlignmentRunScope(const AlignmentRunScope&) = delete;
+    AlignmentRunScope& operator=(const AlignmentRunScope&) = delete;
+};
+
+#endif // __AlignmentCounters__
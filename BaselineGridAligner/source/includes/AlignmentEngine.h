@@ -0,0 +1,240 @@
+#ifndef __AlignmentEngine__
+#define __AlignmentEngine__
+
+#include "AlignmentFindings.h"
+#include "AlignmentFingerprintCache.h"
+#include "BaselineGridMath.h"
+#include "BaselineGridScaleCache.h"
+#include "BaselineGridStrategies.h"
+#include "RunArena.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+
+/**
+ * Pure compute stage of the alignment engine.
+ *
+ * Everything here works on data already read from the document, with no
+ * InDesign SDK types, so the plugin, the document pipeline, the offline
+ * replay tool (tools/AlignmentReplay.cpp) and the desktop app's native addon
+ * (addon/AlignmentCoreAddon.cpp) run exactly the same code.
+ */
+
+// A parcel and its current baseline offset
+struct ParcelOffset {
+    int32_t fStart;
+    int32_t fLength;
+    GridFixed fOffset;
+    BaselineGrid fGrid;
+};
+
+// New baseline offset for a range of text
+struct BaselineCorrection {
+    int32_t fStart;
+    int32_t fLength;
+    GridFixed fOffset;
+};
+
+/**
+ * Misalignments counted by their distance from the grid. Bucket 0 holds
+ * deviations below a quarter point, each further bucket twice the range of
+ * the previous one, the last everything from 16 pt up.
+ */
+struct MisalignmentHistogram {
+    static const int kBucketCount = 8;
+
+    uint64_t fCounts[kBucketCount] = {};
+
+    static int Bucket(GridFixed deviation) {
+        GridFixed magnitude = deviation < 0 ? -deviation : deviation;
+        int bucket = 0;
+        for (GridFixed bound = kGridFixedScale / 4; magnitude >= bound && bucket < kBucketCount - 1; bound *= 2) {
+            bucket++;
+        }
+        return bucket;
+    }
+
+    void Add(GridFixed deviation) { fCounts[Bucket(deviation)]++; }
+
+    void Merge(const MisalignmentHistogram& other) {
+        for (int i = 0; i < kBucketCount; i++) {
+            fCounts[i] += other.fCounts[i];
+        }
+    }
+};
+
+// Snap each parcel offset to its grid; parcels already on the grid go to verified.
+// Deviations of the corrected parcels are counted in the histogram if one is given.
+inline void ComputeParcelCorrections(const ParcelOffset* parcels, size_t count,
+                                     ArenaVector<BaselineCorrection>& corrections,
+                                     ArenaVector<ParcelOffset>& verified,
+                                     MisalignmentHistogram* histogram = nullptr)
+{
+    for (size_t i = 0; i < count; i++) {
+        const ParcelOffset& parcel = parcels[i];
+        const GridFixed newOffset = SnapToGrid(parcel.fOffset, parcel.fGrid.fIncrement);
+        if (newOffset == parcel.fOffset) {
+            verified.push_back(parcel);
+            continue;
+        }
+        if (histogram) {
+            histogram->Add(newOffset - parcel.fOffset);
+        }
+        corrections.push_back(BaselineCorrection{parcel.fStart, parcel.fLength, newOffset});
+    }
+}
+
+// Grid deviations of lines [first, last), in one batched pass per run of lines sharing a grid
+inline void ComputeLineRangeDeviations(const BaselineLineMetrics& lines, const ArenaVector<BaselineGrid>& lineGrids,
+                                       size_t first, size_t last, GridFixed* deviations)
+{
+    while (first < last) {
+        size_t runEnd = first + 1;
+        while (runEnd < last && lineGrids[runEnd] == lineGrids[first]) {
+            runEnd++;
+        }
+        ComputeLineDeviations(lines.fBaselineY.data() + first, runEnd - first,
+                              lineGrids[first].fStart, lineGrids[first].fIncrement,
+                              deviations + first);
+        first = runEnd;
+    }
+}
+
+// Correction for off-grid line indices found by CollectOffGridLines, in line order
+inline void AppendLineCorrections(const BaselineLineMetrics& lines, const GridFixed* deviations,
+                                  const uint32_t* offGridLines, size_t offGridCount,
+                                  ArenaVector<BaselineCorrection>& corrections, MisalignmentHistogram* histogram)
+{
+    corrections.reserve(corrections.size() + offGridCount);
+    for (size_t i = 0; i < offGridCount; i++) {
+        const uint32_t line = offGridLines[i];
+        corrections.push_back(BaselineCorrection{lines.fTextIndex[line], lines.fTextSpan[line], -deviations[line]});
+        if (histogram) {
+            histogram->Add(deviations[line] + lines.fBaselineShift[line]);
+        }
+    }
+}
+
+// One correction per line off the grid, holding the baseline shift that puts the
+// line on it. Lines are measured without their shift, so the new shift doesn't
+// depend on the current one and a second pass over corrected lines finds nothing.
+// The histogram counts how far each corrected line moves (positive: down).
+// Temporaries come from the arena, or the heap if it is null.
+inline void FindOffGridLines(const BaselineLineMetrics& lines, const ArenaVector<BaselineGrid>& lineGrids,
+                             RunArena* arena, ArenaVector<BaselineCorrection>& corrections,
+                             MisalignmentHistogram* histogram = nullptr)
+{
+    const size_t lineCount = lines.Size();
+    if (lineCount == 0) return;
+
+    ArenaVector<GridFixed> deviations(lineCount, 0, ArenaAllocator<GridFixed>(arena));
+    ComputeLineRangeDeviations(lines, lineGrids, 0, lineCount, deviations.data());
+
+    ArenaVector<uint32_t> offGridLines(lineCount, 0, ArenaAllocator<uint32_t>(arena));
+    const size_t offGridCount = CollectOffGridLines(deviations.data(), lines.fBaselineShift.data(),
+                                                    lines.fLineHeight.data(), lineCount,
+                                                    kLineGridTolerance, offGridLines.data());
+    AppendLineCorrections(lines, deviations.data(), offGridLines.data(), offGridCount, corrections, histogram);
+}
+
+// Report rules of one parcel: baseline offset and leading within tolerance of the grid.
+// Returns one bit per failed AlignmentRule, 0 if the parcel passed.
+inline uint32_t CheckParcelRules(GridFixed baseline, GridFixed leading, GridFixed gridIncrement, GridFixed tolerance)
+{
+    uint32_t failed = 0;
+    if (std::llabs(GridDeviation(baseline, gridIncrement)) > tolerance) {
+        failed |= 1u << kRuleBaselineOffGrid;
+    }
+    if (std::llabs(GridDeviation(leading, gridIncrement)) > tolerance) {
+        failed |= 1u << kRuleLeadingOffGrid;
+    }
+    return failed;
+}
+
+// Grid scale of a font size, memoized in the cache
+inline double CachedGridScale(BaselineGridScaleCache& cache, GridFixed gridSize, GridFixed fontSize)
+{
+    if (fontSize <= 0) return 1.0;
+
+    // Documents reuse a handful of sizes, so most runs hit the cache
+    double scale;
+    if (cache.Lookup(fontSize, gridSize, &scale)) {
+        return scale;
+    }
+
+    scale = GridScaleFactor(fontSize, gridSize);
+    cache.Insert(fontSize, gridSize, scale);
+    return scale;
+}
+
+// Grid scale of each run's font size; runs that can't be read keep 1.0.
+// The cache is not thread safe, so scales are looked up before any parallel loop.
+inline void LookupStyleRunScales(const StyleRunSnapshot* runs, size_t count, BaselineGridScaleCache& cache,
+                                 double* scales)
+{
+    for (size_t i = 0; i < count; i++) {
+        scales[i] = runs[i].fLength > 0 ? CachedGridScale(cache, runs[i].fGridIncrement, runs[i].fFontSize) : 1.0;
+    }
+}
+
+// Keep the runs whose attributes would actually change, in run order.
+// Writing a value equal to the current one would only add an undo step.
+template <class Strategy>
+inline void AppendChangedStyleRuns(const StyleRunSnapshot* runs, const StyleRunCorrection* corrections, size_t count,
+                                   ArenaVector<StyleRunSnapshot>& changedRuns,
+                                   ArenaVector<StyleRunCorrection>& changedCorrections)
+{
+    for (size_t i = 0; i < count; i++) {
+        if (runs[i].fLength <= 0 || !StyleRunNeedsChange<Strategy>(runs[i], corrections[i])) continue;
+
+        changedRuns.push_back(runs[i]);
+        changedCorrections.push_back(corrections[i]);
+    }
+}
+
+// Compute corrections for queried style runs and keep only runs whose attributes
+// would actually change. The cache is not thread safe; one caller at a time.
+template <class Strategy>
+inline void ComputeStyleRunChanges(const StyleRunSnapshot* runs, size_t count,
+                                   const StyleRunParameters& parameters,
+                                   BaselineGridScaleCache& cache, RunArena* arena,
+                                   ArenaVector<StyleRunSnapshot>& changedRuns,
+                                   ArenaVector<StyleRunCorrection>& changedCorrections)
+{
+    ArenaVector<double> scales(count, 1.0, ArenaAllocator<double>(arena));
+    LookupStyleRunScales(runs, count, cache, scales.data());
+
+    ArenaVector<StyleRunCorrection> corrections(count, StyleRunCorrection(),
+                                                ArenaAllocator<StyleRunCorrection>(arena));
+    ComputeStyleRunCorrections<Strategy>(runs, scales.data(), count, parameters, corrections.data());
+    AppendChangedStyleRuns<Strategy>(runs, corrections.data(), count, changedRuns, changedCorrections);
+}
+
+// Order-sensitive hash of computed changes, so a replay can check it got the
+// same result as the recorded run. Attribute values are hashed at fixed-point precision.
+inline uint64_t ChecksumCorrections(const BaselineCorrection* corrections, size_t count)
+{
+    uint64_t hash = AlignmentFingerprintCache::kHashSeed;
+    for (size_t i = 0; i < count; i++) {
+        hash = AlignmentFingerprintCache::Mix(hash, static_cast<uint64_t>(corrections[i].fStart));
+        hash = AlignmentFingerprintCache::Mix(hash, static_cast<uint64_t>(corrections[i].fLength));
+        hash = AlignmentFingerprintCache::Mix(hash, static_cast<uint64_t>(corrections[i].fOffset));
+    }
+    return hash;
+}
+
+inline uint64_t ChecksumStyleRunChanges(const StyleRunSnapshot* runs, const StyleRunCorrection* corrections,
+                                        size_t count)
+{
+    uint64_t hash = AlignmentFingerprintCache::kHashSeed;
+    for (size_t i = 0; i < count; i++) {
+        hash = AlignmentFingerprintCache::Mix(hash, static_cast<uint64_t>(runs[i].fStart));
+        hash = AlignmentFingerprintCache::Mix(hash, static_cast<uint64_t>(runs[i].fLength));
+        hash = AlignmentFingerprintCache::Mix(hash, static_cast<uint64_t>(ToGridFixed(corrections[i].fTracking)));
+        hash = AlignmentFingerprintCache::Mix(hash, static_cast<uint64_t>(ToGridFixed(corrections[i].fWordSpacing)));
+        hash = AlignmentFingerprintCache::Mix(hash, static_cast<uint64_t>(corrections[i].fLeading));
+    }
+    return hash;
+}
+
+#endif // __AlignmentEngine__
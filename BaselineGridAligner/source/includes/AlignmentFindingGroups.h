@@ -0,0 +1,130 @@
+#ifndef __AlignmentFindingGroups__
+#define __AlignmentFindingGroups__
+
+#include "AlignmentEngine.h"
+#include "AlignmentFindings.h"
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * Summaries of report findings.
+ *
+ * A badly set document can produce tens of thousands of near-identical
+ * findings. The report therefore logs one entry per group of findings with
+ * the same rule, paragraph style and deviation bucket (the buckets of
+ * MisalignmentHistogram). Full detail of the last report is kept in
+ * AlignmentReportDetail, up to a limit, and is written out only on request.
+ */
+
+/**
+ * @struct AlignmentFindingGroup
+ *
+ * Findings of one rule, paragraph style and deviation bucket.
+ */
+struct AlignmentFindingGroup {
+    static const int kFirstOccurrences = 3;
+
+    // Style and bucket of the group collecting findings beyond kMaxGroups
+    static const uint32_t kOverflowStyle = 0xFFFFFFFFu;
+    static const uint8_t kOverflowBucket = 0xFF;
+
+    AlignmentRule fRule;
+    uint8_t fBucket;
+    uint32_t fStyle;                // paragraph style UID, 0 if unknown
+    uint64_t fCount;
+    GridFixed fMinDeviation;        // measured minus expected
+    GridFixed fMaxDeviation;
+    AlignmentFinding fFirst[kFirstOccurrences];     // in text order
+    int32_t fFirstCount;
+
+    bool IsOverflow() const { return fBucket == kOverflowBucket; }
+};
+
+/**
+ * @class AlignmentFindingGroups
+ *
+ * Streaming aggregation of findings into groups. Each report thread fills
+ * its own instance and the instances are merged at the end. At most
+ * kMaxGroups groups are kept; findings of further distinct groups are
+ * counted in one overflow group per rule, so memory and output depend on
+ * the number of distinct problems, not on the number of findings. Storage
+ * is fixed at construction; Clear keeps it, so an instance reused from run
+ * to run doesn't allocate.
+ */
+class AlignmentFindingGroups {
+public:
+    static const size_t kMaxGroups = 256;
+
+    AlignmentFindingGroups();
+
+    // Drop all groups, keeping the storage
+    void Clear();
+
+    void Add(const AlignmentFinding& finding, uint32_t style);
+
+    void Merge(const AlignmentFindingGroups& other);
+
+    // Groups by rule, then by count, largest first; overflow groups last
+    std::vector<AlignmentFindingGroup> Sorted() const;
+
+    uint64_t GetFindingCount() const { return fFindingCount; }
+    size_t GetGroupCount() const { return fGroups.size(); }
+
+private:
+    static uint64_t Key(AlignmentRule rule, uint32_t style, uint8_t bucket) {
+        return (static_cast<uint64_t>(style) << 16) | (static_cast<uint64_t>(bucket) << 8) | rule;
+    }
+
+    // Open-addressed index of fGroups by key, at most half full with
+    // kMaxGroups groups plus one overflow group per rule
+    static const int kIndexBits = 10;
+    static const size_t kIndexSlots = size_t(1) << kIndexBits;
+    static const uint32_t kEmptySlot = 0xFFFFFFFFu;
+
+    // The index slot holding a key, or the empty slot where it would go
+    size_t FindSlot(uint64_t key) const;
+
+    // The group for a key, or the rule's overflow group once the limit is reached
+    AlignmentFindingGroup& FindGroup(AlignmentRule rule, uint32_t style, uint8_t bucket);
+
+    static void AddFirstOccurrence(AlignmentFindingGroup& group, const AlignmentFinding& finding);
+
+    std::vector<AlignmentFindingGroup> fGroups;
+    uint64_t fIndexKeys[kIndexSlots];
+    uint32_t fIndexGroups[kIndexSlots];
+    uint64_t fFindingCount = 0;
+};
+
+/**
+ * @class AlignmentReportDetail
+ *
+ * All findings of the last report, kept for export on request (the panel's
+ * "Export diagnostics"). Holds at most kMaxFindings findings; the total
+ * count tells how many were left out. Each report is copied into the
+ * storage of the previous one.
+ */
+class AlignmentReportDetail {
+public:
+    static const size_t kMaxFindings = 100000;
+
+    static AlignmentReportDetail& Instance();
+
+    // Replace the stored report; findings must be sorted by FindingPrecedes
+    void Store(const AlignmentFinding* findings, size_t count, uint64_t totalCount, FindingLanguage language);
+
+    // Write one line per finding; returns false if there is nothing to write or the file can't be written
+    bool Export(const std::string& path) const;
+
+private:
+    AlignmentReportDetail() {}
+
+    mutable std::mutex fMutex;
+    std::vector<AlignmentFinding> fFindings;
+    uint64_t fTotalCount = 0;
+    FindingLanguage fLanguage = kFindingLanguageCzech;
+};
+
+#endif // __AlignmentFindingGroups__
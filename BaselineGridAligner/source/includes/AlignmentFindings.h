@@ -0,0 +1,90 @@
+#ifndef __AlignmentFindings__
+#define __AlignmentFindings__
+
+#include "BaselineGridMath.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Rules checked by the alignment report
+enum AlignmentRule : uint8_t {
+    kRuleBaselineOffGrid = 0,
+    kRuleLeadingOffGrid,
+    kRuleCount
+};
+
+// Languages findings can be formatted in
+enum FindingLanguage {
+    kFindingLanguageCzech = 0,
+    kFindingLanguageEnglish
+};
+
+/**
+ * @struct AlignmentFinding
+ *
+ * One problem found by the report, stored as plain data.
+ * Text is built only when a finding is displayed or exported.
+ */
+struct AlignmentFinding {
+    GridFixed fMeasured;
+    GridFixed fExpected;
+    int32_t fTextIndex;
+    AlignmentRule fRule;
+};
+
+static_assert(sizeof(AlignmentFinding) <= 24, "AlignmentFinding should stay compact");
+
+// Text order; findings at the same position keep rule order
+inline bool FindingPrecedes(const AlignmentFinding& a, const AlignmentFinding& b)
+{
+    return a.fTextIndex != b.fTextIndex ? a.fTextIndex < b.fTextIndex : a.fRule < b.fRule;
+}
+
+// Keep the first `limit` findings in text order among those added. Once full the
+// vector is a max-heap by FindingPrecedes, so a finding earlier than the last one
+// kept replaces it in O(log limit). Sort the result with FindingPrecedes.
+template <class FindingVector>
+inline void KeepFirstFindings(FindingVector& findings, const AlignmentFinding& finding, size_t limit)
+{
+    if (findings.size() < limit) {
+        findings.push_back(finding);
+        if (findings.size() == limit) {
+            std::make_heap(findings.begin(), findings.end(), FindingPrecedes);
+        }
+        return;
+    }
+    if (limit == 0 || !FindingPrecedes(finding, findings.front())) return;
+
+    std::pop_heap(findings.begin(), findings.end(), FindingPrecedes);
+    findings.back() = finding;
+    std::push_heap(findings.begin(), findings.end(), FindingPrecedes);
+}
+
+struct AlignmentFindingGroup;
+
+/**
+ * @class AlignmentFindingFormatter
+ *
+ * Builds localized messages for findings.
+ */
+class AlignmentFindingFormatter {
+public:
+    // Stable rule code used in exports, e.g. "BGA001"
+    static const char* GetRuleCode(AlignmentRule rule);
+
+    // Short description of the rule
+    static const char* GetRuleMessage(AlignmentRule rule, FindingLanguage language);
+
+    // Full message with position, measured and expected value
+    static std::string Format(const AlignmentFinding& finding, FindingLanguage language);
+
+    // Summary of a group (AlignmentFindingGroups.h): count, style, deviation range, first positions
+    static std::string FormatGroup(const AlignmentFindingGroup& group, const std::string& styleName,
+                                   FindingLanguage language);
+
+private:
+    static std::string FormatPoints(GridFixed value, FindingLanguage language);
+};
+
+#endif // __AlignmentFindings__
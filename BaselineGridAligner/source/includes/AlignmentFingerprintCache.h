@@ -0,0 +1,108 @@
+#ifndef __AlignmentFingerprintCache__
+#define __AlignmentFingerprintCache__
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/**
+ * @class AlignmentFingerprintCache
+ *
+ * Per-document cache of content verified as aligned, kept in a memory-mapped
+ * file so it survives closing the document. Each entry maps a key (story or
+ * parcel) to a fingerprint of what was verified; a parcel is skipped when its
+ * current fingerprint matches the stored one. Lookups only read the mapping,
+ * so they are safe from parallel loops as long as nothing stores meanwhile.
+ *
+ * The file is an open-addressing table of 64-bit key/value pairs behind a
+ * small header; key 0 marks an empty slot. The table grows by remapping up
+ * to kMaxCapacity entries. Parcel keys go stale with every edit and are never
+ * looked up again, so a table that would outgrow the cap starts over empty.
+ */
+class AlignmentFingerprintCache {
+public:
+    AlignmentFingerprintCache();
+    ~AlignmentFingerprintCache();
+
+    AlignmentFingerprintCache(const AlignmentFingerprintCache&) = delete;
+    AlignmentFingerprintCache& operator=(const AlignmentFingerprintCache&) = delete;
+
+    // Map the cache file, creating or resetting it if it is missing or incompatible
+    bool Open(const std::string& path);
+    void Close();
+
+    bool IsOpen() const { return fHeader != nullptr; }
+    const std::string& GetPath() const { return fPath; }
+
+    // Stored value for a key, 0 if there is none
+    uint64_t Get(uint64_t key) const;
+
+    // True if the key was verified with exactly this fingerprint
+    bool Contains(uint64_t key, uint64_t fingerprint) const {
+        return fingerprint != 0 && Get(key) == fingerprint;
+    }
+
+    void Store(uint64_t key, uint64_t value);
+
+    // Drop all entries; the file keeps its size
+    void Clear();
+
+    // Schedule dirty pages to be written to disk
+    void Flush();
+
+    size_t GetCount() const;
+
+    // Combine a value into a running hash; never returns 0
+    static uint64_t Mix(uint64_t hash, uint64_t value) {
+        // FNV-1a over the eight bytes of the value
+        for (int i = 0; i < 8; i++) {
+            hash ^= (value >> (i * 8)) & 0xFF;
+            hash *= 0x100000001B3ULL;
+        }
+        return hash != 0 ? hash : 1;
+    }
+
+    static const uint64_t kHashSeed = 0xCBF29CE484222325ULL;
+
+private:
+    struct Header {
+        uint32_t fMagic;
+        uint32_t fVersion;
+        uint64_t fCapacity;
+        uint64_t fCount;
+    };
+
+    struct Entry {
+        uint64_t fKey;
+        uint64_t fValue;
+    };
+
+    static const uint32_t kMagic = 0x46414742; // "BGAF"
+    static const uint32_t kVersion = 1;
+    static const uint64_t kInitialCapacity = 1 << 14;
+    static const uint64_t kMaxCapacity = 1 << 20;      // 16 MB of entries
+
+    std::string fPath;
+    Header* fHeader;
+    Entry* fEntries;
+    size_t fMappedSize;
+
+#ifdef _WIN32
+    void* fFile;
+    void* fMapping;
+#else
+    int fFile;
+#endif
+
+    bool Map(uint64_t capacity, bool reset);
+    void Unmap();
+    bool Grow();
+
+    Entry* Find(uint64_t key) const;
+
+    static size_t FileSize(uint64_t capacity) {
+        return sizeof(Header) + static_cast<size_t>(capacity) * sizeof(Entry);
+    }
+};
+
+#endif // __AlignmentFingerprintCache__
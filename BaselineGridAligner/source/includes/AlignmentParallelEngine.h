@@ -0,0 +1,159 @@
+#ifndef __AlignmentParallelEngine__
+#define __AlignmentParallelEngine__
+
+#include "AlignmentEngine.h"
+#include "ParallelFor.h"
+#include "ParallelPolicy.h"
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Planned parallel entry points of the compute stage.
+ *
+ * Each splits a story's snapshots into the chunks of a ParallelPolicy plan,
+ * runs the engine of AlignmentEngine.h on every chunk into the chunk's own
+ * slice of preallocated arrays and gathers the slices in item order, so the
+ * result is the serial engine's whatever the thread count. Temporaries come
+ * from the caller's arena, which the loops never allocate from. The selection
+ * flow, the compute stage of the document pipeline and tools/AlignmentBenchmark
+ * all go through these functions.
+ */
+
+// Plan a loop over items of the given lengths, run loop(plan) and feed the
+// measured time back to the policy. Returns the plan that ran.
+template <class LoopFn>
+inline ParallelPlan RunPlannedLoop(ParallelPolicy& policy, const int32_t* lengths, size_t count, LoopFn loop)
+{
+    const ParallelPlan plan = policy.Plan(lengths, count);
+    const auto loopStart = std::chrono::steady_clock::now();
+    loop(plan);
+    policy.RecordCost(plan, static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - loopStart).count()));
+    return plan;
+}
+
+// ComputeParcelCorrections over the chunks of a plan made for these parcels
+inline void ComputeParcelCorrectionsParallel(const ParallelPlan& plan, const ParcelOffset* parcels, size_t count,
+                                             RunArena* arena, ArenaVector<BaselineCorrection>& corrections,
+                                             ArenaVector<ParcelOffset>& verified,
+                                             MisalignmentHistogram* histogram = nullptr)
+{
+    const int32_t chunkCount = plan.GetChunkCount();
+    if (count == 0 || chunkCount == 0) return;
+
+    ArenaVector<GridFixed> snapped(count, 0, ArenaAllocator<GridFixed>(arena));
+    ArenaVector<MisalignmentHistogram> chunkHistograms(chunkCount, MisalignmentHistogram(),
+                                                       ArenaAllocator<MisalignmentHistogram>(arena));
+
+    ParallelForChunks(plan, "Baseline:Worker", [&](int32_t c) {
+        for (int32_t i = plan.fChunkBounds[c]; i < plan.fChunkBounds[c + 1]; i++) {
+            snapped[i] = SnapToGrid(parcels[i].fOffset, parcels[i].fGrid.fIncrement);
+            if (snapped[i] != parcels[i].fOffset) {
+                chunkHistograms[c].Add(snapped[i] - parcels[i].fOffset);
+            }
+        }
+    });
+
+    for (size_t i = 0; i < count; i++) {
+        if (snapped[i] == parcels[i].fOffset) {
+            verified.push_back(parcels[i]);
+        }
+        else {
+            corrections.push_back(BaselineCorrection{parcels[i].fStart, parcels[i].fLength, snapped[i]});
+        }
+    }
+    if (histogram) {
+        for (const MisalignmentHistogram& chunkHistogram : chunkHistograms) {
+            histogram->Merge(chunkHistogram);
+        }
+    }
+}
+
+// ComputeParcelCorrections on a loop planned by the policy, weighted by parcel length
+inline ParallelPlan ComputeParcelCorrectionsPlanned(ParallelPolicy& policy, const ParcelOffset* parcels, size_t count,
+                                                    RunArena* arena, ArenaVector<BaselineCorrection>& corrections,
+                                                    ArenaVector<ParcelOffset>& verified,
+                                                    MisalignmentHistogram* histogram = nullptr)
+{
+    ArenaVector<int32_t> lengths{ArenaAllocator<int32_t>(arena)};
+    lengths.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+        lengths.push_back(parcels[i].fLength);
+    }
+
+    return RunPlannedLoop(policy, lengths.data(), count, [&](const ParallelPlan& plan) {
+        ComputeParcelCorrectionsParallel(plan, parcels, count, arena, corrections, verified, histogram);
+    });
+}
+
+// FindOffGridLines on a loop planned by the policy, weighted by line span.
+// Each chunk computes its deviations and off-grid lines; corrections follow in line order.
+inline ParallelPlan FindOffGridLinesPlanned(ParallelPolicy& policy, const BaselineLineMetrics& lines,
+                                            const ArenaVector<BaselineGrid>& lineGrids, RunArena* arena,
+                                            ArenaVector<BaselineCorrection>& corrections,
+                                            MisalignmentHistogram* histogram = nullptr)
+{
+    const size_t lineCount = lines.Size();
+    ArenaVector<GridFixed> deviations(lineCount, 0, ArenaAllocator<GridFixed>(arena));
+    ArenaVector<uint32_t> offGridLines(lineCount, 0, ArenaAllocator<uint32_t>(arena));
+
+    return RunPlannedLoop(policy, lines.fTextSpan.data(), lineCount, [&](const ParallelPlan& plan) {
+        const int32_t chunkCount = plan.GetChunkCount();
+        ArenaVector<size_t> offGridCounts(chunkCount, 0, ArenaAllocator<size_t>(arena));
+
+        ParallelForChunks(plan, "Lines:Worker", [&](int32_t c) {
+            const size_t begin = plan.fChunkBounds[c];
+            const size_t end = plan.fChunkBounds[c + 1];
+            ComputeLineRangeDeviations(lines, lineGrids, begin, end, deviations.data());
+
+            uint32_t* chunkLines = offGridLines.data() + begin;
+            offGridCounts[c] = CollectOffGridLines(deviations.data() + begin, lines.fBaselineShift.data() + begin,
+                                                   lines.fLineHeight.data() + begin, end - begin,
+                                                   kLineGridTolerance, chunkLines);
+            for (size_t i = 0; i < offGridCounts[c]; i++) {
+                chunkLines[i] += static_cast<uint32_t>(begin);
+            }
+        });
+
+        for (int32_t c = 0; c < chunkCount; c++) {
+            AppendLineCorrections(lines, deviations.data(), offGridLines.data() + plan.fChunkBounds[c],
+                                  offGridCounts[c], corrections, histogram);
+        }
+    });
+}
+
+// ComputeStyleRunChanges on a loop planned by the policy, weighted by run length.
+// Scales are looked up before the loop, as the cache is not thread safe.
+template <class Strategy>
+inline ParallelPlan ComputeStyleRunChangesPlanned(ParallelPolicy& policy, const StyleRunSnapshot* runs, size_t count,
+                                                  const StyleRunParameters& parameters,
+                                                  BaselineGridScaleCache& cache, RunArena* arena,
+                                                  ArenaVector<StyleRunSnapshot>& changedRuns,
+                                                  ArenaVector<StyleRunCorrection>& changedCorrections)
+{
+    ArenaVector<double> scales(count, 1.0, ArenaAllocator<double>(arena));
+    LookupStyleRunScales(runs, count, cache, scales.data());
+
+    ArenaVector<int32_t> lengths{ArenaAllocator<int32_t>(arena)};
+    lengths.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+        lengths.push_back(runs[i].fLength);
+    }
+
+    ArenaVector<StyleRunCorrection> corrections(count, StyleRunCorrection(),
+                                                ArenaAllocator<StyleRunCorrection>(arena));
+    const ParallelPlan plan = RunPlannedLoop(policy, lengths.data(), count, [&](const ParallelPlan& planned) {
+        ParallelForChunks(planned, "StyleRuns:Worker", [&](int32_t c) {
+            const size_t begin = planned.fChunkBounds[c];
+            ComputeStyleRunCorrections<Strategy>(runs + begin, scales.data() + begin,
+                                                 planned.fChunkBounds[c + 1] - begin, parameters,
+                                                 corrections.data() + begin);
+        });
+    });
+
+    AppendChangedStyleRuns<Strategy>(runs, corrections.data(), count, changedRuns, changedCorrections);
+    return plan;
+}
+
+#endif // __AlignmentParallelEngine__
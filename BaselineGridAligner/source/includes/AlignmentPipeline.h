@@ -0,0 +1,177 @@
+#ifndef __AlignmentPipeline__
+#define __AlignmentPipeline__
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+/**
+ * @class BoundedQueue
+ *
+ * Blocking FIFO with a fixed capacity between two pipeline stages.
+ * Push waits while the queue is full, Pop while it is empty. After Close
+ * Push fails at once and Pop drains what is left, then fails.
+ */
+template <class Item>
+class BoundedQueue {
+public:
+    explicit BoundedQueue(size_t capacity)
+        : fCapacity(capacity > 0 ? capacity : 1),
+          fClosed(false)
+    {
+    }
+
+    BoundedQueue(const BoundedQueue&) = delete;
+    BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+    bool Push(Item&& item) {
+        std::unique_lock<std::mutex> lock(fMutex);
+        fNotFull.wait(lock, [this] { return fClosed || fItems.size() < fCapacity; });
+        if (fClosed) return false;
+
+        fItems.push_back(std::move(item));
+        fNotEmpty.notify_one();
+        return true;
+    }
+
+    bool Pop(Item& item) {
+        std::unique_lock<std::mutex> lock(fMutex);
+        fNotEmpty.wait(lock, [this] { return fClosed || !fItems.empty(); });
+        return TakeFront(item);
+    }
+
+    bool TryPop(Item& item) {
+        std::lock_guard<std::mutex> lock(fMutex);
+        return TakeFront(item);
+    }
+
+    bool IsFull() const {
+        std::lock_guard<std::mutex> lock(fMutex);
+        return fItems.size() >= fCapacity;
+    }
+
+    void Close() {
+        std::lock_guard<std::mutex> lock(fMutex);
+        fClosed = true;
+        fNotFull.notify_all();
+        fNotEmpty.notify_all();
+    }
+
+private:
+    bool TakeFront(Item& item) {
+        if (fItems.empty()) return false;
+
+        item = std::move(fItems.front());
+        fItems.pop_front();
+        fNotFull.notify_one();
+        return true;
+    }
+
+    const size_t fCapacity;
+    bool fClosed;
+    std::deque<Item> fItems;
+    mutable std::mutex fMutex;
+    std::condition_variable fNotFull;
+    std::condition_variable fNotEmpty;
+};
+
+/**
+ * Three-stage pipeline over itemCount items.
+ *
+ * snapshot(i) and commit(result) run on the calling thread, which owns the
+ * document; compute(snapshot) runs on a worker thread. While item N is being
+ * computed the caller snapshots N+1 and commits N-1. At most `depth` items
+ * wait in each queue, which caps memory. Items are committed in order.
+ *
+ * Compute deliberately stays on one worker thread. Snapshot and commit talk
+ * to the document and bound the throughput; compute is grid arithmetic on
+ * data already read and keeps up with them on one thread. Style run compute
+ * also uses the scale cache, which is not thread safe. The worker is not one
+ * of the ParallelForChunks participants either, so it must not start parallel
+ * loops; it allocates from the arena of the item it computes.
+ *
+ * Per-item resources used in turn (RunArenaPool::ForItem) are safe with
+ * PipelineItemsInFlight(depth) of them: item i + that many is snapshotted
+ * only after item i has been committed.
+ *
+ * An exception from any stage stops the pipeline and is rethrown here
+ * once the worker has finished.
+ */
+// Items snapshotted but not yet committed, counting the one being snapshotted:
+// up to depth waiting or being snapshotted, one being computed, depth computed
+inline size_t PipelineItemsInFlight(size_t depth)
+{
+    return 2 * (depth > 0 ? depth : 1) + 1;
+}
+
+template <class Snapshot, class Result, class SnapshotFn, class ComputeFn, class CommitFn>
+void RunAlignmentPipeline(size_t itemCount, size_t depth,
+                          SnapshotFn snapshot, ComputeFn compute, CommitFn commit)
+{
+    if (itemCount == 0) return;
+
+    BoundedQueue<Snapshot> pending(depth);
+    BoundedQueue<Result> computed(depth);
+    std::exception_ptr workerError;
+
+    std::thread worker([&] {
+        try {
+            Snapshot item;
+            while (pending.Pop(item)) {
+                if (!computed.Push(compute(std::move(item)))) break;
+            }
+        }
+        catch (...) {
+            workerError = std::current_exception();
+            pending.Close();
+        }
+        computed.Close();
+    });
+
+    try {
+        size_t snapshotted = 0;
+        size_t committed = 0;
+        Result result;
+        while (committed < itemCount) {
+            // Only this thread pushes, so a queue with room never blocks
+            const bool canSnapshot = snapshotted < itemCount && !pending.IsFull();
+            if (canSnapshot) {
+                // A failed worker closes the queue; stop reading, its error is rethrown below
+                if (!pending.Push(snapshot(snapshotted++))) break;
+                if (snapshotted == itemCount) {
+                    pending.Close();
+                }
+            }
+
+            // Commit whatever is ready; wait only when there is nothing to snapshot
+            bool ready = computed.TryPop(result);
+            if (!ready && !canSnapshot) {
+                ready = computed.Pop(result);
+                if (!ready) break;
+            }
+            while (ready) {
+                commit(result);
+                committed++;
+                ready = computed.TryPop(result);
+            }
+        }
+    }
+    catch (...) {
+        pending.Close();
+        computed.Close();
+        worker.join();
+        throw;
+    }
+
+    pending.Close();
+    worker.join();
+    if (workerError) {
+        std::rethrow_exception(workerError);
+    }
+}
+
+#endif // __AlignmentPipeline__
@@ -0,0 +1,182 @@
+#ifndef __AlignmentRecorder__
+#define __AlignmentRecorder__
+
+#include "AlignmentEngine.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * Record-and-replay of alignment sessions.
+ *
+ * While recording, the aligner writes everything the compute stage depends
+ * on to a compact binary file: observer notifications, the settings and
+ * document grid of each run, the parcel, line or style run snapshots it
+ * read from the document and a checksum of what it computed from them.
+ * tools/AlignmentReplay.cpp reads the file and runs the same engine
+ * (AlignmentEngine.h) against it, so a slow or wrong session can be
+ * reproduced offline and real workloads serve as regression inputs.
+ *
+ * File layout: an 8-byte header ("BGAR", version), then records of
+ * [type byte][payload size varint][payload]. Integers are LEB128 varints,
+ * signed ones zigzag encoded; text positions and baselines are stored as
+ * deltas from the previous item, and a grid only when it changes.
+ * Readers skip record types they don't know.
+ */
+
+enum RecordType {
+    kRecordNotification = 1,
+    kRecordRunBegin = 2,
+    kRecordRunEnd = 3,
+    kRecordParcels = 4,
+    kRecordLines = 5,
+    kRecordStyleRuns = 6,
+    kRecordResult = 7
+};
+
+// Observer notifications that can start a run or invalidate caches
+enum RecordedNotification {
+    kRecordedTextAttrChanged = 1,
+    kRecordedTextFrameChanged = 2,
+    kRecordedDocGridChanged = 3,
+    kRecordedStyleChanged = 4
+};
+
+enum RecordedRunKind {
+    kRecordedRunSelection = 1,
+    kRecordedRunPreview = 2,
+    kRecordedRunDocument = 3
+};
+
+// Settings in effect for one run
+struct RecordedSettings {
+    int32_t fAlignmentType;         // BaselineGridAlignmentType value
+    double fWordSpacingFactor;
+    int32_t fLeadingMultiple;
+};
+
+/**
+ * @class AlignmentRecorder
+ *
+ * Appends records to the session recording file. One recorder per process,
+ * so a recording started from the panel covers every aligner instance.
+ * All methods may be called from any thread; records are written whole
+ * under a lock. When not recording every method returns at once, so call
+ * sites only check IsRecording() to avoid gathering data for nothing.
+ */
+class AlignmentRecorder {
+public:
+    static AlignmentRecorder& Instance();
+
+    ~AlignmentRecorder();
+
+    AlignmentRecorder(const AlignmentRecorder&) = delete;
+    AlignmentRecorder& operator=(const AlignmentRecorder&) = delete;
+
+    // Start a new recording, replacing the file; false if it can't be created
+    bool Start(const std::string& path);
+    void Stop();
+
+    bool IsRecording() const { return fRecording.load(std::memory_order_relaxed); }
+
+    void RecordNotification(RecordedNotification notification, uint32_t subject);
+    void RecordRunBegin(RecordedRunKind kind, const RecordedSettings& settings, const BaselineGrid& documentGrid);
+    void RecordRunEnd();
+
+    // Snapshots the compute stage of one story works on
+    void RecordParcels(uint32_t story, const ParcelOffset* parcels, size_t count);
+    void RecordLines(uint32_t story, const BaselineLineMetrics& lines, const ArenaVector<BaselineGrid>& lineGrids);
+    void RecordStyleRuns(uint32_t story, const StyleRunSnapshot* runs, size_t count);
+
+    // What was computed from the last snapshot of the story
+    void RecordResult(uint32_t story, size_t changeCount, uint64_t checksum);
+
+private:
+    AlignmentRecorder();
+
+    void BeginRecord();
+    void EndRecord(RecordType type);
+    uint64_t ElapsedMicros() const;
+
+    std::atomic<bool> fRecording;
+    std::mutex fMutex;
+    FILE* fFile;
+    uint64_t fStartMicros;
+    uint64_t fRunStartMicros;
+    std::vector<uint8_t> fPayload;
+    std::vector<uint8_t> fFrame;
+};
+
+/**
+ * @class RecordedRunScope
+ *
+ * Records the begin and end of a run around the lifetime of the object.
+ */
+class RecordedRunScope {
+public:
+    RecordedRunScope(AlignmentRecorder& recorder, RecordedRunKind kind,
+                     const RecordedSettings& settings, const BaselineGrid& documentGrid)
+        : fRecorder(recorder)
+    {
+        fRecorder.RecordRunBegin(kind, settings, documentGrid);
+    }
+
+    ~RecordedRunScope() {
+        fRecorder.RecordRunEnd();
+    }
+
+    RecordedRunScope(const RecordedRunScope&) = delete;
+    RecordedRunScope& operator=(const RecordedRunScope&) = delete;
+
+private:
+    AlignmentRecorder& fRecorder;
+};
+
+// One decoded record; only the fields of its type are meaningful
+struct RecordedEvent {
+    RecordType fType;
+    uint64_t fTimeMicros;           // since the start of the recording
+    uint32_t fStory;                // story UID, or the subject of a notification
+    int32_t fKind;                  // RecordedNotification or RecordedRunKind
+    RecordedSettings fSettings;
+    BaselineGrid fDocumentGrid;
+    uint64_t fDurationMicros;       // run end
+    uint64_t fChangeCount;          // result
+    uint64_t fChecksum;             // result
+    ArenaVector<ParcelOffset> fParcels;
+    BaselineLineMetrics fLines;
+    ArenaVector<BaselineGrid> fLineGrids;
+    ArenaVector<StyleRunSnapshot> fRuns;
+};
+
+/**
+ * @class AlignmentRecordingReader
+ *
+ * Reads a recording into memory and decodes it record by record.
+ */
+class AlignmentRecordingReader {
+public:
+    AlignmentRecordingReader();
+
+    // Load the whole file; false if it is missing or not a recording
+    bool Open(const std::string& path);
+
+    // Decode the next record into event, reusing its arrays; false at the end
+    bool Next(RecordedEvent& event);
+
+    // True if decoding stopped at a truncated or malformed record
+    bool IsDamaged() const { return fDamaged; }
+
+    size_t GetFileSize() const { return fData.size(); }
+
+private:
+    std::vector<uint8_t> fData;
+    size_t fPosition;
+    bool fDamaged;
+};
+
+#endif // __AlignmentRecorder__
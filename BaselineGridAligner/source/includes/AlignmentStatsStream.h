@@ -0,0 +1,180 @@
+#ifndef __AlignmentStatsStream__
+#define __AlignmentStatsStream__
+
+#include "AlignmentCounters.h"
+#include "AlignmentEngine.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/**
+ * Live statistics stream for the desktop companion app.
+ *
+ * The plugin publishes snapshots of the run counters and the misalignment
+ * histogram into a ring of fixed-size slots in a memory-mapped file; the
+ * app's main process polls the file and forwards new snapshots to the
+ * statistics page (electron/statsStream.ts). There is one producer at a
+ * time and the producer never waits for the reader: when the ring is full
+ * the oldest slots are overwritten and the reader counts them as lost.
+ *
+ * File layout, little endian:
+ *   0    header: magic "BGAS", version, slot count, slot size,
+ *        counter count, bucket count, stream ID (new on every open)
+ *   64   write index: number of slots published so far, on its own cache line
+ *   128  slots: slot i % count holds snapshot i
+ *
+ * A slot starts with its sequence, 2 * i + 1 while snapshot i is being
+ * written and 2 * i + 2 once it is complete. A reader copies the slots
+ * between its cursor and the write index, then reads the write index again;
+ * a copied slot is valid if its sequence is 2 * i + 2 and the write index
+ * has not yet moved a whole ring past it.
+ */
+
+// Why a snapshot was published
+enum AlignmentStatsKind {
+    kStatsRunBegin = 1,
+    kStatsRunProgress = 2,
+    kStatsRunEnd = 3
+};
+
+enum AlignmentStatsRunKind {
+    kStatsRunSelection = 1,
+    kStatsRunPreview = 2,
+    kStatsRunDocument = 3
+};
+
+// One slot of the ring; new fields go into the reserved space
+struct AlignmentStatsRecord {
+    static const int kMaxCounters = 16;
+
+    std::atomic<uint64_t> fSequence;
+    uint64_t fRunID;
+    uint64_t fTimeMillis;           // wall clock, ms since the Unix epoch
+    uint64_t fElapsedMicros;        // since the start of the run
+    uint32_t fKind;                 // AlignmentStatsKind
+    uint32_t fRunKind;              // AlignmentStatsRunKind
+    int32_t fAlignmentType;         // BaselineGridAlignmentType value
+    uint32_t fProgressPermille;
+    uint64_t fCounters[kMaxCounters];               // AlignmentCounter order
+    uint64_t fHistogram[MisalignmentHistogram::kBucketCount];
+    uint8_t fReserved[16];
+};
+
+static_assert(sizeof(AlignmentStatsRecord) == 256, "stats slots are 256 bytes");
+static_assert(kCounterCount <= AlignmentStatsRecord::kMaxCounters, "counters don't fit a stats slot");
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "the ring is shared with another process");
+
+/**
+ * @class AlignmentStatsStream
+ *
+ * Producer side of the stream, one per process like the counters. Runs and
+ * progress may be published from any thread: a publisher that finds
+ * another one writing skips its progress snapshot instead of waiting, and
+ * progress is rate limited, so alignment threads pay a clock read at most.
+ * Histograms are summed locally and added once per chunk or story.
+ */
+class AlignmentStatsStream {
+public:
+    static AlignmentStatsStream& Instance();
+
+    ~AlignmentStatsStream();
+
+    AlignmentStatsStream(const AlignmentStatsStream&) = delete;
+    AlignmentStatsStream& operator=(const AlignmentStatsStream&) = delete;
+
+    // Map the stream file, resetting it; reopening the same path does nothing
+    bool Open(const std::string& path);
+    void Close();
+
+    bool IsOpen() const { return fRing != nullptr; }
+
+    // Start a run: clear the histogram and publish a begin snapshot
+    void BeginRun(AlignmentStatsRunKind kind, int32_t alignmentType);
+
+    // Publish the final snapshot of the run
+    void EndRun();
+
+    // Publish a progress snapshot if the last one is old enough
+    void PublishProgress(float progress);
+
+    void AddHistogram(const MisalignmentHistogram& histogram);
+
+    static const uint32_t kSlotCount = 256;
+    static const uint64_t kProgressIntervalMicros = 100000;
+
+private:
+    AlignmentStatsStream();
+
+    struct Header {
+        uint32_t fMagic;
+        uint32_t fVersion;
+        uint32_t fSlotCount;
+        uint32_t fSlotSize;
+        uint32_t fCounterCount;
+        uint32_t fBucketCount;
+        uint64_t fStreamID;
+        uint8_t fReserved[32];
+    };
+
+    struct Ring {
+        Header fHeader;
+        alignas(64) std::atomic<uint64_t> fWriteIndex;
+        alignas(64) AlignmentStatsRecord fSlots[kSlotCount];
+    };
+
+    static_assert(sizeof(Header) == 64, "the write index starts at byte 64");
+
+    static const uint32_t kMagic = 0x53414742; // "BGAS"
+    static const uint32_t kVersion = 1;
+
+    // Write one snapshot; false if another publisher holds the ring and wait is false
+    bool Publish(AlignmentStatsKind kind, bool wait);
+
+    bool Map();
+    void Unmap();
+
+    Ring* fRing;
+    std::string fPath;
+#ifdef _WIN32
+    void* fFile;
+    void* fMapping;
+#else
+    int fFile;
+#endif
+
+    std::atomic_flag fPublishing = ATOMIC_FLAG_INIT;
+    std::atomic<uint64_t> fRunID;
+    std::atomic<uint64_t> fRunStartMicros;
+    std::atomic<uint64_t> fLastPublishMicros;
+    std::atomic<uint32_t> fRunKind;
+    std::atomic<int32_t> fAlignmentType;
+    std::atomic<uint32_t> fProgressPermille;
+    std::atomic<uint64_t> fHistogram[MisalignmentHistogram::kBucketCount];
+};
+
+/**
+ * @class AlignmentStatsRunScope
+ *
+ * Publishes the begin and end snapshots of a run around the lifetime of the object.
+ */
+class AlignmentStatsRunScope {
+public:
+    AlignmentStatsRunScope(AlignmentStatsStream& stream, AlignmentStatsRunKind kind, int32_t alignmentType)
+        : fStream(stream)
+    {
+        fStream.BeginRun(kind, alignmentType);
+    }
+
+    ~AlignmentStatsRunScope() {
+        fStream.EndRun();
+    }
+
+    AlignmentStatsRunScope(const AlignmentStatsRunScope&) = delete;
+    AlignmentStatsRunScope& operator=(const AlignmentStatsRunScope&) = delete;
+
+private:
+    AlignmentStatsStream& fStream;
+};
+
+#endif // __AlignmentStatsStream__
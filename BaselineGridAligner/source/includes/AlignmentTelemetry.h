@@ -0,0 +1,146 @@
+#ifndef __AlignmentTelemetry__
+#define __AlignmentTelemetry__
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+/**
+ * Asynchronous telemetry and analytics for the aligner.
+ *
+ * Callers on the alignment path only put a small record into a bounded
+ * lock-free queue; when the queue is full the record is dropped and
+ * counted, so logging never waits. An idle task on the main thread drains
+ * the queue, aggregates the records of each flush window per event (count,
+ * sum of values, duration percentiles) and hands one summary per event to
+ * the sink, which forwards it to ITelemetry and IAnalytics. Those are
+ * main-thread interfaces, so the sink is never called from another thread.
+ */
+
+enum AlignmentTelemetryEvent {
+    kTelemetryAlignerInitialize = 0,
+    kTelemetryAlignerShutdown,
+    kTelemetryAlign,
+    kTelemetryEventCount
+};
+
+// One logged event
+struct AlignmentTelemetryRecord {
+    uint32_t fEvent;                // AlignmentTelemetryEvent
+    int64_t fValue;
+    uint64_t fDurationMicros;
+};
+
+// Aggregate of one event over a flush window
+struct AlignmentTelemetrySummary {
+    AlignmentTelemetryEvent fEvent;
+    uint64_t fCount;
+    int64_t fValueSum;
+    uint64_t fDurationP50Micros;
+    uint64_t fDurationP95Micros;
+    uint64_t fDurationP99Micros;
+    uint64_t fDurationMaxMicros;
+    uint64_t fDropped;              // records lost to a full queue
+};
+
+using AlignmentTelemetrySink = std::function<void(const AlignmentTelemetrySummary&)>;
+
+/**
+ * @class AlignmentTelemetryQueue
+ *
+ * Bounded queue for many producers and one consumer. Each cell carries a
+ * sequence number that tells producers whether it is free and the consumer
+ * whether it is filled, so neither side takes a lock.
+ */
+class AlignmentTelemetryQueue {
+public:
+    static const size_t kCapacity = 1024;
+
+    AlignmentTelemetryQueue();
+
+    // False if the queue is full
+    bool TryPush(const AlignmentTelemetryRecord& record);
+
+    // Consumer only; false if the queue is empty
+    bool TryPop(AlignmentTelemetryRecord& record);
+
+    size_t ApproximateSize() const {
+        return static_cast<size_t>(fEnqueue.load(std::memory_order_relaxed) - fDequeue.load(std::memory_order_relaxed));
+    }
+
+private:
+    static_assert((kCapacity & (kCapacity - 1)) == 0, "capacity must be a power of two");
+
+    struct Cell {
+        std::atomic<uint64_t> fSequence;
+        AlignmentTelemetryRecord fRecord;
+    };
+
+    Cell fCells[kCapacity];
+    alignas(64) std::atomic<uint64_t> fEnqueue;
+    alignas(64) std::atomic<uint64_t> fDequeue;
+};
+
+/**
+ * @class AlignmentTelemetry
+ *
+ * Process-wide telemetry sink, one per process like the counters. Log() may
+ * be called from any thread; Forward() and Flush() only from the main thread,
+ * where the idle task calls Forward() every kDrainIntervalMillis. The window
+ * is published every kFlushIntervalMillis.
+ */
+class AlignmentTelemetry {
+public:
+    static AlignmentTelemetry& Instance();
+
+    AlignmentTelemetry(const AlignmentTelemetry&) = delete;
+    AlignmentTelemetry& operator=(const AlignmentTelemetry&) = delete;
+
+    // Set the sink Forward() and Flush() hand the aggregates to
+    void SetSink(const AlignmentTelemetrySink& sink);
+
+    // Queue an event without waiting
+    void Log(AlignmentTelemetryEvent event, int64_t value = 0, uint64_t durationMicros = 0);
+
+    // Main thread: drain the queue, and publish the window once it is due
+    void Forward();
+
+    // Main thread: drain the queue and hand the aggregates to the sink now
+    void Flush();
+
+    static const char* GetName(AlignmentTelemetryEvent event);
+
+    static const uint32_t kDrainIntervalMillis = 250;
+    static const uint32_t kFlushIntervalMillis = 5000;
+    static const size_t kMaxWindowSamples = 4096;
+
+private:
+    AlignmentTelemetry();
+
+    // Durations and totals of one event in the current window
+    struct Window {
+        uint64_t fCount = 0;
+        int64_t fValueSum = 0;
+        uint64_t fMaxDuration = 0;
+        std::vector<uint64_t> fDurations;   // reservoir sample of at most kMaxWindowSamples
+    };
+
+    void Drain();
+    void Publish();
+
+    AlignmentTelemetryQueue fQueue;
+    std::atomic<uint64_t> fDropped[kTelemetryEventCount];
+
+    // Consumer side, used by Forward() and Flush()
+    std::mutex fFlushMutex;
+    AlignmentTelemetrySink fSink;
+    Window fWindows[kTelemetryEventCount];
+    uint64_t fSampleSeed;
+    std::chrono::steady_clock::time_point fNextPublish;
+};
+
+#endif // __AlignmentTelemetry__
@@ -0,0 +1,77 @@
+#ifndef __AlignmentTrace__
+#define __AlignmentTrace__
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+/**
+ * @class AlignmentTrace
+ *
+ * Lightweight span tracing for the alignment pipeline.
+ * Each thread writes completed spans into its own fixed-size ring buffer
+ * without locks; the oldest spans are overwritten when the ring is full.
+ * The collected timeline can be exported as Chrome trace JSON
+ * (chrome://tracing, Perfetto) to a local file.
+ */
+class AlignmentTrace {
+public:
+    // Enable or disable recording (enabled by default)
+    static void SetEnabled(bool enabled);
+    static bool IsEnabled() { return sEnabled.load(std::memory_order_relaxed); }
+
+    // Record a completed span; name must be a string literal
+    static void Record(const char* name, uint64_t startMicros, uint64_t durationMicros);
+
+    // Microseconds on a monotonic clock
+    static uint64_t NowMicros() {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+    // Write all buffered spans as Chrome trace JSON; returns false if the file can't be written.
+    // Safe while runs record: a span overwritten during the export is left out, never torn.
+    static bool ExportChromeTrace(const std::string& path);
+
+    // Drop all buffered spans; call only while no run is active
+    static void Clear();
+
+private:
+    static std::atomic<bool> sEnabled;
+};
+
+/**
+ * @class AlignmentTraceScope
+ *
+ * Records a span covering the lifetime of the object.
+ */
+class AlignmentTraceScope {
+public:
+    explicit AlignmentTraceScope(const char* name)
+        : fName(name),
+          fStart(AlignmentTrace::IsEnabled() ? AlignmentTrace::NowMicros() : 0)
+    {
+    }
+
+    ~AlignmentTraceScope() {
+        End();
+    }
+
+    // Finish the span before the end of the scope
+    void End() {
+        if (fStart != 0) {
+            AlignmentTrace::Record(fName, fStart, AlignmentTrace::NowMicros() - fStart);
+            fStart = 0;
+        }
+    }
+
+    AlignmentTraceScope(const AlignmentTraceScope&) = delete;
+    AlignmentTraceScope& operator=(const AlignmentTraceScope&) = delete;
+
+private:
+    const char* fName;
+    uint64_t fStart;
+};
+
+#endif // __AlignmentTrace__
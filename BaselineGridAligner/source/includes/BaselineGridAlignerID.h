@@ -12,6 +12,7 @@
 #define kBaselineGridAlignerSettingsImpl       0x0C0C0C10
 #define kBaselineGridAlignerPreviewImpl        0x0C0C0C11
 #define kBaselineGridAlignerCommandImpl        0x0C0C0C12
+#define kBaselineGridAlignerTelemetryTaskImpl  0x0C0C0C13
 
 // Panel IDs
 #define kBaselineGridAlignerPanelID            "cz.baselinegrid.panel"
@@ -29,6 +30,19 @@
 #define kBaselineGridAlignerAutoApplyKey       "AutoApply"
 #define kBaselineGridAlignerShowWarningsKey    "ShowWarnings"
 #define kBaselineGridAlignerPreviewEnabledKey  "PreviewEnabled"
+#define kBaselineGridAlignerLeadingMultipleKey "LeadingMultiple"
+
+// Diagnostics files (written to the temp folder)
+#define kBaselineGridAlignerCountersFileName   "BaselineGridAlignerCounters.json"
+#define kBaselineGridAlignerTraceFileName      "BaselineGridAlignerTrace.json"
+#define kBaselineGridAlignerRecordingFilePrefix "BaselineGridAlignerSession-"
+#define kBaselineGridAlignerRecordingExtension  ".bgar"
+#define kBaselineGridAlignerStatsFileName      "BaselineGridAlignerStats.bgas"
+#define kBaselineGridAlignerReportFileName     "BaselineGridAlignerReport.txt"
+
+// Per-document fingerprint caches (folder in the temp folder)
+#define kBaselineGridAlignerCacheFolderName    "BaselineGridAlignerCache"
+#define kBaselineGridAlignerCacheExtension     ".bgaf"
 
 // UI Constants
 #define kBaselineGridAlignerPanelMinWidth      220
@@ -41,7 +55,9 @@ enum BaselineGridAlignmentType {
     kAlignmentTypeBaseline = 0,
     kAlignmentTypeTracking = 1,
     kAlignmentTypeWordSpacing = 2,
-    kAlignmentTypeCombined = 3
+    kAlignmentTypeCombined = 3,
+    kAlignmentTypeLines = 4,
+    kAlignmentTypeLeading = 5
 };
 
 // Progress Bar ID
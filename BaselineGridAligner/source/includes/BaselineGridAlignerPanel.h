@@ -24,6 +24,9 @@
  * 
  * UI panel for the BaselineGridAligner plugin.
  * Provides a clean, intuitive interface for controlling the baseline grid alignment.
+ * Settings and controls are built when the panel is first shown and the
+ * observers are attached only while it is visible, so a closed panel costs
+ * nothing at InDesign launch.
  */
 class BaselineGridAlignerPanel : public CPMUnknown<IPanel, IObserver> {
 public:
@@ -56,11 +59,13 @@ private:
     IDropDownListController* fAlignmentTypeDropDown;
     IColorSelectorData* fHighlightColorSelector;
     ITextControlData* fWordSpacingEdit;
+    ITextControlData* fLeadingMultipleEdit;
     ITriStateControlData* fAutoApplyCheckbox;
     ITriStateControlData* fShowWarningsCheckbox;
     ITriStateControlData* fPreviewEnabledCheckbox;
+    ITextControlData* fCountersText;
     
-    // Settings
+    // Settings, read on first show
     std::unique_ptr<BaselineGridAlignerSettings> fSettings;
     
     // State
@@ -68,24 +73,33 @@ private:
     bool fIsVisible;
     bool fHasSelection;
     bool fHasDocument;
+    bool fControlsInitialized;
+    bool fObserversAttached;
     
     // Methods
+    void EnsureControls();
     void InitializeControls();
     void UpdateControlsFromSettings();
     void UpdateSettingsFromControls();
     void ApplyAlignment();
     void UpdatePreview();
     void EnableDisableControls();
+    void UpdateCountersDisplay();
     
     // Event handlers
+    void HandleControlChange(const ClassID& theChange, const PMIID& protocol, const WidgetID& widgetID);
     void HandleAlignmentTypeChange();
     void HandleHighlightColorChange();
     void HandleWordSpacingChange();
+    void HandleLeadingMultipleChange();
     void HandleAutoApplyChange();
     void HandleShowWarningsChange();
     void HandlePreviewEnabledChange();
     void HandleApplyButtonClick();
+    void HandleAlignDocumentButtonClick();
     void HandleResetButtonClick();
+    void HandleExportDiagnosticsButtonClick();
+    void HandleRecordSessionButtonClick();
 };
 
 /**
@@ -34,6 +34,7 @@ public:
     PMColor GetHighlightColor() const { return fHighlightColor; }
     BaselineGridAlignmentType GetAlignmentType() const { return fAlignmentType; }
     PMReal GetWordSpacingFactor() const { return fWordSpacingFactor; }
+    int32 GetLeadingMultiple() const { return fLeadingMultiple; }
     bool GetAutoApply() const { return fAutoApply; }
     bool GetShowWarnings() const { return fShowWarnings; }
     bool GetPreviewEnabled() const { return fPreviewEnabled; }
@@ -42,6 +43,7 @@ public:
     void SetHighlightColor(const PMColor& color);
     void SetAlignmentType(BaselineGridAlignmentType type);
     void SetWordSpacingFactor(PMReal factor);
+    void SetLeadingMultiple(int32 multiple);
     void SetAutoApply(bool autoApply);
     void SetShowWarnings(bool showWarnings);
     void SetPreviewEnabled(bool enabled);
@@ -54,6 +56,7 @@ private:
     PMColor fHighlightColor;
     BaselineGridAlignmentType fAlignmentType;
     PMReal fWordSpacingFactor;
+    int32 fLeadingMultiple;     // grid steps per line, 0 = nearest multiple
     bool fAutoApply;
     bool fShowWarnings;
     bool fPreviewEnabled;
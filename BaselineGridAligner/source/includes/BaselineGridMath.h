@@ -0,0 +1,169 @@
+#ifndef __BaselineGridMath__
+#define __BaselineGridMath__
+
+#include "RunArena.h"
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Grid values are kept in fixed point (1/1000 pt) so snapping is exact and
+// gives the same result on every machine and thread count.
+typedef int64_t GridFixed;
+
+const GridFixed kGridFixedScale = 1000;
+
+// Convert points to fixed point, rounding to the nearest 1/1000 pt
+inline GridFixed ToGridFixed(double points)
+{
+    return static_cast<GridFixed>(std::llround(points * static_cast<double>(kGridFixedScale)));
+}
+
+inline double FromGridFixed(GridFixed value)
+{
+    return static_cast<double>(value) / static_cast<double>(kGridFixedScale);
+}
+
+// Snap a value to the nearest multiple of increment (halves round up).
+// Branch-free so loops over many values stay vectorizable.
+inline GridFixed SnapToGrid(GridFixed value, GridFixed increment)
+{
+    const GridFixed shifted = value + increment / 2;
+    GridFixed quotient = shifted / increment;
+    quotient -= static_cast<GridFixed>((shifted % increment != 0) & (shifted < 0));
+    return quotient * increment;
+}
+
+// Baseline grid in effect for some text: the document grid or a frame's own grid
+struct BaselineGrid {
+    GridFixed fIncrement;
+    GridFixed fStart;
+
+    bool operator==(const BaselineGrid& other) const {
+        return fIncrement == other.fIncrement && fStart == other.fStart;
+    }
+    bool operator!=(const BaselineGrid& other) const { return !(*this == other); }
+};
+
+// Signed distance from value to the nearest grid multiple
+inline GridFixed GridDeviation(GridFixed value, GridFixed increment)
+{
+    return SnapToGrid(value, increment) - value;
+}
+
+/**
+ * @class BaselineLineMetrics
+ *
+ * Metrics of composed lines collected from the wax, stored as parallel arrays
+ * so the deviation pass can run over them in a single vectorized loop.
+ * Baselines are composed positions without baseline shift; the shift in
+ * effect for each line is kept next to them.
+ */
+class BaselineLineMetrics {
+public:
+    // Without an arena the arrays live on the heap
+    explicit BaselineLineMetrics(RunArena* arena = nullptr)
+        : fTextIndex(ArenaAllocator<int32_t>(arena)),
+          fTextSpan(ArenaAllocator<int32_t>(arena)),
+          fBaselineY(ArenaAllocator<GridFixed>(arena)),
+          fLineHeight(ArenaAllocator<GridFixed>(arena)),
+          fBaselineShift(ArenaAllocator<GridFixed>(arena))
+    {
+    }
+
+    void Reserve(size_t count) {
+        fTextIndex.reserve(count);
+        fTextSpan.reserve(count);
+        fBaselineY.reserve(count);
+        fLineHeight.reserve(count);
+        fBaselineShift.reserve(count);
+    }
+
+    void Append(int32_t textIndex, int32_t textSpan, GridFixed baselineY, GridFixed lineHeight,
+                GridFixed baselineShift) {
+        fTextIndex.push_back(textIndex);
+        fTextSpan.push_back(textSpan);
+        fBaselineY.push_back(baselineY);
+        fLineHeight.push_back(lineHeight);
+        fBaselineShift.push_back(baselineShift);
+    }
+
+    size_t Size() const { return fBaselineY.size(); }
+
+    ArenaVector<int32_t> fTextIndex;
+    ArenaVector<int32_t> fTextSpan;
+    ArenaVector<GridFixed> fBaselineY;      // unshifted baseline
+    ArenaVector<GridFixed> fLineHeight;
+    ArenaVector<GridFixed> fBaselineShift;  // shift in effect, positive raises the text
+};
+
+// Lines closer to the grid than this (0.01 pt) are treated as aligned
+const GridFixed kLineGridTolerance = 10;
+
+// Compute signed distance from each baseline to the nearest grid line.
+// Positive deviation means the line has to move down to reach the grid.
+inline void ComputeLineDeviations(const GridFixed* baselineY, size_t count,
+                                  GridFixed gridStart, GridFixed gridIncrement,
+                                  GridFixed* deviations)
+{
+#ifdef _OPENMP
+    #pragma omp simd
+#endif
+    for (size_t i = 0; i < count; i++) {
+        deviations[i] = GridDeviation(baselineY[i] - gridStart, gridIncrement);
+    }
+}
+
+// Collect indices of lines whose shift doesn't put them on the grid, skipping
+// empty (zero height) lines. The deviations are those of the unshifted lines,
+// so the shift that aligns a line is -deviation, and the line is off the grid
+// by deviation + shift. Returns the number of indices written to offGridLines.
+inline size_t CollectOffGridLines(const GridFixed* deviations, const GridFixed* shifts,
+                                  const GridFixed* lineHeights, size_t count, GridFixed tolerance,
+                                  uint32_t* offGridLines)
+{
+    size_t found = 0;
+    for (size_t i = 0; i < count; i++) {
+        const GridFixed distance = deviations[i] + shifts[i];
+        const GridFixed magnitude = distance < 0 ? -distance : distance;
+        offGridLines[found] = static_cast<uint32_t>(i);
+        found += (lineHeights[i] > 0 && magnitude > tolerance) ? 1 : 0;
+    }
+    return found;
+}
+
+// Scale that brings fontSize onto the nearest grid multiple.
+// Computed from exact integers, so the result is reproducible.
+inline double GridScaleFactor(GridFixed fontSize, GridFixed gridIncrement)
+{
+    if (fontSize <= 0 || gridIncrement <= 0) return 1.0;
+
+    GridFixed snapped = SnapToGrid(fontSize, gridIncrement);
+    if (snapped == 0) snapped = gridIncrement;
+    return static_cast<double>(snapped) / static_cast<double>(fontSize);
+}
+
+// Auto leading percentage InDesign uses when a paragraph doesn't set one
+const GridFixed kDefaultAutoLeadingPercent = 120 * kGridFixedScale;
+
+// Leading that auto leading resolves to: a percentage (in GridFixed) of the font size
+inline GridFixed ResolveAutoLeading(GridFixed fontSize, GridFixed percent)
+{
+    if (percent <= 0) {
+        percent = kDefaultAutoLeadingPercent;
+    }
+    return fontSize * percent / (100 * kGridFixedScale);
+}
+
+// Leading that fits the grid: a fixed number of grid steps if multiple > 0,
+// otherwise the nearest grid multiple, never less than one step
+inline GridFixed SnapLeadingToGrid(GridFixed leading, GridFixed gridIncrement, int32_t multiple)
+{
+    if (gridIncrement <= 0) return leading;
+    if (multiple > 0) return gridIncrement * multiple;
+
+    const GridFixed snapped = SnapToGrid(leading, gridIncrement);
+    return snapped > 0 ? snapped : gridIncrement;
+}
+
+#endif // __BaselineGridMath__
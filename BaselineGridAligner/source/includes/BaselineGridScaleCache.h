@@ -0,0 +1,81 @@
+#ifndef __BaselineGridScaleCache__
+#define __BaselineGridScaleCache__
+
+#include "BaselineGridMath.h"
+
+/**
+ * @class BaselineGridScaleCache
+ *
+ * Small fixed-size hash table memoizing scale factors keyed by fixed-point
+ * (font size, grid increment). Documents reuse only a handful of sizes,
+ * so a few dozen open-addressed slots cover a whole story.
+ */
+class BaselineGridScaleCache {
+public:
+    BaselineGridScaleCache() { Clear(); }
+
+    void Clear() {
+        for (int i = 0; i < kSlotCount; i++) {
+            fSlots[i].fUsed = false;
+        }
+        fUsedCount = 0;
+    }
+
+    // Returns true and fills scale if the key is cached
+    bool Lookup(GridFixed fontKey, GridFixed gridKey, double* scale) const {
+        for (int probe = 0, slot = SlotFor(fontKey, gridKey); probe < kSlotCount;
+             probe++, slot = (slot + 1) & (kSlotCount - 1)) {
+            const Slot& entry = fSlots[slot];
+            if (!entry.fUsed) return false;
+            if (entry.fFontKey == fontKey && entry.fGridKey == gridKey) {
+                *scale = entry.fScale;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void Insert(GridFixed fontKey, GridFixed gridKey, double scale) {
+        // Keep probe chains short; start over rather than fill the table
+        if (fUsedCount >= kSlotCount / 2) {
+            Clear();
+        }
+
+        int slot = SlotFor(fontKey, gridKey);
+        while (fSlots[slot].fUsed &&
+               !(fSlots[slot].fFontKey == fontKey && fSlots[slot].fGridKey == gridKey)) {
+            slot = (slot + 1) & (kSlotCount - 1);
+        }
+
+        if (!fSlots[slot].fUsed) {
+            fUsedCount++;
+        }
+        fSlots[slot].fUsed = true;
+        fSlots[slot].fFontKey = fontKey;
+        fSlots[slot].fGridKey = gridKey;
+        fSlots[slot].fScale = scale;
+    }
+
+private:
+    static const int kSlotCount = 64;
+
+    struct Slot {
+        GridFixed fFontKey;
+        GridFixed fGridKey;
+        double fScale;
+        bool fUsed;
+    };
+
+    Slot fSlots[kSlotCount];
+    int fUsedCount;
+
+    static int SlotFor(GridFixed fontKey, GridFixed gridKey) {
+        uint64_t hash = static_cast<uint64_t>(fontKey) * 0x9E3779B97F4A7C15ULL ^ static_cast<uint64_t>(gridKey);
+        hash ^= hash >> 29;
+        hash *= 0xBF58476D1CE4E5B9ULL;
+        hash ^= hash >> 32;
+        return static_cast<int>(hash & (kSlotCount - 1));
+    }
+};
+
+#endif // __BaselineGridScaleCache__
@@ -0,0 +1,108 @@
+#ifndef __BaselineGridStrategies__
+#define __BaselineGridStrategies__
+
+#include "BaselineGridMath.h"
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Attribute-based alignment strategies.
+ *
+ * Each strategy is a policy type describing which attributes it touches.
+ * The shared engine (CollectStyleRunChanges and ApplyStyleRunChanges in
+ * BaselineGridAligner.cpp) reads, computes and applies only those
+ * attributes, so every mode gets its own
+ * branch-free inner loop and a new mode only needs a new policy.
+ */
+
+// Attributes of one style run as read from the text model
+struct StyleRunSnapshot {
+    int32_t fStart;
+    int32_t fLength;
+    GridFixed fFontSize;
+    double fTracking;
+    double fWordSpacing;
+    double fBaseTracking;       // style value the correction scales, so re-runs give the same result
+    double fBaseWordSpacing;
+    GridFixed fLeading;
+    GridFixed fGridIncrement;   // grid of the frame where the run starts
+};
+
+// New attribute values computed for one style run
+struct StyleRunCorrection {
+    double fTracking;
+    double fWordSpacing;
+    GridFixed fLeading;
+};
+
+// Settings shared by all runs of one alignment
+struct StyleRunParameters {
+    double fWordSpacingFactor;
+    int32_t fLeadingMultiple;
+};
+
+struct TrackingStrategy {
+    static constexpr bool kTouchesTracking = true;
+    static constexpr bool kTouchesWordSpacing = false;
+    static constexpr bool kTouchesLeading = false;
+};
+
+struct WordSpacingStrategy {
+    static constexpr bool kTouchesTracking = false;
+    static constexpr bool kTouchesWordSpacing = true;
+    static constexpr bool kTouchesLeading = false;
+};
+
+struct CombinedStrategy {
+    static constexpr bool kTouchesTracking = true;
+    static constexpr bool kTouchesWordSpacing = true;
+    static constexpr bool kTouchesLeading = false;
+};
+
+struct LeadingStrategy {
+    static constexpr bool kTouchesTracking = false;
+    static constexpr bool kTouchesWordSpacing = false;
+    static constexpr bool kTouchesLeading = true;
+};
+
+// Compute corrections for all runs; scales holds the grid scale of each run.
+// Tracking and word spacing scale the base value rather than the current one,
+// so a run already corrected computes its current value again.
+template <class Strategy>
+inline void ComputeStyleRunCorrections(const StyleRunSnapshot* runs, const double* scales,
+                                       size_t count, const StyleRunParameters& parameters,
+                                       StyleRunCorrection* corrections)
+{
+    for (size_t i = 0; i < count; i++) {
+        if constexpr (Strategy::kTouchesTracking) {
+            corrections[i].fTracking = runs[i].fBaseTracking * scales[i];
+        }
+        if constexpr (Strategy::kTouchesWordSpacing) {
+            corrections[i].fWordSpacing = runs[i].fBaseWordSpacing * scales[i] * parameters.fWordSpacingFactor;
+        }
+        if constexpr (Strategy::kTouchesLeading) {
+            corrections[i].fLeading = SnapLeadingToGrid(runs[i].fLeading, runs[i].fGridIncrement,
+                                                        parameters.fLeadingMultiple);
+        }
+    }
+}
+
+// True if the correction would change any attribute the strategy touches.
+// Values are compared at fixed-point precision, so rounding noise doesn't count.
+template <class Strategy>
+inline bool StyleRunNeedsChange(const StyleRunSnapshot& run, const StyleRunCorrection& correction)
+{
+    bool changed = false;
+    if constexpr (Strategy::kTouchesTracking) {
+        changed |= ToGridFixed(correction.fTracking) != ToGridFixed(run.fTracking);
+    }
+    if constexpr (Strategy::kTouchesWordSpacing) {
+        changed |= ToGridFixed(correction.fWordSpacing) != ToGridFixed(run.fWordSpacing);
+    }
+    if constexpr (Strategy::kTouchesLeading) {
+        changed |= correction.fLeading != run.fLeading;
+    }
+    return changed;
+}
+
+#endif // __BaselineGridStrategies__
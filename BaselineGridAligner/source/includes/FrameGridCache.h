@@ -0,0 +1,42 @@
+#ifndef __FrameGridCache__
+#define __FrameGridCache__
+
+#include "BaselineGridMath.h"
+#include <cstdint>
+#include <unordered_map>
+
+/**
+ * @class FrameGridCache
+ *
+ * Effective baseline grid per text frame, keyed by frame UID.
+ * Frames with their own grid map to it, all others to the document grid,
+ * so each frame's grid options are read once rather than per parcel.
+ * Not thread safe; used from the serial collection passes only.
+ */
+class FrameGridCache {
+public:
+    bool Lookup(uint32_t frameID, BaselineGrid* grid) const {
+        const auto it = fGrids.find(frameID);
+        if (it == fGrids.end()) return false;
+        *grid = it->second;
+        return true;
+    }
+
+    void Insert(uint32_t frameID, const BaselineGrid& grid) {
+        fGrids[frameID] = grid;
+    }
+
+    // Frame options changed; the grid is resolved again on next use
+    void Invalidate(uint32_t frameID) {
+        fGrids.erase(frameID);
+    }
+
+    void Clear() {
+        fGrids.clear();
+    }
+
+private:
+    std::unordered_map<uint32_t, BaselineGrid> fGrids;
+};
+
+#endif // __FrameGridCache__
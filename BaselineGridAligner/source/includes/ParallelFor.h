@@ -0,0 +1,297 @@
+#ifndef __ParallelFor__
+#define __ParallelFor__
+
+#include "AlignmentTrace.h"
+#include "ParallelPolicy.h"
+#include "RunArena.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @class ParallelLoopState
+ *
+ * Keeps the first exception thrown by any thread of a loop. Once one is
+ * set the remaining chunks are skipped, and the caller rethrows it after
+ * all threads have left the loop.
+ */
+class ParallelLoopState {
+public:
+    ParallelLoopState() : fStopped(false) {}
+
+    bool IsStopped() const { return fStopped.load(std::memory_order_relaxed); }
+
+    void Fail(std::exception_ptr error) {
+        std::lock_guard<std::mutex> lock(fMutex);
+        if (!fError) {
+            fError = error;
+        }
+        fStopped.store(true, std::memory_order_relaxed);
+    }
+
+    void RethrowIfFailed() {
+        if (fError) {
+            std::rethrow_exception(fError);
+        }
+    }
+
+private:
+    std::atomic<bool> fStopped;
+    std::mutex fMutex;
+    std::exception_ptr fError;
+};
+
+/**
+ * @class ChunkRange
+ *
+ * Chunks assigned to one thread of the portable pool. The owner takes chunks
+ * from the front, idle threads steal from the back. Both ends share one
+ * atomic word, so neither side needs a lock.
+ */
+class ChunkRange {
+public:
+    ChunkRange() : fRange(0) {}
+
+    void Assign(uint32_t begin, uint32_t end) {
+        fRange.store(Pack(begin, end), std::memory_order_relaxed);
+    }
+
+    bool TakeFront(int32_t* chunk) {
+        uint64_t range = fRange.load(std::memory_order_acquire);
+        for (;;) {
+            const uint32_t begin = Begin(range);
+            const uint32_t end = End(range);
+            if (begin >= end) return false;
+            if (fRange.compare_exchange_weak(range, Pack(begin + 1, end), std::memory_order_acq_rel)) {
+                *chunk = static_cast<int32_t>(begin);
+                return true;
+            }
+        }
+    }
+
+    bool StealBack(int32_t* chunk) {
+        uint64_t range = fRange.load(std::memory_order_acquire);
+        for (;;) {
+            const uint32_t begin = Begin(range);
+            const uint32_t end = End(range);
+            if (begin >= end) return false;
+            if (fRange.compare_exchange_weak(range, Pack(begin, end - 1), std::memory_order_acq_rel)) {
+                *chunk = static_cast<int32_t>(end - 1);
+                return true;
+            }
+        }
+    }
+
+private:
+    static uint64_t Pack(uint32_t begin, uint32_t end) {
+        return (static_cast<uint64_t>(begin) << 32) | end;
+    }
+    static uint32_t Begin(uint64_t range) { return static_cast<uint32_t>(range >> 32); }
+    static uint32_t End(uint64_t range) { return static_cast<uint32_t>(range); }
+
+    // Own cache line, so threads working on their own ranges don't slow each other down
+    alignas(64) std::atomic<uint64_t> fRange;
+};
+
+// True while the calling thread runs a loop of the portable pool
+inline bool& InsideParallelLoop()
+{
+    thread_local bool inside = false;
+    return inside;
+}
+
+/**
+ * @class ParallelWorkerPool
+ *
+ * Persistent worker threads for parallel loops when OpenMP is not available.
+ * Threads are started on first use and kept for later loops. The calling
+ * thread takes part as participant 0, so a loop on N threads wakes N - 1
+ * workers. One loop runs at a time.
+ */
+class ParallelWorkerPool {
+public:
+    static ParallelWorkerPool& Instance() {
+        static ParallelWorkerPool pool;
+        return pool;
+    }
+
+    ~ParallelWorkerPool() {
+        {
+            std::lock_guard<std::mutex> lock(fMutex);
+            fStopping = true;
+        }
+        fWake.notify_all();
+        for (std::thread& worker : fWorkers) {
+            worker.join();
+        }
+    }
+
+    ParallelWorkerPool(const ParallelWorkerPool&) = delete;
+    ParallelWorkerPool& operator=(const ParallelWorkerPool&) = delete;
+
+    // Run task(participant) for participants 0 .. count - 1 and wait for all of them.
+    // The task must not throw.
+    void Run(int count, const std::function<void(int)>& task) {
+        std::lock_guard<std::mutex> runLock(fRunMutex);
+        StartWorkers(count - 1);
+
+        {
+            std::lock_guard<std::mutex> lock(fMutex);
+            fTask = &task;
+            fParticipants = count;
+            fPending = count - 1;
+            fGeneration++;
+        }
+        fWake.notify_all();
+
+        InsideParallelLoop() = true;
+        task(0);
+        InsideParallelLoop() = false;
+
+        std::unique_lock<std::mutex> lock(fMutex);
+        fDone.wait(lock, [this] { return fPending == 0; });
+        fTask = nullptr;
+    }
+
+private:
+    ParallelWorkerPool()
+        : fTask(nullptr),
+          fParticipants(0),
+          fPending(0),
+          fGeneration(0),
+          fStopping(false)
+    {
+    }
+
+    void StartWorkers(int count) {
+        while (static_cast<int>(fWorkers.size()) < count) {
+            const int participant = static_cast<int>(fWorkers.size()) + 1;
+            fWorkers.emplace_back([this, participant] { WorkerMain(participant); });
+        }
+    }
+
+    void WorkerMain(int participant) {
+        RunThreadSlot() = participant;
+        InsideParallelLoop() = true;
+
+        uint64_t seenGeneration = 0;
+        for (;;) {
+            const std::function<void(int)>* task;
+            {
+                std::unique_lock<std::mutex> lock(fMutex);
+                fWake.wait(lock, [&] { return fStopping || fGeneration != seenGeneration; });
+                if (fStopping) return;
+
+                seenGeneration = fGeneration;
+                if (participant >= fParticipants) continue;
+                task = fTask;
+            }
+
+            (*task)(participant);
+
+            std::lock_guard<std::mutex> lock(fMutex);
+            if (--fPending == 0) {
+                fDone.notify_one();
+            }
+        }
+    }
+
+    std::mutex fRunMutex;
+    std::mutex fMutex;
+    std::condition_variable fWake;
+    std::condition_variable fDone;
+    std::vector<std::thread> fWorkers;
+    const std::function<void(int)>* fTask;
+    int fParticipants;
+    int fPending;
+    uint64_t fGeneration;
+    bool fStopping;
+};
+
+/**
+ * Run body(chunk) for every chunk of a plan, on plan.fThreadCount threads
+ * when the plan is parallel. Uses OpenMP with dynamic scheduling when the
+ * build has it, otherwise the portable pool: each thread starts on its own
+ * contiguous block of chunks and steals from the others when done.
+ *
+ * If the body throws (e.g. on user cancel), the other threads stop taking
+ * chunks and the first exception is rethrown to the caller. RunThreadIndex()
+ * identifies the thread inside the body in both cases. Each thread records
+ * one trace span named spanName.
+ */
+template <class Body>
+void ParallelForChunks(const ParallelPlan& plan, const char* spanName, Body body)
+{
+    const int32_t chunkCount = plan.GetChunkCount();
+    if (chunkCount == 0) return;
+
+    ParallelLoopState state;
+
+#ifdef _OPENMP
+    #pragma omp parallel num_threads(plan.fThreadCount) if(plan.fParallel)
+    {
+    AlignmentTraceScope workerSpan(spanName);
+
+    #pragma omp for schedule(dynamic, 1)
+    for (int32_t c = 0; c < chunkCount; c++) {
+        if (state.IsStopped()) continue;
+        try {
+            body(c);
+        }
+        catch (...) {
+            state.Fail(std::current_exception());
+        }
+    }
+    }
+#else
+    // Nested loops run serially on the thread that reaches them
+    const int threadCount = (plan.fParallel && !InsideParallelLoop())
+        ? std::min<int>(plan.fThreadCount, chunkCount) : 1;
+
+    if (threadCount <= 1) {
+        AlignmentTraceScope workerSpan(spanName);
+        for (int32_t c = 0; c < chunkCount; c++) {
+            body(c);
+        }
+        return;
+    }
+
+    // Contiguous initial blocks keep neighbouring parcels on one thread
+    std::unique_ptr<ChunkRange[]> ranges(new ChunkRange[threadCount]);
+    for (int t = 0; t < threadCount; t++) {
+        ranges[t].Assign(static_cast<uint32_t>(static_cast<int64_t>(chunkCount) * t / threadCount),
+                         static_cast<uint32_t>(static_cast<int64_t>(chunkCount) * (t + 1) / threadCount));
+    }
+
+    ParallelWorkerPool::Instance().Run(threadCount, [&](int participant) {
+        AlignmentTraceScope workerSpan(spanName);
+
+        int32_t chunk;
+        while (!state.IsStopped()) {
+            bool found = ranges[participant].TakeFront(&chunk);
+            for (int offset = 1; !found && offset < threadCount; offset++) {
+                found = ranges[(participant + offset) % threadCount].StealBack(&chunk);
+            }
+            if (!found) break;
+
+            try {
+                body(chunk);
+            }
+            catch (...) {
+                state.Fail(std::current_exception());
+            }
+        }
+    });
+#endif
+
+    state.RethrowIfFailed();
+}
+
+#endif // __ParallelFor__
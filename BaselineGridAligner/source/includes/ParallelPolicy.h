@@ -0,0 +1,143 @@
+#ifndef __ParallelPolicy__
+#define __ParallelPolicy__
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+/**
+ * @struct ParallelPlan
+ *
+ * How a parcel loop should run: serial or parallel, with how many threads,
+ * and contiguous chunks of roughly equal weight for dynamic scheduling.
+ * Chunk c covers items [fChunkBounds[c], fChunkBounds[c + 1]).
+ */
+struct ParallelPlan {
+    bool fParallel;
+    int fThreadCount;
+    std::vector<int32_t> fChunkBounds;
+    uint64_t fTotalWeight;
+
+    int32_t GetChunkCount() const {
+        return fChunkBounds.empty() ? 0 : static_cast<int32_t>(fChunkBounds.size() - 1);
+    }
+};
+
+/**
+ * @class ParallelPolicy
+ *
+ * Picks serial or parallel execution, thread count and chunking for a loop
+ * from the amount of work and the cost measured on previous runs.
+ * Work is weighted by parcel character length, so a few long parcels
+ * don't end up in the same chunk as many short ones.
+ */
+class ParallelPolicy {
+public:
+    ParallelPolicy()
+        : fNanosPerUnit(kDefaultNanosPerUnit),
+          fThreadLimit(0),
+          fForceParallel(false)
+    {
+    }
+
+    // Plan a loop over items with the given character lengths
+    ParallelPlan Plan(const int32_t* lengths, size_t count) const {
+        ParallelPlan plan;
+        plan.fParallel = false;
+        plan.fThreadCount = 1;
+        plan.fTotalWeight = 0;
+
+        for (size_t i = 0; i < count; i++) {
+            plan.fTotalWeight += Weight(lengths[i]);
+        }
+
+        // Small jobs run faster without paying for thread start-up
+        const double estimatedNanos = static_cast<double>(plan.fTotalWeight) * fNanosPerUnit;
+        int threads = fForceParallel ? GetThreadLimit() : static_cast<int>(estimatedNanos / kMinNanosPerThread);
+        threads = std::max(1, std::min(threads, GetThreadLimit()));
+        threads = std::min<int>(threads, static_cast<int>(std::max<size_t>(count, 1)));
+
+        plan.fParallel = threads > 1 && (fForceParallel || estimatedNanos >= kSerialThresholdNanos);
+        plan.fThreadCount = plan.fParallel ? threads : 1;
+
+        // Split into contiguous chunks of roughly equal weight
+        const int chunkCount = plan.fParallel
+            ? static_cast<int>(std::min<size_t>(count, static_cast<size_t>(threads) * kChunksPerThread))
+            : (count > 0 ? 1 : 0);
+
+        plan.fChunkBounds.reserve(chunkCount + 1);
+        plan.fChunkBounds.push_back(0);
+        if (chunkCount > 1) {
+            const uint64_t targetWeight = (plan.fTotalWeight + chunkCount - 1) / chunkCount;
+            uint64_t chunkWeight = 0;
+            for (size_t i = 0; i < count; i++) {
+                chunkWeight += Weight(lengths[i]);
+                if (chunkWeight >= targetWeight && i + 1 < count) {
+                    plan.fChunkBounds.push_back(static_cast<int32_t>(i + 1));
+                    chunkWeight = 0;
+                }
+            }
+        }
+        if (count > 0) {
+            plan.fChunkBounds.push_back(static_cast<int32_t>(count));
+        }
+        return plan;
+    }
+
+    // Feed back the measured wall time of a planned loop
+    void RecordCost(const ParallelPlan& plan, uint64_t elapsedNanos) {
+        if (plan.fTotalWeight == 0) return;
+
+        // Approximate CPU time per weight unit across all threads used
+        const double measured = static_cast<double>(elapsedNanos) * plan.fThreadCount /
+                                static_cast<double>(plan.fTotalWeight);
+        fNanosPerUnit += kSmoothing * (measured - fNanosPerUnit);
+    }
+
+    double GetNanosPerUnit() const { return fNanosPerUnit; }
+
+    // Cap the threads a plan may use, e.g. for scaling benchmarks; 0 = no cap
+    void SetThreadLimit(int limit) { fThreadLimit = std::max(0, limit); }
+
+    // Plan every loop with all allowed threads, whatever the estimated cost.
+    // Only for scaling benchmarks, which must measure the parallel path.
+    void SetForceParallel(bool force) { fForceParallel = force; }
+
+    int GetThreadLimit() const {
+        return fThreadLimit > 0 ? std::min(fThreadLimit, GetMaxThreads()) : GetMaxThreads();
+    }
+
+    static int GetMaxThreads() {
+#ifdef _OPENMP
+        return omp_get_max_threads();
+#else
+        return std::max(1u, std::thread::hardware_concurrency());
+#endif
+    }
+
+private:
+    // Each parcel costs at least this many characters worth of work
+    static const int32_t kParcelBaseWeight = 64;
+    static const int kChunksPerThread = 4;
+
+    static constexpr double kDefaultNanosPerUnit = 20.0;
+    static constexpr double kSerialThresholdNanos = 250000.0;
+    static constexpr double kMinNanosPerThread = 100000.0;
+    static constexpr double kSmoothing = 0.25;
+
+    double fNanosPerUnit;
+    int fThreadLimit;
+    bool fForceParallel;
+
+    static uint64_t Weight(int32_t length) {
+        return static_cast<uint64_t>(std::max<int32_t>(length, 0) + kParcelBaseWeight);
+    }
+};
+
+#endif // __ParallelPolicy__
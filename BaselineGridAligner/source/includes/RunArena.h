@@ -0,0 +1,320 @@
+#ifndef __RunArena__
+#define __RunArena__
+
+#include "AlignmentCounters.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+/**
+ * @class RunArena
+ *
+ * Monotonic bump allocator for temporary data of one alignment run.
+ * Memory is never freed individually; Reset() rewinds to the first block
+ * in O(1) and keeps all blocks, so a steady-state run allocates nothing
+ * from the heap once the arena has grown to the size of a typical run.
+ * An arena is used by one thread at a time.
+ */
+class RunArena {
+public:
+    RunArena()
+        : fCurrent(0),
+          fOffset(0),
+          fHeapAllocations(0),
+          fBytesServed(0)
+    {
+    }
+
+    ~RunArena() {
+        for (Block& block : fBlocks) {
+            ::operator delete(block.fData);
+        }
+    }
+
+    RunArena(const RunArena&) = delete;
+    RunArena& operator=(const RunArena&) = delete;
+
+    void* Allocate(size_t size, size_t alignment) {
+        fBytesServed += size;
+
+        // Try the current block, then blocks kept from earlier runs
+        while (fCurrent < fBlocks.size()) {
+            Block& block = fBlocks[fCurrent];
+            const size_t aligned = (fOffset + alignment - 1) & ~(alignment - 1);
+            if (aligned + size <= block.fSize) {
+                fOffset = aligned + size;
+                return block.fData + aligned;
+            }
+            fCurrent++;
+            fOffset = 0;
+        }
+
+        // Grow geometrically so the block count stays small
+        const size_t lastSize = fBlocks.empty() ? 0 : fBlocks.back().fSize;
+        const size_t blockSize = std::max(std::max(kMinBlockSize, lastSize * 2), size + alignment);
+        Block block;
+        block.fData = static_cast<char*>(::operator new(blockSize));
+        block.fSize = blockSize;
+        fBlocks.push_back(block);
+        fHeapAllocations++;
+
+        fCurrent = fBlocks.size() - 1;
+        const size_t aligned = (reinterpret_cast<uintptr_t>(block.fData) % alignment == 0) ? 0 :
+            alignment - reinterpret_cast<uintptr_t>(block.fData) % alignment;
+        fOffset = aligned + size;
+        return block.fData + aligned;
+    }
+
+    // Release everything allocated since the last reset
+    void Reset() {
+        fCurrent = 0;
+        fOffset = 0;
+    }
+
+    // Heap blocks allocated over the arena's lifetime
+    uint64_t GetHeapAllocations() const { return fHeapAllocations; }
+    uint64_t GetBytesServed() const { return fBytesServed; }
+
+private:
+    static constexpr size_t kMinBlockSize = 64 * 1024;
+
+    struct Block {
+        char* fData;
+        size_t fSize;
+    };
+
+    std::vector<Block> fBlocks;
+    size_t fCurrent;
+    size_t fOffset;
+    uint64_t fHeapAllocations;
+    uint64_t fBytesServed;
+};
+
+/**
+ * @class ArenaAllocator
+ *
+ * Standard allocator serving memory from a RunArena.
+ * Without an arena it falls back to the heap. Moving or swapping a vector
+ * takes its arena along, so moved data is never copied into another arena.
+ */
+template <class T>
+class ArenaAllocator {
+public:
+    typedef T value_type;
+    typedef std::true_type propagate_on_container_move_assignment;
+    typedef std::true_type propagate_on_container_swap;
+
+    ArenaAllocator() : fArena(nullptr) {}
+    explicit ArenaAllocator(RunArena* arena) : fArena(arena) {}
+
+    template <class U>
+    ArenaAllocator(const ArenaAllocator<U>& other) : fArena(other.GetArena()) {}
+
+    T* allocate(size_t count) {
+        if (!fArena) {
+            return static_cast<T*>(::operator new(count * sizeof(T)));
+        }
+        return static_cast<T*>(fArena->Allocate(count * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T* pointer, size_t) {
+        // Arena memory is released all at once by RunArena::Reset
+        if (!fArena) {
+            ::operator delete(pointer);
+        }
+    }
+
+    RunArena* GetArena() const { return fArena; }
+
+    template <class U>
+    bool operator==(const ArenaAllocator<U>& other) const { return fArena == other.GetArena(); }
+    template <class U>
+    bool operator!=(const ArenaAllocator<U>& other) const { return fArena != other.GetArena(); }
+
+private:
+    RunArena* fArena;
+};
+
+template <class T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+
+// Participant index of a thread in the portable worker pool, set by ParallelForChunks
+inline int& RunThreadSlot()
+{
+    thread_local int slot = 0;
+    return slot;
+}
+
+// Index of the calling thread inside a parallel loop (0 outside of one)
+inline int RunThreadIndex()
+{
+#ifdef _OPENMP
+    return omp_get_thread_num();
+#else
+    return RunThreadSlot();
+#endif
+}
+
+/**
+ * @class RunArenaPool
+ *
+ * One arena per worker thread. Arena 0 belongs to the thread driving the run.
+ * Items of a pipeline get arenas of their own from a ring (ForItem), so their
+ * data is released item by item rather than at the end of the run.
+ */
+class RunArenaPool {
+public:
+    explicit RunArenaPool(int threadCount = 1) {
+        Resize(threadCount);
+    }
+    
+    // Ring of item arenas; at least as many as items can be in flight at once
+    void ResizeItems(size_t itemCount) {
+        while (fItemArenas.size() < itemCount) {
+            fItemArenas.push_back(std::unique_ptr<RunArena>(new RunArena()));
+        }
+    }
+    
+    // Arena of a pipeline item, reset as it is handed out. The same arena comes
+    // back ResizeItems() items later, by which time that item must be done.
+    RunArena& ForItem(size_t item) {
+        RunArena& arena = *fItemArenas[item % fItemArenas.size()];
+        arena.Reset();
+        return arena;
+    }
+
+    void Resize(int threadCount) {
+        while (static_cast<int>(fArenas.size()) < threadCount) {
+            fArenas.push_back(std::unique_ptr<RunArena>(new RunArena()));
+        }
+    }
+
+    int GetThreadCount() const { return static_cast<int>(fArenas.size()); }
+
+    RunArena& ForThread(int thread) { return *fArenas[thread]; }
+    RunArena& Main() { return *fArenas[0]; }
+
+    // End of run: release all temporary data
+    void ResetAll() {
+        for (auto& arena : fArenas) {
+            arena->Reset();
+        }
+        for (auto& arena : fItemArenas) {
+            arena->Reset();
+        }
+    }
+
+    uint64_t GetHeapAllocations() const {
+        uint64_t total = 0;
+        for (const auto& arena : fArenas) {
+            total += arena->GetHeapAllocations();
+        }
+        for (const auto& arena : fItemArenas) {
+            total += arena->GetHeapAllocations();
+        }
+        return total;
+    }
+
+    uint64_t GetBytesServed() const {
+        uint64_t total = 0;
+        for (const auto& arena : fArenas) {
+            total += arena->GetBytesServed();
+        }
+        for (const auto& arena : fItemArenas) {
+            total += arena->GetBytesServed();
+        }
+        return total;
+    }
+
+private:
+    std::vector<std::unique_ptr<RunArena>> fArenas;
+    std::vector<std::unique_ptr<RunArena>> fItemArenas;
+};
+
+/**
+ * @class PerThreadVectors
+ *
+ * One arena-backed vector per worker thread, so parallel loops can collect
+ * results without locking and merge them afterwards.
+ */
+template <class T>
+class PerThreadVectors {
+public:
+    PerThreadVectors(RunArenaPool& pool, int threadCount)
+        : fVectors(ArenaAllocator<ArenaVector<T>>(&pool.Main()))
+    {
+        pool.Resize(threadCount);
+        fVectors.reserve(threadCount);
+        for (int t = 0; t < threadCount; t++) {
+            fVectors.emplace_back(ArenaAllocator<T>(&pool.ForThread(t)));
+        }
+    }
+
+    ArenaVector<T>& Local() { return fVectors[RunThreadIndex()]; }
+
+    size_t Size() const {
+        size_t total = 0;
+        for (const auto& vector : fVectors) {
+            total += vector.size();
+        }
+        return total;
+    }
+
+    void MergeInto(ArenaVector<T>& out) const {
+        out.reserve(out.size() + Size());
+        for (const auto& vector : fVectors) {
+            out.insert(out.end(), vector.begin(), vector.end());
+        }
+    }
+
+    // Empty every vector; the capacity is kept for reuse
+    void Clear() {
+        for (auto& vector : fVectors) {
+            vector.clear();
+        }
+    }
+
+private:
+    ArenaVector<ArenaVector<T>> fVectors;
+};
+
+/**
+ * @class RunArenaScope
+ *
+ * Releases all run arenas when a run ends and adds the heap allocations
+ * and bytes the run needed to the counters.
+ */
+class RunArenaScope {
+public:
+    explicit RunArenaScope(RunArenaPool& pool)
+        : fPool(pool),
+          fHeapAllocations(pool.GetHeapAllocations()),
+          fBytesServed(pool.GetBytesServed())
+    {
+    }
+
+    ~RunArenaScope() {
+        AlignmentCounters& counters = AlignmentCounters::Instance();
+        counters.Add(kCounterArenaHeapAllocations, fPool.GetHeapAllocations() - fHeapAllocations);
+        counters.Add(kCounterArenaBytes, fPool.GetBytesServed() - fBytesServed);
+        fPool.ResetAll();
+    }
+
+    RunArenaScope(const RunArenaScope&) = delete;
+    RunArenaScope& operator=(const RunArenaScope&) = delete;
+
+private:
+    RunArenaPool& fPool;
+    uint64_t fHeapAllocations;
+    uint64_t fBytesServed;
+};
+
+#endif // __RunArena__
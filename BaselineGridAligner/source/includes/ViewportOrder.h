@@ -0,0 +1,160 @@
+#ifndef __ViewportOrder__
+#define __ViewportOrder__
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * Processing order by distance from the viewport.
+ *
+ * Story- and document-wide runs handle the spreads the user is looking at
+ * first and the rest in order of distance from them, so the visible part is
+ * correct long before the whole job is done. Distances are counted in
+ * spreads. Items are parcels or stories and cover a range of spreads.
+ */
+
+/**
+ * @struct ViewportRange
+ *
+ * Spreads visible in the front layout window, by spread index.
+ * An unknown viewport (no layout window, another document in front)
+ * leaves every item at the same distance, i.e. in text order.
+ */
+struct ViewportRange {
+    static const int32_t kUnknownSpread = -1;
+
+    int32_t fFirstSpread;
+    int32_t fLastSpread;
+
+    static ViewportRange Unknown() {
+        return ViewportRange{kUnknownSpread, kUnknownSpread};
+    }
+
+    bool IsKnown() const { return fFirstSpread != kUnknownSpread; }
+
+    // Spreads between the viewport and the items' spreads; 0 if any is visible.
+    // Items on an unknown spread go after everything else.
+    int32_t Distance(int32_t firstSpread, int32_t lastSpread) const {
+        if (!IsKnown()) return 0;
+        if (firstSpread == kUnknownSpread) return INT32_MAX;
+        if (lastSpread < fFirstSpread) return fFirstSpread - lastSpread;
+        if (firstSpread > fLastSpread) return firstSpread - fLastSpread;
+        return 0;
+    }
+
+    bool operator==(const ViewportRange& other) const {
+        return fFirstSpread == other.fFirstSpread && fLastSpread == other.fLastSpread;
+    }
+    bool operator!=(const ViewportRange& other) const { return !(*this == other); }
+};
+
+// Item [fBegin, fEnd) of ViewportSchedule::GetOrder() to process next
+struct ViewportWave {
+    size_t fBegin;
+    size_t fEnd;
+    bool fVisible;      // the items lie on visible spreads
+};
+
+/**
+ * @class ViewportSchedule
+ *
+ * Order of items by distance from the viewport, handed out in waves.
+ * The items on visible spreads form the first wave on their own, so the
+ * caller can apply or preview them before going on. Further waves hold
+ * items of increasing distance, at least kMinWaveItems each, so a long
+ * story doesn't pay loop start-up per spread. When the viewport moves
+ * between waves the items not yet handed out are sorted again. Items at
+ * the same distance keep text order.
+ */
+class ViewportSchedule {
+public:
+    static const size_t kMinWaveItems = 256;
+
+    void Reserve(size_t count) {
+        fFirstSpread.reserve(count);
+        fLastSpread.reserve(count);
+    }
+
+    // Items are added in text order
+    void Add(int32_t firstSpread, int32_t lastSpread) {
+        fFirstSpread.push_back(firstSpread);
+        fLastSpread.push_back(lastSpread);
+    }
+
+    size_t GetCount() const { return fFirstSpread.size(); }
+
+    // Index of the n-th item in processing order
+    const int32_t* GetOrder() const { return fOrder.data(); }
+
+    // Next wave for the current viewport; false once every item was handed out
+    bool NextWave(const ViewportRange& viewport, ViewportWave& wave) {
+        Prepare(viewport);
+        if (fNext == fOrder.size()) return false;
+
+        const bool visible = viewport.IsKnown() && DistanceAt(fNext) == 0;
+        size_t end = fNext;
+        while (end < fOrder.size()) {
+            // Take all items at the next distance
+            const int32_t distance = DistanceAt(end);
+            while (end < fOrder.size() && DistanceAt(end) == distance) {
+                end++;
+            }
+            if (visible || end - fNext >= kMinWaveItems) break;
+        }
+
+        wave.fBegin = fNext;
+        wave.fEnd = end;
+        wave.fVisible = visible;
+        fNext = end;
+        return true;
+    }
+
+    // Next single item for the current viewport; false once every item was handed out
+    bool Next(const ViewportRange& viewport, size_t& item) {
+        Prepare(viewport);
+        if (fNext == fOrder.size()) return false;
+
+        item = static_cast<size_t>(fOrder[fNext++]);
+        return true;
+    }
+
+private:
+    // Sort the remaining items when the viewport differs from the one they were sorted for
+    void Prepare(const ViewportRange& viewport) {
+        if (fOrder.size() != fFirstSpread.size()) {
+            fOrder.resize(fFirstSpread.size());
+            for (size_t i = 0; i < fOrder.size(); i++) {
+                fOrder[i] = static_cast<int32_t>(i);
+            }
+            fNext = 0;
+            fSorted = false;
+        }
+        if (fSorted && viewport == fViewport) return;
+
+        fViewport = viewport;
+        fSorted = true;
+        fDistance.resize(fOrder.size());
+        for (size_t n = fNext; n < fOrder.size(); n++) {
+            const int32_t i = fOrder[n];
+            fDistance[i] = viewport.Distance(fFirstSpread[i], fLastSpread[i]);
+        }
+        std::sort(fOrder.begin() + fNext, fOrder.end(), [this](int32_t a, int32_t b) {
+            if (fDistance[a] != fDistance[b]) return fDistance[a] < fDistance[b];
+            return a < b;
+        });
+    }
+
+    int32_t DistanceAt(size_t n) const { return fDistance[fOrder[n]]; }
+
+    std::vector<int32_t> fFirstSpread;
+    std::vector<int32_t> fLastSpread;
+    std::vector<int32_t> fOrder;
+    std::vector<int32_t> fDistance;     // by item, for the viewport last sorted for
+    size_t fNext = 0;
+    bool fSorted = false;
+    ViewportRange fViewport = ViewportRange::Unknown();
+};
+
+#endif // __ViewportOrder__
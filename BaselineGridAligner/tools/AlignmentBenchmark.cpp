@@ -0,0 +1,786 @@
+// End-to-end scaling benchmark of the alignment flow.
+//
+// Generates synthetic stories (parcel counts, style run lengths, font size
+// mix, misalignment rate, grid increments) and runs them through the shared
+// stages of BaselineGridAligner: serial parcel, line and style run reads, the
+// planned parallel compute of AlignmentParallelEngine.h, ordered apply, or with
+// --stories the document pipeline of AlignmentPipeline.h, whose compute stage
+// runs the same planned loops. The InDesign calls are answered by a stand-in
+// host that charges a configurable latency per call, so both compute-bound and
+// host-bound jobs can be measured.
+//
+// Loops take the parallel path whenever more than one thread is allowed, so
+// every mode's rows measure scaling; --adaptive lets ParallelPolicy decide as
+// in the plugin. Prints throughput, speedup over the first row and the threads each
+// run actually planned; --csv writes the same table for plotting. --check
+// instead applies the changes of one run to the story and runs again, and
+// fails if the second run still finds anything to change.
+//
+// Build: ./build-tools.sh
+// Usage: build/AlignmentBenchmark [options], see --help
+
+#include "AlignmentParallelEngine.h"
+#include "AlignmentPipeline.h"
+#include "AlignmentTrace.h"
+#include "ParallelPolicy.h"
+#include "RunArena.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+// Values of BaselineGridAlignmentType (BaselineGridAlignerID.h, which needs the SDK)
+enum BenchmarkMode {
+    kModeBaseline = 0,
+    kModeTracking = 1,
+    kModeWordSpacing = 2,
+    kModeCombined = 3,
+    kModeLines = 4,
+    kModeLeading = 5
+};
+
+const char* const kModeNames[] = { "baseline", "tracking", "wordspacing", "combined", "lines", "leading" };
+
+struct BenchmarkOptions {
+    std::vector<int64_t> fParcelCounts = { 1000, 10000, 100000, 1000000, 10000000 };
+    std::vector<int> fThreadCounts;             // empty: 1, 2, 4, ... up to the hardware
+    int fMode = kModeBaseline;
+    double fMisalignedRate = 0.3;
+    std::vector<double> fGridIncrements = { 12.0, 14.0 };
+    std::vector<double> fFontSizes = { 9.0, 10.0, 11.0, 12.0, 14.0, 18.0 };
+    int32_t fMeanParcelLength = 100;
+    int32_t fMeanRunLength = 400;
+    int32_t fParcelsPerFrame = 40;
+    uint64_t fLatencyNanos = 0;
+    int fStoryCount = 1;                        // more than 1: document pipeline
+    bool fAdaptive = false;                     // let the policy choose serial or parallel
+    int fRepeat = 3;
+    uint32_t fSeed = 1;
+    std::string fCsvPath;
+    bool fCheck = false;                        // apply, run again and expect no changes
+};
+
+// Characters per composed line in lines mode
+const int32_t kCharsPerLine = 60;
+
+/**
+ * A generated story. Parcels are laid out back to back; consecutive parcels
+ * share a frame and so a grid. Offsets and leadings are off the grid at the
+ * configured rate. Composed lines sit at fParcelLineY without the baseline
+ * shift fParcelOffset, like wax lines, and are off the grid at the same rate.
+ */
+struct SyntheticStory {
+    std::vector<int32_t> fParcelStart;
+    std::vector<int32_t> fParcelLength;
+    std::vector<GridFixed> fParcelOffset;
+    std::vector<GridFixed> fParcelLineY;        // unshifted baseline of the parcel's first line
+    std::vector<uint8_t> fParcelGrid;           // index into fGrids
+    std::vector<BaselineGrid> fGrids;
+    std::vector<int32_t> fRunStart;
+    std::vector<int32_t> fRunLength;
+    std::vector<GridFixed> fRunFontSize;
+    std::vector<GridFixed> fRunLeading;
+    std::vector<double> fRunTracking;
+    int32_t fTextLength = 0;
+};
+
+GridFixed OffGrid(GridFixed onGrid, GridFixed increment, bool misaligned, std::mt19937& rng)
+{
+    if (!misaligned) return onGrid;
+    return onGrid + 1 + static_cast<GridFixed>(rng() % static_cast<uint32_t>(increment - 1));
+}
+
+SyntheticStory GenerateStory(int64_t parcelCount, const BenchmarkOptions& options, std::mt19937& rng)
+{
+    SyntheticStory story;
+    for (double increment : options.fGridIncrements) {
+        story.fGrids.push_back(BaselineGrid{ToGridFixed(increment), 0});
+    }
+
+    std::bernoulli_distribution misaligned(options.fMisalignedRate);
+    std::uniform_int_distribution<int32_t> parcelLength(std::max(1, options.fMeanParcelLength / 5),
+                                                        options.fMeanParcelLength * 9 / 5);
+
+    story.fParcelStart.reserve(parcelCount);
+    story.fParcelLength.reserve(parcelCount);
+    story.fParcelOffset.reserve(parcelCount);
+    story.fParcelLineY.reserve(parcelCount);
+    story.fParcelGrid.reserve(parcelCount);
+
+    int64_t position = 0;
+    for (int64_t p = 0; p < parcelCount; p++) {
+        const uint8_t grid = static_cast<uint8_t>((p / options.fParcelsPerFrame) % story.fGrids.size());
+        const GridFixed increment = story.fGrids[grid].fIncrement;
+        const int32_t length = parcelLength(rng);
+        const GridFixed onGrid = increment * static_cast<GridFixed>(rng() % 5);
+
+        story.fParcelStart.push_back(static_cast<int32_t>(position));
+        story.fParcelLength.push_back(length);
+        story.fParcelOffset.push_back(OffGrid(onGrid, increment, misaligned(rng), rng));
+        story.fParcelLineY.push_back(OffGrid(increment * (1 + p % 40), increment, misaligned(rng), rng) +
+                                     story.fParcelOffset.back());
+        story.fParcelGrid.push_back(grid);
+        position += length;
+
+        // Text positions are 32-bit in the SDK
+        if (position > INT32_MAX - options.fMeanParcelLength * 2) {
+            fprintf(stderr, "Story truncated to %lld parcels to fit 32-bit text positions\n",
+                    static_cast<long long>(p + 1));
+            break;
+        }
+    }
+    story.fTextLength = static_cast<int32_t>(position);
+
+    // Style runs with geometric lengths, a font size from the mix each
+    std::geometric_distribution<int32_t> runLength(1.0 / std::max(1, options.fMeanRunLength));
+    std::uniform_int_distribution<size_t> fontSize(0, options.fFontSizes.size() - 1);
+    for (int64_t start = 0; start < position; ) {
+        const int32_t length = static_cast<int32_t>(std::min<int64_t>(1 + runLength(rng), position - start));
+        const GridFixed size = ToGridFixed(options.fFontSizes[fontSize(rng)]);
+        const GridFixed increment = story.fGrids[0].fIncrement;
+        const GridFixed onGridLeading = SnapLeadingToGrid(ResolveAutoLeading(size, kDefaultAutoLeadingPercent), increment, 0);
+
+        story.fRunStart.push_back(static_cast<int32_t>(start));
+        story.fRunLength.push_back(length);
+        story.fRunFontSize.push_back(size);
+        story.fRunLeading.push_back(OffGrid(onGridLeading, increment, misaligned(rng), rng));
+        story.fRunTracking.push_back(static_cast<double>(static_cast<int>(rng() % 41) - 20));
+        start += length;
+    }
+    return story;
+}
+
+// Busy-wait, so latency doesn't let the thread sleep and hide contention
+void Spin(uint64_t nanos)
+{
+    if (nanos == 0) return;
+
+    const auto end = std::chrono::steady_clock::now() + std::chrono::nanoseconds(nanos);
+    while (std::chrono::steady_clock::now() < end) {
+    }
+}
+
+/**
+ * @class StandInHost
+ *
+ * Answers the calls the aligner makes to InDesign from a synthetic story.
+ * Every call that goes to the document costs the configured latency; the
+ * progress bar is a mutex like the one guarding the real progress bar.
+ * A writable host also stores the baseline offsets it is given.
+ */
+class StandInHost {
+public:
+    StandInHost(SyntheticStory& story, uint64_t latencyNanos, bool writable = false)
+        : fStory(story),
+          fLatencyNanos(latencyNanos),
+          fWritable(writable),
+          fCalls(0)
+    {
+    }
+
+    BaselineGrid GetDocumentGrid() {
+        Call();
+        return fStory.fGrids[0];
+    }
+
+    int32_t GetParcelCount() const { return static_cast<int32_t>(fStory.fParcelStart.size()); }
+
+    void GetParcelRange(int32_t parcel, int32_t* start, int32_t* end) {
+        Call();
+        *start = fStory.fParcelStart[parcel];
+        *end = fStory.fParcelStart[parcel] + fStory.fParcelLength[parcel];
+    }
+
+    BaselineGrid GetParcelGrid(int32_t parcel) {
+        return fStory.fGrids[fStory.fParcelGrid[parcel]];
+    }
+
+    GridFixed GetBaselineOffset(int32_t parcel) {
+        Call();
+        return fStory.fParcelOffset[parcel];
+    }
+
+    // Parcel holding a text position, by binary search like the parcel list
+    int32_t GetParcelContaining(int32_t index) const {
+        const auto it = std::upper_bound(fStory.fParcelStart.begin(), fStory.fParcelStart.end(), index);
+        return static_cast<int32_t>(it - fStory.fParcelStart.begin()) - 1;
+    }
+
+    GridFixed GetBaselineOffsetAt(int32_t index) {
+        return GetBaselineOffset(std::max(0, GetParcelContaining(index)));
+    }
+    
+    GridFixed GetLineY(int32_t parcel) const {
+        return fStory.fParcelLineY[parcel];
+    }
+
+    int32_t GetStyleRunCount() const { return static_cast<int32_t>(fStory.fRunStart.size()); }
+
+    // Run length lookup on the attribute strand
+    void GetStyleRunRange(int32_t run, int32_t* start, int32_t* length) {
+        Call();
+        *start = fStory.fRunStart[run];
+        *length = fStory.fRunLength[run];
+    }
+
+    void QueryStyleRun(int32_t run, StyleRunSnapshot& snapshot) {
+        Call();
+        snapshot.fFontSize = fStory.fRunFontSize[run];
+        snapshot.fTracking = fStory.fRunTracking[run];
+        snapshot.fWordSpacing = 0.0;
+        snapshot.fBaseTracking = snapshot.fTracking;
+        snapshot.fBaseWordSpacing = snapshot.fWordSpacing;
+        snapshot.fLeading = fStory.fRunLeading[run];
+    }
+
+    bool WasCancelled() const { return false; }
+
+    void SetProgress(float progress) {
+        std::lock_guard<std::mutex> lock(fProgressLock);
+        fProgress = progress;
+    }
+
+    void ApplyCommand() {
+        Call();
+    }
+    
+    // The baseline offset command, on the parcel holding the text position
+    void ApplyBaselineOffset(int32_t index, GridFixed offset) {
+        Call();
+        if (fWritable) {
+            fStory.fParcelOffset[std::max(0, GetParcelContaining(index))] = offset;
+        }
+    }
+
+    uint64_t GetCallCount() const { return fCalls.load(std::memory_order_relaxed); }
+
+private:
+    void Call() {
+        fCalls.fetch_add(1, std::memory_order_relaxed);
+        Spin(fLatencyNanos);
+    }
+
+    SyntheticStory& fStory;
+    const uint64_t fLatencyNanos;
+    const bool fWritable;
+    std::atomic<uint64_t> fCalls;
+    std::mutex fProgressLock;
+    float fProgress = 0.0f;
+};
+
+// Pipeline depth of AlignDocumentToBaselineGrid (BaselineGridAligner.cpp)
+const size_t kPipelineDepth = 2;
+
+// One story read by the snapshot stage, like the aligner's StorySnapshot, in the story's arena
+struct BenchmarkSnapshot {
+    explicit BenchmarkSnapshot(RunArena* arena = nullptr)
+        : fArena(arena),
+          fParcels(ArenaAllocator<ParcelOffset>(arena)),
+          fLines(arena),
+          fLineGrids(ArenaAllocator<BaselineGrid>(arena)),
+          fRuns(ArenaAllocator<StyleRunSnapshot>(arena))
+    {
+    }
+
+    RunArena* fArena;
+    ArenaVector<ParcelOffset> fParcels;
+    BaselineLineMetrics fLines;
+    ArenaVector<BaselineGrid> fLineGrids;
+    ArenaVector<StyleRunSnapshot> fRuns;
+};
+
+// What the compute stage found for one story, like the aligner's StoryChanges
+struct BenchmarkChanges {
+    explicit BenchmarkChanges(RunArena* arena = nullptr)
+        : fBaseline(ArenaAllocator<BaselineCorrection>(arena)),
+          fVerified(ArenaAllocator<ParcelOffset>(arena)),
+          fRuns(ArenaAllocator<StyleRunSnapshot>(arena)),
+          fRunCorrections(ArenaAllocator<StyleRunCorrection>(arena))
+    {
+    }
+
+    ArenaVector<BaselineCorrection> fBaseline;
+    ArenaVector<ParcelOffset> fVerified;
+    ArenaVector<StyleRunSnapshot> fRuns;
+    ArenaVector<StyleRunCorrection> fRunCorrections;
+};
+
+/**
+ * Drives the aligner's shared stages against the host: the selection flow of
+ * AlignTextToBaselineGrid (serial read, planned parallel compute, ordered apply)
+ * or, with more than one story, the document pipeline of
+ * AlignDocumentToBaselineGrid through RunAlignmentPipeline. Only the reads and
+ * writes are the benchmark's own, as the plugin's need the SDK; every
+ * computation goes through the entry points the plugin calls.
+ * Policies and arenas persist across runs like the aligner's members.
+ */
+class BenchmarkAligner {
+public:
+    BenchmarkAligner(int threadLimit, bool forceParallel)
+        : fPlanThreads(1),
+          fPlanParallel(false)
+    {
+        fPolicy.SetThreadLimit(threadLimit);
+        fPolicy.SetForceParallel(forceParallel);
+    }
+
+    // Returns the number of changes applied
+    size_t Align(StandInHost& host, int mode, int storyCount) {
+        RunArenaScope arenaScope(fArenas);
+        fPlanThreads = 1;
+        fPlanParallel = false;
+
+        // The grid fetch; parcels carry their frame's grid
+        host.GetDocumentGrid();
+
+        if (storyCount > 1) {
+            return AlignDocument(host, mode, storyCount);
+        }
+
+        switch (mode) {
+            case kModeBaseline: return AlignBaseline(host);
+            case kModeLines: return AlignLines(host);
+            case kModeTracking: return AlignStyleRuns<TrackingStrategy>(host);
+            case kModeWordSpacing: return AlignStyleRuns<WordSpacingStrategy>(host);
+            case kModeCombined: return AlignStyleRuns<CombinedStrategy>(host);
+            case kModeLeading: return AlignStyleRuns<LeadingStrategy>(host);
+        }
+        return 0;
+    }
+
+    // Threads and path of the widest loop the last run actually planned
+    int GetPlanThreads() const { return fPlanThreads; }
+    bool WasPlanParallel() const { return fPlanParallel; }
+
+private:
+    // Mirrors CollectParcelsInRange: offsets and grids are read serially, before any parallel loop
+    static void ReadParcels(StandInHost& host, int32_t first, int32_t last, ArenaVector<ParcelOffset>& parcels) {
+        parcels.reserve(parcels.size() + (last - first));
+        for (int32_t p = first; p < last; p++) {
+            int32_t start, end;
+            host.GetParcelRange(p, &start, &end);
+            parcels.push_back(ParcelOffset{start, end - start, host.GetBaselineOffset(p), host.GetParcelGrid(p)});
+        }
+    }
+
+    // Mirrors QueryLineMetrics: unshifted line baselines, with the shift of their parcel next to them
+    static void ReadLines(StandInHost& host, int32_t first, int32_t last,
+                          BaselineLineMetrics& lines, ArenaVector<BaselineGrid>& lineGrids) {
+        for (int32_t p = first; p < last; p++) {
+            int32_t start, end;
+            host.GetParcelRange(p, &start, &end);
+            const BaselineGrid grid = host.GetParcelGrid(p);
+            const GridFixed shift = host.GetBaselineOffset(p);
+
+            GridFixed y = host.GetLineY(p);
+            for (int32_t index = start; index < end; index += kCharsPerLine) {
+                lines.Append(index, std::min(kCharsPerLine, end - index), y, grid.fIncrement, shift);
+                lineGrids.push_back(grid);
+                y += grid.fIncrement;
+            }
+        }
+    }
+
+    // Mirrors CollectStyleRuns + QueryStyleRunAttributes, both on the calling thread
+    static void ReadStyleRuns(StandInHost& host, int32_t first, int32_t last, ArenaVector<StyleRunSnapshot>& runs) {
+        runs.reserve(runs.size() + (last - first));
+        for (int32_t r = first; r < last; r++) {
+            StyleRunSnapshot run = StyleRunSnapshot();
+            host.GetStyleRunRange(r, &run.fStart, &run.fLength);
+            run.fGridIncrement = host.GetParcelGrid(std::max(0, host.GetParcelContaining(run.fStart))).fIncrement;
+            host.QueryStyleRun(r, run);
+            runs.push_back(run);
+        }
+    }
+
+    static size_t ApplyCommands(StandInHost& host, size_t count) {
+        for (size_t i = 0; i < count; i++) {
+            host.ApplyCommand();
+        }
+        return count;
+    }
+
+    // Mirrors ApplyBaselineCorrections
+    static size_t ApplyBaselineCorrections(StandInHost& host, const ArenaVector<BaselineCorrection>& corrections) {
+        for (const BaselineCorrection& correction : corrections) {
+            host.ApplyBaselineOffset(correction.fStart, correction.fOffset);
+        }
+        return corrections.size();
+    }
+
+    void NotePlan(const ParallelPlan& plan) {
+        fPlanThreads = std::max(fPlanThreads, plan.fThreadCount);
+        fPlanParallel = fPlanParallel || plan.fParallel;
+    }
+
+    // Mirrors CollectBaselineChanges: serial read with cancel and progress checks,
+    // planned compute, ordered apply
+    size_t AlignBaseline(StandInHost& host) {
+        const int32_t parcelCount = host.GetParcelCount();
+        ArenaVector<ParcelOffset> parcels(ArenaAllocator<ParcelOffset>(&fArenas.Main()));
+        ReadParcels(host, 0, parcelCount, parcels);
+        for (int32_t i = 0; i < parcelCount; i++) {
+            if (host.WasCancelled()) return 0;
+            host.SetProgress(static_cast<float>(i) / parcelCount);
+        }
+
+        ArenaVector<BaselineCorrection> corrections(ArenaAllocator<BaselineCorrection>(&fArenas.Main()));
+        ArenaVector<ParcelOffset> verified(ArenaAllocator<ParcelOffset>(&fArenas.Main()));
+        NotePlan(ComputeParcelCorrectionsPlanned(fPolicy, parcels.data(), parcels.size(), &fArenas.Main(),
+                                                 corrections, verified));
+        return ApplyBaselineCorrections(host, corrections);
+    }
+
+    // Mirrors CollectLineChanges: serial wax read, planned compute
+    size_t AlignLines(StandInHost& host) {
+        BaselineLineMetrics lines(&fArenas.Main());
+        ArenaVector<BaselineGrid> lineGrids(ArenaAllocator<BaselineGrid>(&fArenas.Main()));
+        ReadLines(host, 0, host.GetParcelCount(), lines, lineGrids);
+
+        ArenaVector<BaselineCorrection> corrections(ArenaAllocator<BaselineCorrection>(&fArenas.Main()));
+        NotePlan(FindOffGridLinesPlanned(fPolicy, lines, lineGrids, &fArenas.Main(), corrections));
+        return ApplyBaselineCorrections(host, corrections);
+    }
+
+    // Mirrors CollectStyleRunChanges + ApplyStyleRunChanges
+    template <class Strategy>
+    size_t AlignStyleRuns(StandInHost& host) {
+        ArenaVector<StyleRunSnapshot> runs(ArenaAllocator<StyleRunSnapshot>(&fArenas.Main()));
+        ReadStyleRuns(host, 0, host.GetStyleRunCount(), runs);
+
+        ArenaVector<StyleRunSnapshot> changedRuns(ArenaAllocator<StyleRunSnapshot>(&fArenas.Main()));
+        ArenaVector<StyleRunCorrection> changedCorrections(ArenaAllocator<StyleRunCorrection>(&fArenas.Main()));
+        NotePlan(ComputeStyleRunChangesPlanned<Strategy>(fPolicy, runs.data(), runs.size(), GetStyleRunParameters(),
+                                                         fScaleCache, &fArenas.Main(),
+                                                         changedRuns, changedCorrections));
+        return ApplyCommands(host, changedRuns.size());
+    }
+
+    // Mirrors AlignDocumentToBaselineGrid: the story is cut into storyCount stories of
+    // consecutive parcels and runs, read and applied on this thread, computed on the
+    // worker by the same planned loops as the selection flow, each story in its own arena
+    size_t AlignDocument(StandInHost& host, int mode, int storyCount) {
+        const int32_t parcelCount = host.GetParcelCount();
+        const int32_t runCount = host.GetStyleRunCount();
+        const StyleRunParameters parameters = GetStyleRunParameters();
+        size_t changes = 0;
+
+        fArenas.ResizeItems(PipelineItemsInFlight(kPipelineDepth));
+        RunAlignmentPipeline<BenchmarkSnapshot, BenchmarkChanges>(
+            static_cast<size_t>(storyCount), kPipelineDepth,
+            [this, &host, mode, storyCount, parcelCount, runCount](size_t item) {
+                BenchmarkSnapshot snapshot(&fArenas.ForItem(item));
+                const int64_t s = static_cast<int64_t>(item);
+                if (mode == kModeBaseline) {
+                    ReadParcels(host, static_cast<int32_t>(parcelCount * s / storyCount),
+                                static_cast<int32_t>(parcelCount * (s + 1) / storyCount), snapshot.fParcels);
+                }
+                else if (mode == kModeLines) {
+                    ReadLines(host, static_cast<int32_t>(parcelCount * s / storyCount),
+                              static_cast<int32_t>(parcelCount * (s + 1) / storyCount),
+                              snapshot.fLines, snapshot.fLineGrids);
+                }
+                else {
+                    ReadStyleRuns(host, static_cast<int32_t>(runCount * s / storyCount),
+                                  static_cast<int32_t>(runCount * (s + 1) / storyCount), snapshot.fRuns);
+                }
+                return snapshot;
+            },
+            [this, mode, &parameters](BenchmarkSnapshot&& snapshot) {
+                BenchmarkChanges result(snapshot.fArena);
+                switch (mode) {
+                    case kModeBaseline:
+                        NotePlan(ComputeParcelCorrectionsPlanned(fPolicy, snapshot.fParcels.data(),
+                                                                 snapshot.fParcels.size(), snapshot.fArena,
+                                                                 result.fBaseline, result.fVerified));
+                        break;
+                    case kModeLines:
+                        NotePlan(FindOffGridLinesPlanned(fPolicy, snapshot.fLines, snapshot.fLineGrids,
+                                                         snapshot.fArena, result.fBaseline));
+                        break;
+                    case kModeTracking: ComputeStoryStyleRuns<TrackingStrategy>(snapshot, parameters, result); break;
+                    case kModeWordSpacing: ComputeStoryStyleRuns<WordSpacingStrategy>(snapshot, parameters, result); break;
+                    case kModeCombined: ComputeStoryStyleRuns<CombinedStrategy>(snapshot, parameters, result); break;
+                    case kModeLeading: ComputeStoryStyleRuns<LeadingStrategy>(snapshot, parameters, result); break;
+                }
+                return result;
+            },
+            [&host, &changes](BenchmarkChanges& result) {
+                changes += ApplyBaselineCorrections(host, result.fBaseline);
+                changes += ApplyCommands(host, result.fRuns.size());
+            });
+        return changes;
+    }
+
+    template <class Strategy>
+    void ComputeStoryStyleRuns(const BenchmarkSnapshot& snapshot, const StyleRunParameters& parameters,
+                               BenchmarkChanges& result) {
+        NotePlan(ComputeStyleRunChangesPlanned<Strategy>(fPolicy, snapshot.fRuns.data(), snapshot.fRuns.size(),
+                                                         parameters, fScaleCache, snapshot.fArena,
+                                                         result.fRuns, result.fRunCorrections));
+    }
+
+    static StyleRunParameters GetStyleRunParameters() {
+        StyleRunParameters parameters;
+        parameters.fWordSpacingFactor = 1.0;
+        parameters.fLeadingMultiple = 0;
+        return parameters;
+    }
+
+    ParallelPolicy fPolicy;
+    RunArenaPool fArenas;
+    BaselineGridScaleCache fScaleCache;
+    int fPlanThreads;
+    bool fPlanParallel;
+};
+
+struct BenchmarkPoint {
+    int64_t fParcels;
+    int fThreads;                               // thread limit of the row
+    int fPlanThreads;                           // threads the run actually planned
+    const char* fPath;                          // serial, parallel or pipeline
+    double fMillis;
+    double fParcelsPerSecond;
+    double fSpeedup;
+    size_t fChanges;
+    uint64_t fHostCalls;
+};
+
+std::vector<int64_t> ParseCounts(const char* text)
+{
+    std::vector<int64_t> values;
+    for (const char* p = text; *p; ) {
+        char* end;
+        double value = strtod(p, &end);
+        if (end == p) break;
+        if (*end == 'k' || *end == 'K') { value *= 1e3; end++; }
+        else if (*end == 'm' || *end == 'M') { value *= 1e6; end++; }
+        values.push_back(static_cast<int64_t>(value));
+        p = *end == ',' ? end + 1 : end;
+    }
+    return values;
+}
+
+std::vector<double> ParseReals(const char* text)
+{
+    std::vector<double> values;
+    for (const char* p = text; *p; ) {
+        char* end;
+        const double value = strtod(p, &end);
+        if (end == p) break;
+        values.push_back(value);
+        p = *end == ',' ? end + 1 : end;
+    }
+    return values;
+}
+
+void PrintUsage()
+{
+    fprintf(stderr,
+        "Usage: AlignmentBenchmark [options]\n"
+        "  --mode M            baseline, tracking, wordspacing, combined, lines, leading (baseline)\n"
+        "  --parcels LIST      story sizes, e.g. 1k,100k,10M (1k,10k,100k,1M,10M)\n"
+        "  --threads LIST      thread counts (1, 2, 4, ... up to the hardware)\n"
+        "  --latency NS        host latency per call in nanoseconds (0)\n"
+        "  --stories N         cut the text into N stories and run the document pipeline (1)\n"
+        "  --adaptive          let the policy choose serial or parallel loops as in the plugin\n"
+        "  --misaligned RATE   share of parcels and runs off the grid (0.3)\n"
+        "  --grids LIST        grid increments in pt, one per frame in turn (12,14)\n"
+        "  --fonts LIST        font size mix in pt (9,10,11,12,14,18)\n"
+        "  --parcel-length N   mean parcel length in characters (100)\n"
+        "  --run-length N      mean style run length in characters (400)\n"
+        "  --frame-parcels N   parcels per frame (40)\n"
+        "  --repeat N          timed runs per point, best is reported (3)\n"
+        "  --seed N            random seed (1)\n"
+        "  --csv PATH          also write the results as CSV\n"
+        "  --check             baseline and lines: apply one run, run again and fail on any change\n");
+}
+
+bool ParseOptions(int argc, char** argv, BenchmarkOptions& options)
+{
+    for (int i = 1; i < argc; i++) {
+        const char* name = argv[i];
+        if (strcmp(name, "--adaptive") == 0) {
+            options.fAdaptive = true;
+            continue;
+        }
+        if (strcmp(name, "--check") == 0) {
+            options.fCheck = true;
+            continue;
+        }
+        if (strcmp(name, "--help") == 0 || i + 1 >= argc) return false;
+        const char* value = argv[++i];
+
+        if (strcmp(name, "--mode") == 0) {
+            options.fMode = -1;
+            for (int m = 0; m < 6; m++) {
+                if (strcmp(value, kModeNames[m]) == 0) options.fMode = m;
+            }
+            if (options.fMode < 0) return false;
+        }
+        else if (strcmp(name, "--parcels") == 0) options.fParcelCounts = ParseCounts(value);
+        else if (strcmp(name, "--threads") == 0) {
+            options.fThreadCounts.clear();
+            for (int64_t count : ParseCounts(value)) {
+                options.fThreadCounts.push_back(static_cast<int>(count));
+            }
+        }
+        else if (strcmp(name, "--latency") == 0) options.fLatencyNanos = strtoull(value, nullptr, 10);
+        else if (strcmp(name, "--stories") == 0) options.fStoryCount = std::max(1, atoi(value));
+        else if (strcmp(name, "--misaligned") == 0) options.fMisalignedRate = atof(value);
+        else if (strcmp(name, "--grids") == 0) options.fGridIncrements = ParseReals(value);
+        else if (strcmp(name, "--fonts") == 0) options.fFontSizes = ParseReals(value);
+        else if (strcmp(name, "--parcel-length") == 0) options.fMeanParcelLength = std::max(1, atoi(value));
+        else if (strcmp(name, "--run-length") == 0) options.fMeanRunLength = std::max(1, atoi(value));
+        else if (strcmp(name, "--frame-parcels") == 0) options.fParcelsPerFrame = std::max(1, atoi(value));
+        else if (strcmp(name, "--repeat") == 0) options.fRepeat = std::max(1, atoi(value));
+        else if (strcmp(name, "--seed") == 0) options.fSeed = static_cast<uint32_t>(strtoul(value, nullptr, 10));
+        else if (strcmp(name, "--csv") == 0) options.fCsvPath = value;
+        else return false;
+    }
+
+    if (options.fThreadCounts.empty()) {
+        const int maxThreads = ParallelPolicy::GetMaxThreads();
+        for (int threads = 1; threads < maxThreads; threads *= 2) {
+            options.fThreadCounts.push_back(threads);
+        }
+        options.fThreadCounts.push_back(maxThreads);
+    }
+
+    // A grid increment must hold at least a few fixed-point steps; at most 256 frames' grids
+    options.fGridIncrements.erase(std::remove_if(options.fGridIncrements.begin(), options.fGridIncrements.end(),
+                                                 [](double increment) { return increment < 0.5; }),
+                                  options.fGridIncrements.end());
+    if (options.fGridIncrements.size() > 256) options.fGridIncrements.resize(256);
+    if (options.fCheck && options.fMode != kModeBaseline && options.fMode != kModeLines) return false;
+    return !options.fParcelCounts.empty() && !options.fGridIncrements.empty() && !options.fFontSizes.empty();
+}
+
+// Applies one run to a copy of each story and runs again; a second run that
+// still changes something means the mode doesn't converge. Returns the exit code.
+int RunCheck(const BenchmarkOptions& options)
+{
+    int result = 0;
+    for (int64_t parcelCount : options.fParcelCounts) {
+        std::mt19937 rng(options.fSeed);
+        SyntheticStory story = GenerateStory(parcelCount, options, rng);
+
+        BenchmarkAligner aligner(options.fThreadCounts.back(), !options.fAdaptive);
+        StandInHost host(story, options.fLatencyNanos, true);
+        const size_t firstChanges = aligner.Align(host, options.fMode, options.fStoryCount);
+        const size_t secondChanges = aligner.Align(host, options.fMode, options.fStoryCount);
+
+        const bool converged = secondChanges == 0;
+        printf("%10lld parcels: %zu changes, then %zu: %s\n",
+               static_cast<long long>(story.fParcelStart.size()), firstChanges, secondChanges,
+               converged ? "ok" : "FAILED");
+        if (!converged) result = 1;
+    }
+    return result;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    BenchmarkOptions options;
+    if (!ParseOptions(argc, argv, options)) {
+        PrintUsage();
+        return 2;
+    }
+
+    // Spans of the worker loops are not needed and would only cost time
+    AlignmentTrace::SetEnabled(false);
+
+    if (options.fCheck) {
+        printf("Check %s, %d %s\n", kModeNames[options.fMode], options.fStoryCount,
+               options.fStoryCount > 1 ? "stories" : "story");
+        return RunCheck(options);
+    }
+
+    printf("Mode %s, host latency %llu ns, %.0f %% misaligned, up to %d threads, %d %s, %s loops\n\n",
+           kModeNames[options.fMode], static_cast<unsigned long long>(options.fLatencyNanos),
+           options.fMisalignedRate * 100.0, options.fThreadCounts.back(),
+           options.fStoryCount, options.fStoryCount > 1 ? "stories" : "story",
+           options.fAdaptive ? "adaptive" : "forced parallel");
+    printf("%10s %8s %8s %9s %12s %14s %8s %10s %12s\n",
+           "parcels", "threads", "planned", "path", "best ms", "parcels/s", "speedup", "changes", "host calls");
+
+    std::vector<BenchmarkPoint> points;
+    for (int64_t parcelCount : options.fParcelCounts) {
+        std::mt19937 rng(options.fSeed);
+        SyntheticStory story = GenerateStory(parcelCount, options, rng);
+        const int64_t parcels = static_cast<int64_t>(story.fParcelStart.size());
+
+        double serialMillis = 0.0;
+        for (int threads : options.fThreadCounts) {
+            // One aligner per point, warmed up once so the policy has measured the cost
+            BenchmarkAligner aligner(threads, !options.fAdaptive);
+            StandInHost warmUpHost(story, options.fLatencyNanos);
+            aligner.Align(warmUpHost, options.fMode, options.fStoryCount);
+
+            double bestMillis = 0.0;
+            size_t changes = 0;
+            uint64_t hostCalls = 0;
+            for (int run = 0; run < options.fRepeat; run++) {
+                StandInHost host(story, options.fLatencyNanos);
+                const auto start = std::chrono::steady_clock::now();
+                changes = aligner.Align(host, options.fMode, options.fStoryCount);
+                const double millis = std::chrono::duration<double, std::milli>(
+                    std::chrono::steady_clock::now() - start).count();
+                if (run == 0 || millis < bestMillis) bestMillis = millis;
+                hostCalls = host.GetCallCount();
+            }
+
+            if (serialMillis == 0.0) serialMillis = bestMillis;
+
+            BenchmarkPoint point;
+            point.fParcels = parcels;
+            point.fThreads = threads;
+            point.fPlanThreads = aligner.GetPlanThreads();
+            point.fPath = options.fStoryCount > 1 ? "pipeline" : aligner.WasPlanParallel() ? "parallel" : "serial";
+            point.fMillis = bestMillis;
+            point.fParcelsPerSecond = bestMillis > 0.0 ? parcels * 1000.0 / bestMillis : 0.0;
+            point.fSpeedup = bestMillis > 0.0 ? serialMillis / bestMillis : 0.0;
+            point.fChanges = changes;
+            point.fHostCalls = hostCalls;
+            points.push_back(point);
+
+            printf("%10lld %8d %8d %9s %12.3f %14.0f %7.2fx %10zu %12llu\n",
+                   static_cast<long long>(point.fParcels), point.fThreads, point.fPlanThreads, point.fPath,
+                   point.fMillis,
+                   point.fParcelsPerSecond, point.fSpeedup, point.fChanges,
+                   static_cast<unsigned long long>(point.fHostCalls));
+            fflush(stdout);
+        }
+    }
+
+    if (!options.fCsvPath.empty()) {
+        FILE* file = fopen(options.fCsvPath.c_str(), "w");
+        if (!file) {
+            fprintf(stderr, "Cannot write %s\n", options.fCsvPath.c_str());
+            return 1;
+        }
+        fprintf(file, "mode,latency_ns,stories,parcels,threads,planned_threads,path,best_ms,parcels_per_s,"
+                      "speedup,changes,host_calls\n");
+        for (const BenchmarkPoint& point : points) {
+            fprintf(file, "%s,%llu,%d,%lld,%d,%d,%s,%.3f,%.0f,%.3f,%zu,%llu\n",
+                    kModeNames[options.fMode], static_cast<unsigned long long>(options.fLatencyNanos),
+                    options.fStoryCount, static_cast<long long>(point.fParcels), point.fThreads,
+                    point.fPlanThreads, point.fPath, point.fMillis,
+                    point.fParcelsPerSecond, point.fSpeedup, point.fChanges,
+                    static_cast<unsigned long long>(point.fHostCalls));
+        }
+        fclose(file);
+    }
+    return 0;
+}
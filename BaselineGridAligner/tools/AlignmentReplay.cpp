@@ -0,0 +1,276 @@
+// Offline replay of recorded alignment sessions.
+//
+// Reads a recording written by BaselineGridAligner::StartRecording() and runs
+// the alignment engine against its snapshots, with no InDesign needed. Every
+// result is compared with the checksum recorded by the plugin, so the tool
+// reproduces customer sessions and serves as a regression check; with
+// --repeat it times the compute stage over a real workload.
+//
+// Build: ./build-tools.sh
+// Usage: build/AlignmentReplay <recording.bgar> [--repeat N] [--verbose]
+
+#include "AlignmentEngine.h"
+#include "AlignmentRecorder.h"
+#include "AlignmentTrace.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <string>
+#include <vector>
+
+namespace {
+
+// Values of BaselineGridAlignmentType (BaselineGridAlignerID.h, which needs the SDK)
+enum ReplayAlignmentType {
+    kReplayBaseline = 0,
+    kReplayTracking = 1,
+    kReplayWordSpacing = 2,
+    kReplayCombined = 3,
+    kReplayLines = 4,
+    kReplayLeading = 5
+};
+
+struct ReplayResult {
+    uint64_t fChangeCount;
+    uint64_t fChecksum;
+};
+
+struct ReplayStats {
+    uint64_t fRuns = 0;
+    uint64_t fNotifications[5] = {0, 0, 0, 0, 0};
+    uint64_t fSnapshots = 0;
+    uint64_t fItems = 0;
+    uint64_t fChanges = 0;
+    uint64_t fMatched = 0;
+    uint64_t fMismatched = 0;
+    uint64_t fRecordedMicros = 0;
+};
+
+const char* RunKindName(int32_t kind)
+{
+    switch (kind) {
+        case kRecordedRunSelection: return "selection";
+        case kRecordedRunPreview: return "preview";
+        case kRecordedRunDocument: return "document";
+        default: return "unknown";
+    }
+}
+
+template <class Strategy>
+ReplayResult ReplayStyleRuns(const RecordedEvent& event, const RecordedSettings& settings,
+                             BaselineGridScaleCache& scaleCache)
+{
+    StyleRunParameters parameters;
+    parameters.fWordSpacingFactor = settings.fWordSpacingFactor;
+    parameters.fLeadingMultiple = settings.fLeadingMultiple;
+
+    ArenaVector<StyleRunSnapshot> runs;
+    ArenaVector<StyleRunCorrection> corrections;
+    ComputeStyleRunChanges<Strategy>(event.fRuns.data(), event.fRuns.size(), parameters,
+                                     scaleCache, nullptr, runs, corrections);
+    return ReplayResult{runs.size(), ChecksumStyleRunChanges(runs.data(), corrections.data(), runs.size())};
+}
+
+// Run the engine on one snapshot exactly as the plugin did
+ReplayResult ReplaySnapshot(const RecordedEvent& event, const RecordedSettings& settings,
+                            BaselineGridScaleCache& scaleCache)
+{
+    ArenaVector<BaselineCorrection> corrections;
+
+    switch (event.fType) {
+        case kRecordParcels: {
+            ArenaVector<ParcelOffset> verified;
+            ComputeParcelCorrections(event.fParcels.data(), event.fParcels.size(), corrections, verified);
+            break;
+        }
+        case kRecordLines:
+            FindOffGridLines(event.fLines, event.fLineGrids, nullptr, corrections);
+            break;
+        case kRecordStyleRuns:
+            switch (settings.fAlignmentType) {
+                case kReplayTracking:
+                    return ReplayStyleRuns<TrackingStrategy>(event, settings, scaleCache);
+                case kReplayWordSpacing:
+                    return ReplayStyleRuns<WordSpacingStrategy>(event, settings, scaleCache);
+                case kReplayCombined:
+                    return ReplayStyleRuns<CombinedStrategy>(event, settings, scaleCache);
+                case kReplayLeading:
+                    return ReplayStyleRuns<LeadingStrategy>(event, settings, scaleCache);
+                default:
+                    break;
+            }
+            break;
+        default:
+            break;
+    }
+    return ReplayResult{corrections.size(), ChecksumCorrections(corrections.data(), corrections.size())};
+}
+
+size_t SnapshotItemCount(const RecordedEvent& event)
+{
+    switch (event.fType) {
+        case kRecordParcels: return event.fParcels.size();
+        case kRecordLines: return event.fLines.Size();
+        case kRecordStyleRuns: return event.fRuns.size();
+        default: return 0;
+    }
+}
+
+// One pass over all events; checks results only when stats is given
+uint64_t ReplayPass(const std::vector<RecordedEvent>& events, ReplayStats* stats, bool verbose)
+{
+    RecordedSettings settings = RecordedSettings();
+    BaselineGridScaleCache scaleCache;
+    std::deque<ReplayResult> pending;
+    uint64_t computeMicros = 0;
+
+    for (const RecordedEvent& event : events) {
+        switch (event.fType) {
+            case kRecordNotification:
+                if (stats && event.fKind >= 1 && event.fKind <= kRecordedStyleChanged) {
+                    stats->fNotifications[event.fKind]++;
+                }
+                break;
+
+            case kRecordRunBegin:
+                // Results of an interrupted run are never recorded
+                settings = event.fSettings;
+                pending.clear();
+                if (stats) {
+                    stats->fRuns++;
+                }
+                if (stats && verbose) {
+                    printf("%10.3f ms  run %s, mode %d, grid %.3f/%.3f pt\n",
+                           event.fTimeMicros / 1000.0, RunKindName(event.fKind), settings.fAlignmentType,
+                           FromGridFixed(event.fDocumentGrid.fIncrement), FromGridFixed(event.fDocumentGrid.fStart));
+                }
+                break;
+
+            case kRecordRunEnd:
+                if (stats) {
+                    stats->fRecordedMicros += event.fDurationMicros;
+                }
+                break;
+
+            case kRecordParcels:
+            case kRecordLines:
+            case kRecordStyleRuns: {
+                const uint64_t start = AlignmentTrace::NowMicros();
+                pending.push_back(ReplaySnapshot(event, settings, scaleCache));
+                computeMicros += AlignmentTrace::NowMicros() - start;
+                if (stats) {
+                    stats->fSnapshots++;
+                    stats->fItems += SnapshotItemCount(event);
+                }
+                break;
+            }
+
+            case kRecordResult: {
+                if (pending.empty()) break;
+
+                const ReplayResult replayed = pending.front();
+                pending.pop_front();
+                if (!stats) break;
+
+                stats->fChanges += replayed.fChangeCount;
+
+                if (replayed.fChangeCount == event.fChangeCount && replayed.fChecksum == event.fChecksum) {
+                    stats->fMatched++;
+                }
+                else {
+                    stats->fMismatched++;
+                    printf("MISMATCH story %u: recorded %llu changes (%016llx), replayed %llu (%016llx)\n",
+                           event.fStory,
+                           static_cast<unsigned long long>(event.fChangeCount),
+                           static_cast<unsigned long long>(event.fChecksum),
+                           static_cast<unsigned long long>(replayed.fChangeCount),
+                           static_cast<unsigned long long>(replayed.fChecksum));
+                }
+                break;
+            }
+        }
+    }
+    return computeMicros;
+}
+
+void PrintUsage()
+{
+    fprintf(stderr, "Usage: AlignmentReplay <recording.bgar> [--repeat N] [--verbose]\n");
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    std::string path;
+    int repeat = 1;
+    bool verbose = false;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--repeat") == 0 && i + 1 < argc) {
+            repeat = std::max(1, atoi(argv[++i]));
+        }
+        else if (strcmp(argv[i], "--verbose") == 0) {
+            verbose = true;
+        }
+        else if (path.empty() && argv[i][0] != '-') {
+            path = argv[i];
+        }
+        else {
+            PrintUsage();
+            return 2;
+        }
+    }
+    if (path.empty()) {
+        PrintUsage();
+        return 2;
+    }
+
+    AlignmentRecordingReader reader;
+    if (!reader.Open(path)) {
+        fprintf(stderr, "Not a recording: %s\n", path.c_str());
+        return 2;
+    }
+
+    // Decode once, so timed passes measure only the engine
+    std::vector<RecordedEvent> events;
+    RecordedEvent event = RecordedEvent();
+    while (reader.Next(event)) {
+        events.push_back(event);
+    }
+    if (reader.IsDamaged()) {
+        fprintf(stderr, "Recording is truncated; replaying %zu complete records\n", events.size());
+    }
+
+    ReplayStats stats;
+    uint64_t bestMicros = ReplayPass(events, &stats, verbose);
+    uint64_t totalMicros = bestMicros;
+    for (int pass = 1; pass < repeat; pass++) {
+        const uint64_t micros = ReplayPass(events, nullptr, false);
+        bestMicros = std::min(bestMicros, micros);
+        totalMicros += micros;
+    }
+
+    printf("Recording:      %s (%zu bytes, %zu records)\n", path.c_str(), reader.GetFileSize(), events.size());
+    printf("Runs:           %llu (%.3f ms in the plugin)\n",
+           static_cast<unsigned long long>(stats.fRuns), stats.fRecordedMicros / 1000.0);
+    printf("Notifications:  %llu attributes, %llu frames, %llu document grid, %llu styles\n",
+           static_cast<unsigned long long>(stats.fNotifications[kRecordedTextAttrChanged]),
+           static_cast<unsigned long long>(stats.fNotifications[kRecordedTextFrameChanged]),
+           static_cast<unsigned long long>(stats.fNotifications[kRecordedDocGridChanged]),
+           static_cast<unsigned long long>(stats.fNotifications[kRecordedStyleChanged]));
+    printf("Snapshots:      %llu (%llu items, %llu changes)\n",
+           static_cast<unsigned long long>(stats.fSnapshots),
+           static_cast<unsigned long long>(stats.fItems),
+           static_cast<unsigned long long>(stats.fChanges));
+    printf("Compute:        best %.3f ms, mean %.3f ms over %d pass(es)\n",
+           bestMicros / 1000.0, totalMicros / 1000.0 / repeat, repeat);
+    printf("Results:        %llu matched, %llu mismatched\n",
+           static_cast<unsigned long long>(stats.fMatched),
+           static_cast<unsigned long long>(stats.fMismatched));
+
+    return stats.fMismatched == 0 ? 0 : 1;
+}
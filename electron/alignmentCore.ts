@@ -0,0 +1,158 @@
+import { app } from 'electron';
+import * as path from 'path';
+
+// Grid computations of the InDesign plugin, through its native addon
+// (BaselineGridAligner/addon/AlignmentCoreAddon.cpp). The addon works in the
+// typed arrays' own memory on a worker thread, so large frame sets are
+// checked without blocking the main process. If the addon fails to load,
+// analyzeTextFrames() falls back to the same fixed-point math in JavaScript
+// and reports the core as unavailable.
+
+const ADDON_FILE = 'alignment_core.node';
+
+interface AlignmentCoreAddon {
+  snapToGrid(value: number, increment: number): number;
+  gridScaleFactor(fontSize: number, increment: number): number;
+  snapLeadingToGrid(leading: number, increment: number, multiple?: number): number;
+  snapParcels(offsets: Float64Array, increments: Float64Array | number, newOffsets: Float64Array,
+    deviations?: Float64Array): Promise<{ corrected: number; histogram: number[] }>;
+  findOffGridLines(baselines: Float64Array, lineHeights: Float64Array, gridStart: number,
+    gridIncrement: number, deviations: Float64Array): Promise<{ offGrid: number; histogram: number[] }>;
+  validateParcels(baselines: Float64Array, leadings: Float64Array, increments: Float64Array | number,
+    tolerance: number, rules: Uint8Array): Promise<{ failedParcels: number; baselineOffGrid: number; leadingOffGrid: number }>;
+  ruleBaselineOffGrid: number;
+  ruleLeadingOffGrid: number;
+}
+
+export interface FrameStyle {
+  id: string;
+  baselineOffset: number;
+  lineHeight: number;
+}
+
+export interface FrameGridResult {
+  id: string;
+  baselineOffGrid: boolean;
+  leadingOffGrid: boolean;
+  suggestedBaselineOffset: number;
+  deviation: number;
+}
+
+export interface FrameGridAnalysis {
+  available: boolean;             // false: computed by the JavaScript fallback
+  frames: FrameGridResult[];
+  corrected: number;
+  histogram: number[];
+}
+
+let addon: AlignmentCoreAddon | null | undefined;
+
+// Packaged apps carry the addon in resources/native, development uses the plugin's build folder
+function loadAddon(): AlignmentCoreAddon | null {
+  if (addon !== undefined) return addon;
+
+  const addonPath = app.isPackaged
+    ? path.join(process.resourcesPath, 'native', ADDON_FILE)
+    : path.join(__dirname, '../BaselineGridAligner/build', ADDON_FILE);
+
+  try {
+    addon = require(addonPath) as AlignmentCoreAddon;
+  } catch (error) {
+    console.warn(`Native alignment core not available (${addonPath}):`, error);
+    addon = null;
+  }
+  return addon;
+}
+
+export function isAlignmentCoreAvailable(): boolean {
+  return loadAddon() !== null;
+}
+
+// Fallback mirrors of BaselineGridMath.h, in 1/1000 pt like the plugin
+const GRID_FIXED_SCALE = 1000;
+const HISTOGRAM_BUCKET_COUNT = 8;
+
+// std::llround: halves round away from zero
+const toGridFixed = (points: number) => Math.sign(points) * Math.round(Math.abs(points) * GRID_FIXED_SCALE);
+
+// SnapToGrid: nearest multiple of increment, halves round up
+const snapToGrid = (value: number, increment: number) =>
+  Math.floor((value + Math.floor(increment / 2)) / increment) * increment;
+
+// MisalignmentHistogram::Bucket
+function histogramBucket(deviation: number): number {
+  const magnitude = Math.abs(deviation);
+  let bucket = 0;
+  for (let bound = GRID_FIXED_SCALE / 4; magnitude >= bound && bucket < HISTOGRAM_BUCKET_COUNT - 1; bound *= 2) {
+    bucket++;
+  }
+  return bucket;
+}
+
+function analyzeTextFramesFallback(frames: FrameStyle[], gridIncrement: number,
+                                   tolerance: number): FrameGridAnalysis {
+  const increment = toGridFixed(gridIncrement);
+  const fixedTolerance = toGridFixed(tolerance);
+  const histogram = new Array<number>(HISTOGRAM_BUCKET_COUNT).fill(0);
+  let corrected = 0;
+
+  const results = frames.map(frame => {
+    const offset = toGridFixed(frame.baselineOffset);
+    const leading = toGridFixed(frame.lineHeight);
+    const newOffset = increment > 0 ? snapToGrid(offset, increment) : offset;
+    const deviation = newOffset - offset;
+    if (deviation !== 0) {
+      corrected++;
+      histogram[histogramBucket(deviation)]++;
+    }
+    return {
+      id: frame.id,
+      baselineOffGrid: increment > 0 && Math.abs(deviation) > fixedTolerance,
+      leadingOffGrid: increment > 0 && Math.abs(snapToGrid(leading, increment) - leading) > fixedTolerance,
+      suggestedBaselineOffset: newOffset / GRID_FIXED_SCALE,
+      deviation: deviation / GRID_FIXED_SCALE
+    };
+  });
+
+  return { available: false, frames: results, corrected, histogram };
+}
+
+// Check frame baselines and leading against a grid, in points
+export async function analyzeTextFrames(frames: FrameStyle[], gridIncrement: number,
+                                        tolerance = 0.01): Promise<FrameGridAnalysis> {
+  const core = loadAddon();
+  if (frames.length === 0 || !(gridIncrement > 0)) {
+    return { available: core !== null, frames: [], corrected: 0, histogram: [] };
+  }
+  if (!core) {
+    return analyzeTextFramesFallback(frames, gridIncrement, tolerance);
+  }
+  const count = frames.length;
+  const offsets = new Float64Array(count);
+  const leadings = new Float64Array(count);
+  frames.forEach((frame, i) => {
+    offsets[i] = frame.baselineOffset;
+    leadings[i] = frame.lineHeight;
+  });
+
+  const newOffsets = new Float64Array(count);
+  const deviations = new Float64Array(count);
+  const rules = new Uint8Array(count);
+  const [snap] = await Promise.all([
+    core.snapParcels(offsets, gridIncrement, newOffsets, deviations),
+    core.validateParcels(offsets, leadings, gridIncrement, tolerance, rules)
+  ]);
+
+  return {
+    available: true,
+    frames: frames.map((frame, i) => ({
+      id: frame.id,
+      baselineOffGrid: (rules[i] & core.ruleBaselineOffGrid) !== 0,
+      leadingOffGrid: (rules[i] & core.ruleLeadingOffGrid) !== 0,
+      suggestedBaselineOffset: newOffsets[i],
+      deviation: deviations[i]
+    })),
+    corrected: snap.corrected,
+    histogram: snap.histogram
+  };
+}
@@ -2,12 +2,21 @@ import { app, BrowserWindow, ipcMain, dialog, Menu } from 'electron';
 import * as path from 'path';
 import * as isDev from 'electron-is-dev';
 import Store from 'electron-store';
+import { StatsStreamReader } from './statsStream';
+import { analyzeTextFrames, FrameStyle } from './alignmentCore';
 
 // Initialize the settings store
 const store = new Store();
 
 let mainWindow: BrowserWindow | null = null;
 
+// Live statistics from the InDesign plugin, polled while the statistics page is open
+const STATS_STREAM_FILE = 'BaselineGridAlignerStats.bgas';
+const STATS_POLL_INTERVAL = 250;
+let statsReader: StatsStreamReader | null = null;
+let statsTimer: NodeJS.Timeout | null = null;
+let statsConnected = false;
+
 function createWindow() {
   // Create the browser window
   mainWindow = new BrowserWindow({
@@ -46,6 +55,7 @@ function createWindow() {
 
   // Handle window close
   mainWindow.on('closed', () => {
+    stopStatsStream();
     mainWindow = null;
   });
 
@@ -220,6 +230,38 @@ function showAboutDialog() {
   });
 }
 
+// Start polling the plugin's stats file and forwarding new snapshots to the renderer
+function startStatsStream() {
+  if (statsTimer) return;
+
+  // The plugin writes to its temp folder, which is the same as ours for the same user
+  const filePath = (store.get('statsStreamPath') as string | undefined) ||
+    path.join(app.getPath('temp'), STATS_STREAM_FILE);
+  statsReader = new StatsStreamReader(filePath);
+  statsConnected = false;
+
+  statsTimer = setInterval(() => {
+    if (!statsReader || !mainWindow) return;
+
+    const batch = statsReader.poll();
+    if (batch.snapshots.length > 0 || batch.lost > 0 || batch.connected !== statsConnected) {
+      statsConnected = batch.connected;
+      mainWindow.webContents.send('alignment-stats', batch);
+    }
+  }, STATS_POLL_INTERVAL);
+}
+
+function stopStatsStream() {
+  if (statsTimer) {
+    clearInterval(statsTimer);
+    statsTimer = null;
+  }
+  if (statsReader) {
+    statsReader.close();
+    statsReader = null;
+  }
+}
+
 // IPC handlers
 function setupIpcHandlers() {
   // Get settings
@@ -233,6 +275,27 @@ function setupIpcHandlers() {
     return true;
   });
   
+  // Live statistics stream
+  ipcMain.handle('start-stats-stream', () => {
+    startStatsStream();
+    return true;
+  });
+  
+  ipcMain.handle('stop-stats-stream', () => {
+    stopStatsStream();
+    return true;
+  });
+  
+  // Grid check of text frames in the plugin's native alignment core, or its JavaScript fallback
+  ipcMain.handle('analyze-text-frames', async (event, frames: FrameStyle[], gridIncrement: number, tolerance?: number) => {
+    try {
+      return await analyzeTextFrames(frames, gridIncrement, tolerance);
+    } catch (error) {
+      console.error('Error analyzing text frames:', error);
+      return null;
+    }
+  });
+  
   // Open file dialog
   ipcMain.handle('open-file-dialog', async () => {
     return await openDocument();
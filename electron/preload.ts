@@ -13,10 +13,18 @@ contextBridge.exposeInMainWorld(
     saveFile: (options: any) => ipcRenderer.invoke('save-file-dialog', options),
     getDocumentPreview: (filePath: string) => ipcRenderer.invoke('get-document-preview', filePath),
     
+    // Live statistics from the plugin, delivered on the 'alignment-stats' channel
+    startStatsStream: () => ipcRenderer.invoke('start-stats-stream'),
+    stopStatsStream: () => ipcRenderer.invoke('stop-stats-stream'),
+    
+    // Grid check in the plugin's native alignment core
+    analyzeTextFrames: (frames: any[], gridIncrement: number, tolerance?: number) =>
+      ipcRenderer.invoke('analyze-text-frames', frames, gridIncrement, tolerance),
+    
     // Event listeners
     on: (channel: string, callback: Function) => {
       // Whitelist channels
-      const validChannels = ['file-opened', 'save-settings'];
+      const validChannels = ['file-opened', 'save-settings', 'alignment-stats'];
       if (validChannels.includes(channel)) {
         // Deliberately strip event as it includes `sender` 
         ipcRenderer.on(channel, (_, ...args) => callback(...args));
@@ -25,7 +33,7 @@ contextBridge.exposeInMainWorld(
     
     // Remove event listeners
     removeAllListeners: (channel: string) => {
-      const validChannels = ['file-opened', 'save-settings'];
+      const validChannels = ['file-opened', 'save-settings', 'alignment-stats'];
       if (validChannels.includes(channel)) {
         ipcRenderer.removeAllListeners(channel);
       }
@@ -0,0 +1,192 @@
+import * as fs from 'fs';
+
+// Reader of the live statistics stream written by the InDesign plugin
+// (BaselineGridAligner/source/includes/AlignmentStatsStream.h). The plugin
+// maps the file and overwrites a ring of fixed-size slots; this side only
+// reads, so a slow or closed app never holds up an alignment run.
+
+const MAGIC = 0x53414742; // "BGAS"
+const VERSION = 1;
+const WRITE_INDEX_OFFSET = 64;
+const SLOTS_OFFSET = 128;
+
+// Slot field offsets, see AlignmentStatsRecord
+const SLOT_SEQUENCE = 0;
+const SLOT_RUN_ID = 8;
+const SLOT_TIME = 16;
+const SLOT_ELAPSED = 24;
+const SLOT_KIND = 32;
+const SLOT_RUN_KIND = 36;
+const SLOT_ALIGNMENT_TYPE = 40;
+const SLOT_PROGRESS = 44;
+const SLOT_COUNTERS = 48;
+const MAX_COUNTERS = 16;
+const SLOT_HISTOGRAM = SLOT_COUNTERS + MAX_COUNTERS * 8;
+
+// Same order and names as AlignmentCounters::GetName
+const COUNTER_NAMES = [
+  'parcelsScanned',
+  'parcelsSkippedByRange',
+  'parcelsSkippedByCache',
+  'parcelsModified',
+  'commandsIssued',
+  'misalignmentsFound',
+  'criticalSectionNanos',
+  'cancelLatencyMicros',
+  'runMicros',
+  'arenaHeapAllocations',
+  'arenaBytes',
+  'recompositions'
+];
+
+const SNAPSHOT_KINDS: { [kind: number]: AlignmentStatsSnapshot['kind'] } = {
+  1: 'begin',
+  2: 'progress',
+  3: 'end'
+};
+
+const RUN_KINDS: { [kind: number]: AlignmentStatsSnapshot['runKind'] } = {
+  1: 'selection',
+  2: 'preview',
+  3: 'document'
+};
+
+export interface AlignmentStatsSnapshot {
+  index: number;
+  runId: number;
+  timeMillis: number;
+  elapsedMicros: number;
+  kind: 'begin' | 'progress' | 'end';
+  runKind: 'selection' | 'preview' | 'document';
+  alignmentType: number;
+  progress: number;
+  counters: { [name: string]: number };
+  histogram: number[];
+}
+
+export interface AlignmentStatsBatch {
+  connected: boolean;
+  snapshots: AlignmentStatsSnapshot[];
+  lost: number;
+}
+
+// Counters fit in 53 bits long before they would lose precision
+function readUInt64(buffer: Buffer, offset: number): number {
+  return buffer.readUInt32LE(offset) + buffer.readUInt32LE(offset + 4) * 0x100000000;
+}
+
+export class StatsStreamReader {
+  private fd: number | null = null;
+  private streamId = -1;
+  private cursor = 0;
+  private slotCount = 0;
+  private slotSize = 0;
+  private counterCount = 0;
+  private bucketCount = 0;
+  private ring: Buffer | null = null;
+  private readonly indexBuffer = Buffer.alloc(8);
+
+  constructor(private readonly filePath: string) {}
+
+  // Snapshots published since the last poll; the file may not exist until the plugin runs
+  poll(): AlignmentStatsBatch {
+    const batch: AlignmentStatsBatch = { connected: false, snapshots: [], lost: 0 };
+
+    try {
+      if (this.fd === null) {
+        if (!fs.existsSync(this.filePath)) return batch;
+        this.fd = fs.openSync(this.filePath, 'r');
+      }
+
+      const header = Buffer.alloc(SLOTS_OFFSET);
+      if (fs.readSync(this.fd, header, 0, SLOTS_OFFSET, 0) < SLOTS_OFFSET) return batch;
+      if (header.readUInt32LE(0) !== MAGIC || header.readUInt32LE(4) !== VERSION) return batch;
+
+      // A new stream ID means the plugin started over; deliver what it kept
+      const streamId = readUInt64(header, 24);
+      const writeIndex = readUInt64(header, WRITE_INDEX_OFFSET);
+      if (streamId !== this.streamId) {
+        this.streamId = streamId;
+        this.slotCount = header.readUInt32LE(8);
+        this.slotSize = header.readUInt32LE(12);
+        this.counterCount = Math.min(header.readUInt32LE(16), MAX_COUNTERS);
+        this.bucketCount = header.readUInt32LE(20);
+        if (this.slotCount === 0 || this.slotSize < SLOT_HISTOGRAM + this.bucketCount * 8) {
+          this.streamId = -1;
+          return batch;
+        }
+        this.ring = Buffer.alloc(this.slotCount * this.slotSize);
+        this.cursor = Math.max(0, writeIndex - this.slotCount);
+      }
+      batch.connected = true;
+
+      if (writeIndex <= this.cursor || !this.ring) return batch;
+
+      if (writeIndex - this.cursor > this.slotCount) {
+        batch.lost += writeIndex - this.cursor - this.slotCount;
+        this.cursor = writeIndex - this.slotCount;
+      }
+
+      fs.readSync(this.fd, this.ring, 0, this.ring.length, SLOTS_OFFSET);
+
+      // Slots the writer reached while they were copied are discarded
+      fs.readSync(this.fd, this.indexBuffer, 0, 8, WRITE_INDEX_OFFSET);
+      const writeIndexAfter = readUInt64(this.indexBuffer, 0);
+
+      for (let index = this.cursor; index < writeIndex; index++) {
+        const offset = (index % this.slotCount) * this.slotSize;
+        const complete = readUInt64(this.ring, offset + SLOT_SEQUENCE) === 2 * index + 2;
+        if (!complete || writeIndexAfter - index >= this.slotCount) {
+          batch.lost++;
+          continue;
+        }
+        batch.snapshots.push(this.decode(index, offset));
+      }
+      this.cursor = writeIndex;
+    } catch (error) {
+      // The plugin recreates the file when it starts; reopen on the next poll
+      this.close();
+    }
+
+    return batch;
+  }
+
+  close() {
+    if (this.fd !== null) {
+      try {
+        fs.closeSync(this.fd);
+      } catch (error) {
+        // Already gone
+      }
+      this.fd = null;
+    }
+    this.streamId = -1;
+  }
+
+  private decode(index: number, offset: number): AlignmentStatsSnapshot {
+    const ring = this.ring as Buffer;
+
+    const counters: { [name: string]: number } = {};
+    for (let i = 0; i < this.counterCount; i++) {
+      counters[COUNTER_NAMES[i] || `counter${i}`] = readUInt64(ring, offset + SLOT_COUNTERS + i * 8);
+    }
+
+    const histogram: number[] = [];
+    for (let i = 0; i < this.bucketCount; i++) {
+      histogram.push(readUInt64(ring, offset + SLOT_HISTOGRAM + i * 8));
+    }
+
+    return {
+      index,
+      runId: readUInt64(ring, offset + SLOT_RUN_ID),
+      timeMillis: readUInt64(ring, offset + SLOT_TIME),
+      elapsedMicros: readUInt64(ring, offset + SLOT_ELAPSED),
+      kind: SNAPSHOT_KINDS[ring.readUInt32LE(offset + SLOT_KIND)] || 'progress',
+      runKind: RUN_KINDS[ring.readUInt32LE(offset + SLOT_RUN_KIND)] || 'selection',
+      alignmentType: ring.readInt32LE(offset + SLOT_ALIGNMENT_TYPE),
+      progress: ring.readUInt32LE(offset + SLOT_PROGRESS) / 1000,
+      counters,
+      histogram
+    };
+  }
+}
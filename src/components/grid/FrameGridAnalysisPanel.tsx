@@ -0,0 +1,114 @@
+import React from 'react';
+import { useTranslation } from 'react-i18next';
+import {
+  Box,
+  Typography,
+  Paper,
+  Grid,
+  Chip,
+  Table,
+  TableBody,
+  TableCell,
+  TableContainer,
+  TableHead,
+  TableRow
+} from '@mui/material';
+import { useAppContext } from '../../context/AppContext';
+import { FrameGridResult } from '../../types/document';
+
+// Off-grid frames listed in the table
+const MAX_LISTED_FRAMES = 10;
+
+const formatPoints = (value: number) => `${value.toFixed(3)} pt`;
+const formatDeviation = (value: number) => `${value > 0 ? '+' : ''}${formatPoints(value)}`;
+
+const FrameGridAnalysisPanel: React.FC = () => {
+  const { t } = useTranslation();
+  const { frameAnalysis, gridSettings } = useAppContext();
+
+  const frames = frameAnalysis?.frames || [];
+  const baselineOffGrid = frames.filter((frame: FrameGridResult) => frame.baselineOffGrid).length;
+  const leadingOffGrid = frames.filter((frame: FrameGridResult) => frame.leadingOffGrid).length;
+  const offGridFrames = frames.filter((frame: FrameGridResult) => frame.baselineOffGrid || frame.leadingOffGrid);
+
+  const summary = [
+    { label: t('frameAnalysis.frames'), value: frames.length },
+    { label: t('frameAnalysis.baselineOffGrid'), value: baselineOffGrid },
+    { label: t('frameAnalysis.leadingOffGrid'), value: leadingOffGrid },
+    { label: t('frameAnalysis.corrected'), value: frameAnalysis?.corrected || 0 }
+  ];
+
+  return (
+    <Paper sx={{ p: 3 }}>
+      <Box sx={{ display: 'flex', justifyContent: 'space-between', alignItems: 'center', mb: 2 }}>
+        <Typography variant="h6">
+          {t('frameAnalysis.title', { grid: gridSettings.baselineSize })}
+        </Typography>
+
+        {frameAnalysis && (
+          <Chip
+            label={frameAnalysis.available ? t('frameAnalysis.nativeCore') : t('frameAnalysis.fallback')}
+            color={frameAnalysis.available ? 'success' : 'warning'}
+            size="small"
+          />
+        )}
+      </Box>
+
+      {frames.length === 0 ? (
+        <Typography variant="body2" color="text.secondary">
+          {t('frameAnalysis.noFrames')}
+        </Typography>
+      ) : (
+        <>
+          <Grid container spacing={2} sx={{ mb: 2 }}>
+            {summary.map(item => (
+              <Grid item xs={6} md={3} key={item.label}>
+                <Typography variant="body2" color="text.secondary">
+                  {item.label}
+                </Typography>
+                <Typography variant="h6">
+                  {item.value}
+                </Typography>
+              </Grid>
+            ))}
+          </Grid>
+
+          {offGridFrames.length > 0 && (
+            <TableContainer>
+              <Table size="small">
+                <TableHead>
+                  <TableRow>
+                    <TableCell>{t('frameAnalysis.frame')}</TableCell>
+                    <TableCell align="right">{t('frameAnalysis.deviation')}</TableCell>
+                    <TableCell align="right">{t('frameAnalysis.suggestedOffset')}</TableCell>
+                    <TableCell>{t('frameAnalysis.leading')}</TableCell>
+                  </TableRow>
+                </TableHead>
+                <TableBody>
+                  {offGridFrames.slice(0, MAX_LISTED_FRAMES).map((frame: FrameGridResult) => (
+                    <TableRow key={frame.id}>
+                      <TableCell>{frame.id}</TableCell>
+                      <TableCell align="right">{formatDeviation(frame.deviation)}</TableCell>
+                      <TableCell align="right">{formatPoints(frame.suggestedBaselineOffset)}</TableCell>
+                      <TableCell>
+                        {frame.leadingOffGrid ? t('frameAnalysis.offGrid') : t('frameAnalysis.onGrid')}
+                      </TableCell>
+                    </TableRow>
+                  ))}
+                </TableBody>
+              </Table>
+            </TableContainer>
+          )}
+
+          {offGridFrames.length > MAX_LISTED_FRAMES && (
+            <Typography variant="body2" color="text.secondary" sx={{ mt: 1 }}>
+              {t('frameAnalysis.more', { count: offGridFrames.length - MAX_LISTED_FRAMES })}
+            </Typography>
+          )}
+        </>
+      )}
+    </Paper>
+  );
+};
+
+export default FrameGridAnalysisPanel;
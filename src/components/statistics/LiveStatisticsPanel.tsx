@@ -0,0 +1,254 @@
+import React, { useEffect, useState } from 'react';
+import { useTranslation } from 'react-i18next';
+import {
+  Box,
+  Typography,
+  Paper,
+  Grid,
+  Card,
+  CardContent,
+  Chip,
+  LinearProgress,
+  Table,
+  TableBody,
+  TableCell,
+  TableContainer,
+  TableHead,
+  TableRow
+} from '@mui/material';
+import {
+  AlignmentStatsBatch,
+  AlignmentStatsSnapshot,
+  MISALIGNMENT_BUCKET_BOUNDS
+} from '../../types/statistics';
+
+// BaselineGridAlignmentType values of the plugin
+const ALIGNMENT_TYPES = ['baseline', 'tracking', 'wordSpacing', 'combined', 'lines', 'leading'];
+
+// Finished runs kept in the table
+const MAX_RECENT_RUNS = 10;
+
+// Parcels handled per second of the run so far
+const getThroughput = (snapshot: AlignmentStatsSnapshot) => {
+  const seconds = snapshot.elapsedMicros / 1e6;
+  return seconds > 0 ? Math.round((snapshot.counters.parcelsScanned || 0) / seconds) : 0;
+};
+
+const getMisalignmentCount = (snapshot: AlignmentStatsSnapshot) =>
+  snapshot.histogram.reduce((sum: number, count: number) => sum + count, 0);
+
+const LiveStatisticsPanel: React.FC = () => {
+  const { t, i18n } = useTranslation();
+
+  const [connected, setConnected] = useState(false);
+  const [current, setCurrent] = useState<AlignmentStatsSnapshot | null>(null);
+  const [recentRuns, setRecentRuns] = useState<AlignmentStatsSnapshot[]>([]);
+  const [lost, setLost] = useState(0);
+
+  // Poll the plugin's stream only while this panel is shown
+  useEffect(() => {
+    const handleStats = (batch: AlignmentStatsBatch) => {
+      setConnected(batch.connected);
+      if (batch.lost > 0) {
+        setLost((previous: number) => previous + batch.lost);
+      }
+      if (batch.snapshots.length === 0) return;
+
+      setCurrent(batch.snapshots[batch.snapshots.length - 1]);
+
+      const finished = batch.snapshots.filter((snapshot: AlignmentStatsSnapshot) => snapshot.kind === 'end');
+      if (finished.length > 0) {
+        setRecentRuns((previous: AlignmentStatsSnapshot[]) =>
+          [...finished.reverse(), ...previous].slice(0, MAX_RECENT_RUNS));
+      }
+    };
+
+    window.api.on('alignment-stats', handleStats);
+    window.api.startStatsStream();
+
+    return () => {
+      window.api.removeAllListeners('alignment-stats');
+      window.api.stopStatsStream();
+    };
+  }, []);
+
+  const formatNumber = (value: number) => value.toLocaleString(i18n.language);
+
+  const getAlignmentTypeLabel = (type: number) =>
+    ALIGNMENT_TYPES[type] ? t(`alignment.types.${ALIGNMENT_TYPES[type]}`) : String(type);
+
+  const getBucketLabel = (bucket: number) => {
+    const bounds = MISALIGNMENT_BUCKET_BOUNDS;
+    if (bucket === 0) return `< ${bounds[0].toLocaleString(i18n.language)} pt`;
+    if (bucket >= bounds.length) return `≥ ${bounds[bounds.length - 1].toLocaleString(i18n.language)} pt`;
+    return `${bounds[bucket - 1].toLocaleString(i18n.language)}–${bounds[bucket].toLocaleString(i18n.language)} pt`;
+  };
+
+  const running = current !== null && current.kind !== 'end';
+  const maxBucket = current ? Math.max(1, ...current.histogram) : 1;
+
+  return (
+    <Paper sx={{ p: 3, mb: 3 }}>
+      <Box sx={{ display: 'flex', justifyContent: 'space-between', alignItems: 'center', mb: 2 }}>
+        <Typography variant="h6">
+          {t('statistics.live.title')}
+        </Typography>
+
+        <Box sx={{ display: 'flex', gap: 1 }}>
+          {lost > 0 && (
+            <Chip
+              label={t('statistics.live.lost', { count: lost })}
+              size="small"
+              color="warning"
+            />
+          )}
+          <Chip
+            label={connected ? t('statistics.live.connected') : t('statistics.live.disconnected')}
+            size="small"
+            color={connected ? 'success' : 'default'}
+          />
+        </Box>
+      </Box>
+
+      {!current ? (
+        <Typography variant="body2" color="text.secondary">
+          {t('statistics.live.waiting')}
+        </Typography>
+      ) : (
+        <Grid container spacing={3}>
+          {/* Current or last run */}
+          <Grid item xs={12} md={6}>
+            <Typography variant="subtitle2" gutterBottom>
+              {running ? t('statistics.live.running') : t('statistics.live.lastRun')}
+              {` — ${t(`statistics.live.runKinds.${current.runKind}`)}, ${getAlignmentTypeLabel(current.alignmentType)}`}
+            </Typography>
+
+            <Box sx={{ display: 'flex', alignItems: 'center', mb: 2 }}>
+              <Box sx={{ width: '100%', mr: 1 }}>
+                <LinearProgress
+                  variant="determinate"
+                  value={current.progress * 100}
+                  sx={{ height: 10, borderRadius: 5 }}
+                />
+              </Box>
+              <Box sx={{ minWidth: 35 }}>
+                <Typography variant="body2" color="text.secondary">
+                  {`${Math.round(current.progress * 100)}%`}
+                </Typography>
+              </Box>
+            </Box>
+
+            <Grid container spacing={2}>
+              <Grid item xs={4}>
+                <Card>
+                  <CardContent>
+                    <Typography variant="h5" align="center">
+                      {formatNumber(getThroughput(current))}
+                    </Typography>
+                    <Typography variant="body2" color="text.secondary" align="center">
+                      {t('statistics.live.throughput')}
+                    </Typography>
+                  </CardContent>
+                </Card>
+              </Grid>
+
+              <Grid item xs={4}>
+                <Card>
+                  <CardContent>
+                    <Typography variant="h5" align="center" color="error">
+                      {formatNumber(getMisalignmentCount(current))}
+                    </Typography>
+                    <Typography variant="body2" color="text.secondary" align="center">
+                      {t('statistics.live.misalignments')}
+                    </Typography>
+                  </CardContent>
+                </Card>
+              </Grid>
+
+              <Grid item xs={4}>
+                <Card>
+                  <CardContent>
+                    <Typography variant="h5" align="center">
+                      {formatNumber(current.counters.parcelsSkippedByCache || 0)}
+                    </Typography>
+                    <Typography variant="body2" color="text.secondary" align="center">
+                      {t('statistics.live.skippedByCache')}
+                    </Typography>
+                  </CardContent>
+                </Card>
+              </Grid>
+            </Grid>
+
+            <Typography variant="body2" color="text.secondary" sx={{ mt: 1 }}>
+              {t('statistics.live.elapsed', { seconds: (current.elapsedMicros / 1e6).toFixed(1) })}
+            </Typography>
+          </Grid>
+
+          {/* Misalignments by distance from the grid */}
+          <Grid item xs={12} md={6}>
+            <Typography variant="subtitle2" gutterBottom>
+              {t('statistics.live.histogram')}
+            </Typography>
+
+            {current.histogram.map((count: number, bucket: number) => (
+              <Box key={bucket} sx={{ display: 'flex', alignItems: 'center', mb: 0.5 }}>
+                <Typography variant="body2" sx={{ minWidth: 90 }}>
+                  {getBucketLabel(bucket)}
+                </Typography>
+                <Box sx={{ flexGrow: 1, mx: 1 }}>
+                  <LinearProgress
+                    variant="determinate"
+                    value={(count / maxBucket) * 100}
+                    color="warning"
+                    sx={{ height: 8, borderRadius: 4 }}
+                  />
+                </Box>
+                <Typography variant="body2" color="text.secondary" sx={{ minWidth: 60 }} align="right">
+                  {formatNumber(count)}
+                </Typography>
+              </Box>
+            ))}
+          </Grid>
+
+          {/* Finished runs */}
+          {recentRuns.length > 0 && (
+            <Grid item xs={12}>
+              <TableContainer>
+                <Table size="small">
+                  <TableHead>
+                    <TableRow>
+                      <TableCell>{t('statistics.live.run')}</TableCell>
+                      <TableCell>{t('alignment.type')}</TableCell>
+                      <TableCell align="right">{t('statistics.live.duration')}</TableCell>
+                      <TableCell align="right">{t('statistics.paragraphs')}</TableCell>
+                      <TableCell align="right">{t('statistics.live.modified')}</TableCell>
+                      <TableCell align="right">{t('statistics.live.misalignments')}</TableCell>
+                      <TableCell align="right">{t('statistics.live.throughput')}</TableCell>
+                    </TableRow>
+                  </TableHead>
+                  <TableBody>
+                    {recentRuns.map((run: AlignmentStatsSnapshot) => (
+                      <TableRow key={run.index}>
+                        <TableCell>
+                          {`${new Date(run.timeMillis).toLocaleTimeString(i18n.language)}, ${t(`statistics.live.runKinds.${run.runKind}`)}`}
+                        </TableCell>
+                        <TableCell>{getAlignmentTypeLabel(run.alignmentType)}</TableCell>
+                        <TableCell align="right">{`${(run.elapsedMicros / 1000).toFixed(1)} ms`}</TableCell>
+                        <TableCell align="right">{formatNumber(run.counters.parcelsScanned || 0)}</TableCell>
+                        <TableCell align="right">{formatNumber(run.counters.parcelsModified || 0)}</TableCell>
+                        <TableCell align="right">{formatNumber(getMisalignmentCount(run))}</TableCell>
+                        <TableCell align="right">{formatNumber(getThroughput(run))}</TableCell>
+                      </TableRow>
+                    ))}
+                  </TableBody>
+                </Table>
+              </TableContainer>
+            </Grid>
+          )}
+        </Grid>
+      )}
+    </Paper>
+  );
+};
+
+export default LiveStatisticsPanel;
@@ -2,6 +2,7 @@ import React, { createContext, useContext, useState, useEffect } from 'react';
 import { 
   DocumentData, 
   TextFrame, 
+  FrameGridAnalysis,
   AlignmentSettings, 
   GridSettings, 
   Preset 
@@ -16,6 +17,7 @@ interface AppContextType {
   setTextFrames: (frames: TextFrame[]) => void;
   selectedFrameIds: string[];
   setSelectedFrameIds: (ids: string[]) => void;
+  frameAnalysis: FrameGridAnalysis | null;
   
   // Settings state
   alignmentSettings: AlignmentSettings;
@@ -55,6 +57,7 @@ const AppContext = createContext<AppContextType>({
   setTextFrames: () => {},
   selectedFrameIds: [],
   setSelectedFrameIds: () => {},
+  frameAnalysis: null,
   
   // Settings state
   alignmentSettings: {
@@ -109,6 +112,7 @@ export const AppContextProvider: React.FC<{ children: React.ReactNode }> = ({ ch
   const [currentDocument, setCurrentDocument] = useState<DocumentData | null>(null);
   const [textFrames, setTextFrames] = useState<TextFrame[]>([]);
   const [selectedFrameIds, setSelectedFrameIds] = useState<string[]>([]);
+  const [frameAnalysis, setFrameAnalysis] = useState<FrameGridAnalysis | null>(null);
   
   // Settings state
   const [alignmentSettings, setAlignmentSettings] = useState<AlignmentSettings>({
@@ -192,6 +196,34 @@ export const AppContextProvider: React.FC<{ children: React.ReactNode }> = ({ ch
     };
   }, []);
   
+  // Check the frames against the baseline grid whenever either changes
+  useEffect(() => {
+    let cancelled = false;
+    
+    const analyzeFrames = async () => {
+      const frames = textFrames.map((frame: TextFrame) => ({
+        id: frame.id,
+        baselineOffset: frame.style.baselineOffset,
+        lineHeight: frame.style.lineHeight
+      }));
+      
+      try {
+        const analysis = await window.api.analyzeTextFrames(frames, gridSettings.baselineSize);
+        if (!cancelled) {
+          setFrameAnalysis(analysis);
+        }
+      } catch (error) {
+        console.error('Error analyzing text frames:', error);
+      }
+    };
+    
+    analyzeFrames();
+    
+    return () => {
+      cancelled = true;
+    };
+  }, [textFrames, gridSettings.baselineSize]);
+  
   // Handle file opened event
   const handleFileOpened = async (filePath: string) => {
     try {
@@ -305,6 +337,7 @@ export const AppContextProvider: React.FC<{ children: React.ReactNode }> = ({ ch
     setTextFrames,
     selectedFrameIds,
     setSelectedFrameIds,
+    frameAnalysis,
     
     // Settings state
     alignmentSettings,
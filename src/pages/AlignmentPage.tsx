@@ -33,6 +33,7 @@ import {
   ColorLens as ColorIcon
 } from '@mui/icons-material';
 import { useAppContext } from '../context/AppContext';
+import FrameGridAnalysisPanel from '../components/grid/FrameGridAnalysisPanel';
 import { AlignmentSettings } from '../types/document';
 
 const AlignmentPage: React.FC = () => {
@@ -374,6 +375,11 @@ const AlignmentPage: React.FC = () => {
             </Paper>
           </Grid>
           
+          {/* Frame grid analysis */}
+          <Grid item xs={12}>
+            <FrameGridAnalysisPanel />
+          </Grid>
+          
           {/* Batch processing */}
           <Grid item xs={12}>
             <Paper sx={{ p: 3 }}>
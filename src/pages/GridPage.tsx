@@ -24,6 +24,7 @@ import {
   ColorLens as ColorIcon
 } from '@mui/icons-material';
 import { useAppContext } from '../context/AppContext';
+import FrameGridAnalysisPanel from '../components/grid/FrameGridAnalysisPanel';
 import { GridSettings } from '../types/document';
 
 const GridPage: React.FC = () => {
@@ -425,6 +426,11 @@ const GridPage: React.FC = () => {
               </Box>
             </Paper>
           </Grid>
+          
+          {/* Frame grid analysis */}
+          <Grid item xs={12}>
+            <FrameGridAnalysisPanel />
+          </Grid>
         </Grid>
       )}
     </Box>
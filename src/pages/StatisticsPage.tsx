@@ -28,6 +28,7 @@ import {
 } from '@mui/icons-material';
 import { useAppContext } from '../context/AppContext';
 import { AlignmentIssue } from '../types/document';
+import LiveStatisticsPanel from '../components/statistics/LiveStatisticsPanel';
 
 // Mock data for demonstration
 const mockStatistics = {
@@ -160,6 +161,9 @@ const StatisticsPage: React.FC = () => {
         {t('statistics.title')}
       </Typography>
       
+      {/* Live data from the plugin, shown with or without a document */}
+      <LiveStatisticsPanel />
+      
       {!currentDocument ? (
         // No document loaded
         <Alert severity="info" sx={{ mb: 2 }}>
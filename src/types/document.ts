@@ -85,6 +85,28 @@ export interface GridSettings {
   verticalSpacing: number;
 }
 
+/**
+ * Grid check of one text frame, in points
+ */
+export interface FrameGridResult {
+  id: string;
+  baselineOffGrid: boolean;
+  leadingOffGrid: boolean;
+  suggestedBaselineOffset: number;
+  deviation: number;
+}
+
+/**
+ * Grid check of the document's text frames. available is false when the
+ * plugin's native core could not be loaded and the JavaScript fallback ran.
+ */
+export interface FrameGridAnalysis {
+  available: boolean;
+  frames: FrameGridResult[];
+  corrected: number;
+  histogram: number[];
+}
+
 /**
  * Alignment issue interface
  */
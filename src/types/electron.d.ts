@@ -1,3 +1,5 @@
+import { FrameGridAnalysis } from './document';
+
 /**
  * Electron API interface
  */
@@ -22,6 +24,17 @@ interface ElectronAPI {
     } | null;
   } | null>;
   
+  // Live statistics stream; batches arrive on the 'alignment-stats' channel
+  startStatsStream: () => Promise<boolean>;
+  stopStatsStream: () => Promise<boolean>;
+  
+  // Grid check in the plugin's native alignment core, or its JavaScript fallback; null on failure
+  analyzeTextFrames: (
+    frames: { id: string; baselineOffset: number; lineHeight: number }[],
+    gridIncrement: number,
+    tolerance?: number
+  ) => Promise<FrameGridAnalysis | null>;
+  
   // Event listeners
   on: (channel: string, callback: Function) => void;
   removeAllListeners: (channel: string) => void;
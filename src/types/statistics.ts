@@ -0,0 +1,31 @@
+/**
+ * One snapshot of an alignment run published by the InDesign plugin
+ * (mirrors AlignmentStatsSnapshot in electron/statsStream.ts)
+ */
+export interface AlignmentStatsSnapshot {
+  index: number;
+  runId: number;
+  timeMillis: number;
+  elapsedMicros: number;
+  kind: 'begin' | 'progress' | 'end';
+  runKind: 'selection' | 'preview' | 'document';
+  alignmentType: number;
+  progress: number;
+  counters: { [name: string]: number };
+  histogram: number[];
+}
+
+/**
+ * Snapshots delivered by one poll of the live statistics stream
+ */
+export interface AlignmentStatsBatch {
+  connected: boolean;
+  snapshots: AlignmentStatsSnapshot[];
+  lost: number;
+}
+
+/**
+ * Upper bounds of the misalignment histogram buckets in points;
+ * the last bucket has no upper bound
+ */
+export const MISALIGNMENT_BUCKET_BOUNDS = [0.25, 0.5, 1, 2, 4, 8, 16];